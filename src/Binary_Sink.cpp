@@ -0,0 +1,137 @@
+#include "Binary_Sink.hpp"
+
+Binary_Sink::Binary_Sink(std::string path) :
+  f(path == "-" ? stdout : fopen(path.c_str(), "wb")),
+  path(path),
+  rec_start(0),
+  last_write(0)
+{
+  if (! f)
+    throw std::runtime_error("Unable to create output file " + path);
+  buf.reserve(BUFFER_BYTES + MAX_LINE_SIZE);
+  uint32_t hdr[2] = {VERSION, 0};
+  buf.append(MAGIC, sizeof(MAGIC));
+  buf.append((const char *) hdr, sizeof(hdr));
+};
+
+Binary_Sink::~Binary_Sink() {
+  // a file not close()d is left incomplete
+  if (f && f != stdout)
+    fclose(f);
+};
+
+void
+Binary_Sink::begin_record(Table t) {
+  rec_start = buf.size();
+  uint16_t hdr[2] = {(uint16_t) t, 0};
+  buf.append((const char *) hdr, sizeof(hdr));
+};
+
+void
+Binary_Sink::end_record() {
+  uint16_t n = buf.size() - rec_start - 2 * sizeof(uint16_t);
+  memcpy(& buf[rec_start + sizeof(uint16_t)], & n, sizeof(n));
+  if (buf.size() >= BUFFER_BYTES || (f == stdout && time_now() - last_write >= FLUSH_SECONDS))
+    write();
+};
+
+void
+Binary_Sink::write() {
+  if (buf.size() && fwrite(buf.data(), buf.size(), 1, f) != 1)
+    throw std::runtime_error("Unable to write output file " + path);
+  if (f == stdout) {
+    fflush(f);
+    last_write = time_now();
+  }
+  buf.clear();
+};
+
+void
+Binary_Sink::add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done) {
+  begin_record(RUNS);
+  put((int32_t) rid);
+  put((int32_t) rb.bid);
+  put((double) rb.ts);
+  put((double) tsEnd);
+  put((int32_t) done);
+  put((int32_t) rb.mid);
+  put((int32_t) rb.ant);
+  put((int32_t) len);
+  end_record();
+  if (f == stdout)
+    write();
+};
+
+void
+Binary_Sink::add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) {
+  begin_record(HITS);
+  put((int32_t) bid);
+  put((int32_t) rid);
+  put(ts);
+  put(sig);
+  put(sigSD);
+  put(noise);
+  put(freq);
+  put(freqSD);
+  put(slop);
+  put(burstSlop);
+  end_record();
+};
+
+void
+Binary_Sink::add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt) {
+  begin_record(GPS);
+  put(ts);
+  put((int32_t) bid);
+  put(lat);
+  put(lon);
+  put(alt);
+  end_record();
+};
+
+void
+Binary_Sink::add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count) {
+  begin_record(PULSE_COUNTS);
+  put((int32_t) bid);
+  put((int32_t) ant);
+  put(hourBin);
+  put((int32_t) count);
+  end_record();
+};
+
+void
+Binary_Sink::add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra) {
+  begin_record(PARAMS);
+  put((int32_t) bid);
+  put((double) ts);
+  put((int32_t) ant);
+  put(param);
+  put(val);
+  put((int32_t) error);
+  put(extra);
+  end_record();
+};
+
+void
+Binary_Sink::add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p) {
+  begin_record(PULSES);
+  put((int32_t) bid);
+  put(p.ts);
+  put((int32_t) ant);
+  put((double) p.ant_freq);
+  put((float) p.dfreq);
+  put(p.sig);
+  put(p.noise);
+  end_record();
+};
+
+void
+Binary_Sink::close() {
+  write();
+  if (f == stdout ? fflush(f) : fclose(f))
+    throw std::runtime_error("Unable to write output file " + path);
+  f = 0;
+};
+
+const char
+Binary_Sink::MAGIC[8] = {'F', 'T', 'R', 'E', 'C', 'O', 'R', 'D'};
@@ -0,0 +1,83 @@
+#ifndef BINARY_SINK_HPP
+#define BINARY_SINK_HPP
+
+//!< Binary_Sink - write output as a stream of binary records.
+//
+// Unlike Columnar_Sink, records are neither grouped nor compressed,
+// so each can be used by a downstream reader (e.g. through a pipe) as
+// soon as it is written, and writing costs almost nothing.
+//
+// ## Format (version 1; all values in native byte order)
+//
+//   header:  char[8] MAGIC, uint32 VERSION, uint32 0
+//
+//   then records, each:
+//
+//     uint16 table, uint16 nBytes
+//     nBytes bytes: the record's values, in the order and with the
+//                   types given for its table in Columnar_Sink.hpp
+//                   (the table numbers are also the same)
+//
+// Records are buffered, and written BUFFER_BYTES at a time.  A path of
+// "-" means standard output, which is flushed after each write.  So
+// that a reader there sees records promptly, the buffer is also
+// written once a run ends (after its hits), and when a record is added
+// FLUSH_SECONDS or more after the last write.
+
+#include "Output_Sink.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+class Binary_Sink : public Output_Sink {
+
+public:
+  Binary_Sink(std::string path); //!< create the file, replacing any existing one
+  ~Binary_Sink();
+
+  void add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop);
+
+  void add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt);
+
+  void add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count);
+
+  void add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra);
+
+  void add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p);
+
+  void close();
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const size_t BUFFER_BYTES = 1 << 20;
+  static constexpr double FLUSH_SECONDS = 0.25; //!< for standard output, longest time to hold records while more are being added
+
+protected:
+
+  typedef enum {RUNS = 0, HITS, GPS, PULSE_COUNTS, PARAMS, PULSES} Table;
+
+  FILE * f;
+  std::string path;
+  std::string buf;   //!< records not yet written
+  size_t rec_start;  //!< offset in buf of the record being built
+  double last_write; //!< when buf was last written
+
+  void add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done);
+
+  void begin_record(Table t); //!< start a record for table t
+
+  template < typename T >
+  void put(T v) { //!< append a value to the record being built
+    buf.append((const char *) & v, sizeof(v));
+  };
+
+  void put(const char * s) { //!< append a string to the record being built
+    buf.append(s, strlen(s) + 1);
+  };
+
+  void end_record(); //!< fill in the record's size, and write the buffer if full
+
+  void write(); //!< write the buffer
+};
+
+#endif // BINARY_SINK_HPP
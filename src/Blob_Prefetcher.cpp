@@ -0,0 +1,200 @@
+#include "Blob_Prefetcher.hpp"
+
+#include <string.h>
+
+Blob_Prefetcher::Blob_Prefetcher(const std::vector < File > & files, unsigned int depth, size_t max_blob) :
+  files(files),
+  depth(depth),
+  max_blob(std::max(max_blob, (size_t) 1)),
+  next(0),
+  queued(0),
+  generation(0),
+  stopping(false),
+  skip(0),
+  stream(0),
+  stream_file(0),
+  stream_offset(0)
+{
+  for (unsigned int k = 0; k < depth; ++k)
+    threads.push_back(std::thread(& Blob_Prefetcher::work, this));
+};
+
+Blob_Prefetcher::~Blob_Prefetcher() {
+  {
+    std::unique_lock < std::mutex > lock(m);
+    stopping = true;
+  }
+  wanted.notify_all();
+  for (auto t = threads.begin(); t != threads.end(); ++t)
+    t->join();
+  end_stream();
+};
+
+bool
+Blob_Prefetcher::get(const char ** buf, int * len, const File ** f, int * offset) {
+  if (stream) {
+    // continue with the file being streamed
+    * offset = stream_offset;
+    if (read_chunk()) {
+      stream_offset += current.size();
+      * f = stream_file;
+      * buf = current.data();
+      * len = current.size();
+      return true;
+    }
+    end_stream();
+  }
+  bool whole;
+  if (! depth) {
+    if (next >= files.size())
+      return false;
+    whole = read_file(files[next], current);
+  } else {
+    std::unique_lock < std::mutex > lock(m);
+    if (next >= files.size())
+      return false;
+    ready.wait(lock, [this] {auto s = slots.find(next); return s != slots.end() && s->second.done;});
+    auto s = slots.find(next);
+    current.swap(s->second.data);
+    whole = ! s->second.stream;
+    slots.erase(s);
+  }
+  * f = & files[next];
+  ++ next;
+  if (depth)
+    wanted.notify_one();
+
+  size_t from = skip;
+  skip = 0;
+  if (! whole) {
+    // too large to hold in memory; hand out its first piece, even if
+    // empty, so that the caller sees every file
+    current.clear();
+    stream = gzopen((*f)->path.c_str(), "rb");
+    if (stream) {
+      stream_file = * f;
+      carry.clear();
+      // gzseek() reads and discards what precedes the offset, so
+      // this also uses bounded memory
+      if (from > 0 && gzseek(stream, from, SEEK_SET) < 0)
+        end_stream();
+      else if (read_chunk())
+        stream_offset = from + current.size();
+      else
+        end_stream();
+    }
+    * offset = from;
+    * buf = current.data();
+    * len = current.size();
+    return true;
+  }
+  from = std::min(from, current.size());
+  * offset = from;
+  * buf = current.data() + from;
+  * len = current.size() - from;
+  return true;
+};
+
+void
+Blob_Prefetcher::seek(Timestamp ts, int offset) {
+  end_stream();
+  skip = offset;
+  std::unique_lock < std::mutex > lock(m);
+  size_t i = 0;
+  while (i < files.size() && files[i].ts < ts)
+    ++i;
+  if (i == next && queued == next)
+    return; // nothing read ahead yet, so nothing to drop
+  ++ generation;
+  slots.clear();
+  next = queued = i;
+  wanted.notify_all();
+};
+
+void
+Blob_Prefetcher::work() {
+  std::unique_lock < std::mutex > lock(m);
+  for (;;) {
+    wanted.wait(lock, [this] {return stopping || (queued < files.size() && queued < next + depth);});
+    if (stopping)
+      return;
+    size_t i = queued ++;
+    unsigned long long gen = generation;
+    slots[i].done = false;
+    std::string data;
+    lock.unlock();
+    bool whole = read_file(files[i], data);
+    lock.lock();
+    if (gen != generation)
+      continue; // seek() happened; this file might not be wanted
+    Slot & s = slots[i];
+    s.data.swap(data);
+    s.stream = ! whole;
+    s.done = true;
+    ready.notify_all();
+  }
+};
+
+bool
+Blob_Prefetcher::read_file(const File & f, std::string & data) {
+  // gzread() passes through files which aren't compressed, such as
+  // the file still being written when the receiver's data were copied
+  data.clear();
+  if (f.size > max_blob)
+    return false;
+  gzFile gz = gzopen(f.path.c_str(), "rb");
+  if (! gz)
+    return true;
+  // read in place, into a buffer sized from the hint and grown as
+  // needed, but never beyond max_blob + 1 bytes, which is enough to
+  // tell that the file must be streamed instead
+  data.resize(std::min(std::max(f.size + 1, (size_t) 65536), max_blob + 1));
+  size_t used = 0;
+  int n;
+  while ((n = gzread(gz, & data[used], data.size() - used)) > 0) {
+    used += n;
+    if (used > max_blob) {
+      gzclose(gz);
+      data.clear();
+      return false;
+    }
+    if (used == data.size())
+      data.resize(std::min(2 * used, max_blob + 1));
+  }
+  data.resize(n < 0 ? 0 : used); // treat a corrupt file as empty
+  gzclose(gz);
+  return true;
+};
+
+bool
+Blob_Prefetcher::read_chunk() {
+  // start with the partial line left from the previous piece
+  current.swap(carry);
+  carry.clear();
+  size_t used = current.size();
+  current.resize(std::max(used + 1, max_blob));
+  int n = gzread(stream, & current[used], current.size() - used);
+  // on a decompression error, the file ends with what was read before it
+  if (n > 0)
+    used += n;
+  current.resize(used);
+  if (n <= 0 || used == 0)
+    return used > 0;
+  // keep any partial line at the end for the next piece, unless the
+  // piece is all one line
+  const char * nl = reinterpret_cast < const char * > (memrchr(current.data(), '\n', used));
+  if (nl) {
+    size_t keep = nl + 1 - current.data();
+    carry.assign(current, keep, std::string::npos);
+    current.resize(keep);
+  }
+  return true;
+};
+
+void
+Blob_Prefetcher::end_stream() {
+  if (stream)
+    gzclose(stream);
+  stream = 0;
+  carry.clear();
+};
@@ -0,0 +1,96 @@
+#ifndef BLOB_PREFETCHER_HPP
+#define BLOB_PREFETCHER_HPP
+
+#include "find_tags_common.hpp"
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+/*
+  Blob_Prefetcher - read and decompress raw receiver files ahead of
+  their use.
+
+  Given the files of a boot session, in the order they are to be
+  read, this keeps up to `depth` files beyond the current one being
+  read and decompressed (with zlib) by `depth` threads, and hands
+  their contents out in order.  With depth 0, each file is read by
+  the caller when needed.
+
+  A file whose uncompressed contents exceed `max_blob` bytes is not
+  held in memory, but streamed by the caller and handed out in pieces
+  ("chunks") of at most about `max_blob` bytes, each ending at a line
+  boundary, so that memory use is bounded regardless of file size.
+  Each piece is handed out with its offset into the file's
+  uncompressed contents; seek() can continue from such an offset.
+
+  Threads do not survive fork(), so a process other than the one
+  which created a Blob_Prefetcher must not use it, nor destroy it
+  (e.g. a time-shard worker); it can make a new one from files().
+*/
+
+class Blob_Prefetcher {
+
+public:
+
+  struct File {
+    int fileID;
+    Timestamp ts;      //!< timestamp from the file's name
+    std::string path;  //!< full path to the file in the file repo
+    size_t size;       //!< uncompressed size, from the `files` table; only a hint
+  };
+
+  Blob_Prefetcher(const std::vector < File > & files, unsigned int depth, size_t max_blob = DEFAULT_MAX_BLOB);
+
+  ~Blob_Prefetcher();
+
+  bool get(const char ** buf, int * len, const File ** f, int * offset); //!< get the contents of the next file, or the next piece of a streamed file, which remain valid until the next call; offset is set to where they begin in the file; false if there are no more files
+
+  void seek(Timestamp ts, int offset = 0); //!< continue with the first file whose timestamp is >= ts, starting offset bytes into its uncompressed contents
+
+  const std::vector < File > & get_files() { return files; };
+
+  static const size_t DEFAULT_MAX_BLOB = 64 * 1024 * 1024;
+
+protected:
+
+  std::vector < File > files;
+  unsigned int depth;
+  size_t max_blob;
+
+  struct Slot {
+    std::string data;
+    bool done;         //!< true once data has been read
+    bool stream;       //!< true if the file is too large to read whole, and must be streamed
+  };
+
+  std::mutex m;
+  std::condition_variable ready;     //!< signalled when a file has been read
+  std::condition_variable wanted;    //!< signalled when workers can read further ahead, or on shutdown
+  std::map < size_t, Slot > slots;   //!< files being read or waiting to be handed out, by index
+  size_t next;                       //!< index of next file to hand out
+  size_t queued;                     //!< index of next file for a worker to read
+  unsigned long long generation;     //!< incremented by seek(), so that workers drop files read for an earlier position
+  bool stopping;
+  std::vector < std::thread > threads;
+
+  std::string current;               //!< contents of the file or piece most recently handed out
+  int skip;                          //!< bytes to skip at the start of the next file handed out, from seek()
+
+  gzFile stream;                     //!< file being streamed, or 0
+  const File * stream_file;          //!< the file being streamed
+  int stream_offset;                 //!< offset in stream_file of the next piece
+  std::string carry;                 //!< partial line read from stream, which starts the next piece
+
+  void work();                       //!< loop run by worker threads
+
+  bool read_file(const File & f, std::string & data); //!< read and decompress a file; data is left empty on error; false if the file exceeds max_blob, and must be streamed
+
+  bool read_chunk();                 //!< read the next piece of stream into current; false at end of file
+
+  void end_stream();                 //!< close any file being streamed
+};
+
+#endif // BLOB_PREFETCHER_HPP
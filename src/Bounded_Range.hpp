@@ -9,6 +9,7 @@ template < class VALTYPE > class  Bounded_Range {
   // range.
 
   friend class Tag_Foray;
+  friend class Candidate_Archive;
 
 private:
   VALTYPE low;
@@ -68,6 +69,11 @@ public:
     return (! have_bounds) || (high - p <= width && p - low <= width);
   };
 
+  VALTYPE get_centre() {
+    // centre of current range; 0 if unbounded
+    return have_bounds ? (high + low) / 2.0 : 0;
+  };
+
   void clear_bounds() {
     have_bounds = false;
   };
@@ -0,0 +1,198 @@
+#include "CSV_Sink.hpp"
+
+#include <math.h>
+
+CSV_Sink::CSV_Sink(std::string prefix) :
+  prefix(prefix)
+{
+  for (int t = 0; t < NUM_TABLES; ++t) {
+    std::string path = prefix + names[t];
+    f[t] = fopen(path.c_str(), "wb");
+    if (! f[t])
+      throw std::runtime_error("Unable to create output file " + path);
+    buf[t].reserve(BUFFER_BYTES + MAX_LINE_SIZE);
+    buf[t] = headers[t];
+  }
+};
+
+CSV_Sink::~CSV_Sink() {
+  // files not close()d are left incomplete
+  for (int t = 0; t < NUM_TABLES; ++t)
+    if (f[t])
+      fclose(f[t]);
+};
+
+void
+CSV_Sink::put(Table t, long long v) {
+  char digits[24];
+  char * p = digits + sizeof(digits);
+  *--p = ',';
+  unsigned long long u = v < 0 ? - (unsigned long long) v : v;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (v < 0)
+    *--p = '-';
+  buf[t].append(p, digits + sizeof(digits) - p);
+};
+
+void
+CSV_Sink::put(Table t, double v, int decimals) {
+  static const double scale[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+  if (isnan(v)) {
+    buf[t].push_back(',');
+    return;
+  }
+  double s = v * scale[decimals];
+  if (! (fabs(s) < 9e18)) {
+    // too large for fixed point; rare enough to leave to printf
+    char big[32];
+    buf[t].append(big, snprintf(big, sizeof(big), "%.17g,", v));
+    return;
+  }
+  long long n = llround(s);
+  char digits[32];
+  char * p = digits + sizeof(digits);
+  *--p = ',';
+  unsigned long long u = n < 0 ? - (unsigned long long) n : n;
+  for (int i = 0; i < decimals; ++i) {
+    *--p = '0' + u % 10;
+    u /= 10;
+  }
+  if (decimals)
+    *--p = '.';
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (n < 0)
+    *--p = '-';
+  buf[t].append(p, digits + sizeof(digits) - p);
+};
+
+void
+CSV_Sink::put_quoted(Table t, const char * s) {
+  std::string & b = buf[t];
+  b.push_back('"');
+  for (; *s; ++s) {
+    if (*s == '"')
+      b.push_back('"');
+    b.push_back(*s);
+  }
+  b.append("\",");
+};
+
+void
+CSV_Sink::put_text(Table t, const char * s) {
+  buf[t].append(s);
+  buf[t].push_back(',');
+};
+
+void
+CSV_Sink::end_line(Table t) {
+  buf[t].back() = '\n';
+  if (buf[t].size() >= BUFFER_BYTES)
+    write(t);
+};
+
+void
+CSV_Sink::write(Table t) {
+  if (buf[t].size() && fwrite(buf[t].data(), buf[t].size(), 1, f[t]) != 1)
+    throw std::runtime_error("Unable to write output file " + prefix + names[t]);
+  buf[t].clear();
+};
+
+void
+CSV_Sink::add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done) {
+  put(RUNS, rid);
+  put(RUNS, rb.bid);
+  put(RUNS, rb.ts, TS_DECIMALS);
+  put(RUNS, tsEnd, TS_DECIMALS);
+  put(RUNS, done);
+  put(RUNS, rb.mid);
+  put(RUNS, rb.ant);
+  put(RUNS, len);
+  end_line(RUNS);
+};
+
+void
+CSV_Sink::add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) {
+  put(HITS, bid);
+  put(HITS, rid);
+  put(HITS, ts, TS_DECIMALS);
+  put(HITS, sig, SIG_DECIMALS);
+  put(HITS, sigSD, SIG_DECIMALS);
+  put(HITS, noise, SIG_DECIMALS);
+  put(HITS, freq, FREQ_DECIMALS);
+  put(HITS, freqSD, FREQ_DECIMALS);
+  put(HITS, slop, SLOP_DECIMALS);
+  put(HITS, burstSlop, SLOP_DECIMALS);
+  end_line(HITS);
+};
+
+void
+CSV_Sink::add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt) {
+  put(GPS, ts, TS_DECIMALS);
+  put(GPS, bid);
+  put(GPS, lat, LATLON_DECIMALS);
+  put(GPS, lon, LATLON_DECIMALS);
+  put(GPS, alt, ALT_DECIMALS);
+  end_line(GPS);
+};
+
+void
+CSV_Sink::add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count) {
+  put(PULSE_COUNTS, bid);
+  put(PULSE_COUNTS, ant);
+  put(PULSE_COUNTS, llround(hourBin));
+  put(PULSE_COUNTS, count);
+  end_line(PULSE_COUNTS);
+};
+
+void
+CSV_Sink::add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra) {
+  put(PARAMS, bid);
+  put(PARAMS, ts, TS_DECIMALS);
+  put(PARAMS, ant);
+  put_text(PARAMS, param);
+  put(PARAMS, val, PARAM_DECIMALS);
+  put(PARAMS, error);
+  put_quoted(PARAMS, extra);
+  end_line(PARAMS);
+};
+
+void
+CSV_Sink::add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p) {
+  put(PULSES, bid);
+  put(PULSES, p.ts, TS_DECIMALS);
+  put(PULSES, ant);
+  put(PULSES, p.ant_freq, MHZ_DECIMALS);
+  put(PULSES, p.dfreq, FREQ_DECIMALS);
+  put(PULSES, p.sig, SIG_DECIMALS);
+  put(PULSES, p.noise, SIG_DECIMALS);
+  end_line(PULSES);
+};
+
+void
+CSV_Sink::close() {
+  for (int t = 0; t < NUM_TABLES; ++t) {
+    write((Table) t);
+    if (fclose(f[t]))
+      throw std::runtime_error("Unable to write output file " + prefix + names[t]);
+    f[t] = 0;
+  }
+};
+
+const char *
+CSV_Sink::names[NUM_TABLES] = {"_runs.csv", "_hits.csv", "_gps.csv", "_pulseCounts.csv", "_params.csv", "_pulses.csv"};
+
+const char *
+CSV_Sink::headers[NUM_TABLES] = {
+  "runID,batchIDbegin,tsBegin,tsEnd,done,motusTagID,ant,len\n",
+  "batchID,runID,ts,sig,sigSD,noise,freq,freqSD,slop,burstSlop\n",
+  "ts,batchID,lat,lon,alt\n",
+  "batchID,ant,hourBin,count\n",
+  "batchID,ts,ant,param,val,error,errinfo\n",
+  "batchID,ts,ant,antFreq,dfreq,sig,noise\n"
+};
@@ -0,0 +1,86 @@
+#ifndef CSV_SINK_HPP
+#define CSV_SINK_HPP
+
+//!< CSV_Sink - write output to CSV files, one per table.
+//
+// For a prefix P, these files are created, each with a header line
+// naming its columns, which are those of the receiver database table
+// after which it is named:
+//
+//   P_runs.csv:        runID, batchIDbegin, tsBegin, tsEnd, done, motusTagID, ant, len
+//   P_hits.csv:        batchID, runID, ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop
+//   P_gps.csv:         ts, batchID, lat, lon, alt
+//   P_pulseCounts.csv: batchID, ant, hourBin, count
+//   P_params.csv:      batchID, ts, ant, param, val, error, errinfo
+//   P_pulses.csv:      batchID, ts, ant, antFreq, dfreq, sig, noise
+//
+// A run is written when it ends, or when the batch does.  Lines are
+// formatted into a buffer for each file, which is written once it
+// holds BUFFER_BYTES.
+//
+// Numbers are formatted here, rather than by printf or iostreams, so
+// that output costs little and doesn't depend on the locale.  Real
+// values are written with a fixed number of decimal places, as given
+// by the *_DECIMALS constants below; a missing (NaN) value is written
+// as an empty field.
+
+#include "Output_Sink.hpp"
+
+#include <stdio.h>
+
+class CSV_Sink : public Output_Sink {
+
+public:
+  CSV_Sink(std::string prefix); //!< create the files, replacing any existing ones
+  ~CSV_Sink();
+
+  void add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop);
+
+  void add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt);
+
+  void add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count);
+
+  void add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra);
+
+  void add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p);
+
+  void close();
+
+  static const size_t BUFFER_BYTES = 1 << 20;
+
+  static const int TS_DECIMALS     = 6; //!< timestamps
+  static const int SIG_DECIMALS    = 3; //!< signal and noise, in dB
+  static const int FREQ_DECIMALS   = 4; //!< frequency offsets, in kHz
+  static const int MHZ_DECIMALS    = 6; //!< antenna frequencies, in MHz
+  static const int SLOP_DECIMALS   = 6; //!< slop and burst slop
+  static const int LATLON_DECIMALS = 7; //!< GPS latitude and longitude
+  static const int ALT_DECIMALS    = 2; //!< GPS altitude
+  static const int PARAM_DECIMALS  = 6; //!< receiver parameter values
+
+protected:
+
+  typedef enum {RUNS = 0, HITS, GPS, PULSE_COUNTS, PARAMS, PULSES, NUM_TABLES} Table;
+
+  static const char * names[NUM_TABLES];   //!< file name suffixes
+  static const char * headers[NUM_TABLES]; //!< header lines
+
+  std::string prefix;
+  FILE * f[NUM_TABLES];
+  std::string buf[NUM_TABLES]; //!< formatted lines not yet written
+
+  void add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done);
+
+  // each of these adds a field, followed by a comma, to the line being
+  // formatted in t's buffer
+
+  void put(Table t, long long v); //!< integer
+  void put(Table t, double v, int decimals); //!< real, rounded to decimals places
+  void put_quoted(Table t, const char * s); //!< text, in double quotes
+  void put_text(Table t, const char * s); //!< text, as is
+
+  void end_line(Table t); //!< end the line being formatted in t's buffer, and write the buffer if full
+
+  void write(Table t); //!< write t's buffer
+};
+
+#endif // CSV_SINK_HPP
@@ -0,0 +1,307 @@
+#include "Candidate_Archive.hpp"
+
+#include <string.h>
+#include <stddef.h>
+
+// records are used in place, so their layout must not change silently
+static_assert(sizeof(Candidate_Archive::Header) == 32, "Candidate_Archive::Header has wrong size");
+static_assert(sizeof(Candidate_Archive::Trailer) == 24, "Candidate_Archive::Trailer has wrong size");
+static_assert(sizeof(Candidate_Archive::Finder_Record) == 8, "Candidate_Archive::Finder_Record has wrong size");
+static_assert(sizeof(Candidate_Archive::Node_Record) == 8, "Candidate_Archive::Node_Record has wrong size");
+static_assert(sizeof(Candidate_Archive::Phase_Record) == 8, "Candidate_Archive::Phase_Record has wrong size");
+static_assert(sizeof(Candidate_Archive::Cand_Record) == 96, "Candidate_Archive::Cand_Record has wrong size");
+static_assert(sizeof(Candidate_Archive::Pulse_Record) == sizeof(Pulse)
+              && offsetof(Candidate_Archive::Pulse_Record, ts) == offsetof(Pulse, ts)
+              && offsetof(Candidate_Archive::Pulse_Record, dfreq) == offsetof(Pulse, dfreq)
+              && offsetof(Candidate_Archive::Pulse_Record, ant_freq) == offsetof(Pulse, ant_freq)
+              && offsetof(Candidate_Archive::Pulse_Record, sig) == offsetof(Pulse, sig)
+              && offsetof(Candidate_Archive::Pulse_Record, noise) == offsetof(Pulse, noise)
+              && offsetof(Candidate_Archive::Pulse_Record, seq_no) == offsetof(Pulse, seq_no),
+              "Candidate_Archive::Pulse_Record must be laid out like Pulse");
+
+static void
+get(std::streambuf & sb, void * p, size_t n) {
+  if (sb.sgetn((char *) p, n) != (std::streamsize) n)
+    throw std::runtime_error("Saved candidates are incomplete");
+};
+
+Candidate_Archive::Candidate_Archive(Finder_Map & finders) :
+  finders(finders),
+  nTags(0)
+{
+};
+
+int32_t
+Candidate_Archive::index_tag(Tag * t) {
+  if (t == BOGUS_TAG)
+    return -1;
+  // most lookups find an index, and insert() would allocate a map node
+  // for each before finding that out
+  auto f = tag_index.find(t);
+  if (f != tag_index.end())
+    return f->second;
+  auto i = tag_index.insert(std::make_pair(t, (int32_t) tags.size()));
+  if (i.second)
+    tags.push_back(t);
+  return i.first->second;
+};
+
+uint32_t
+Candidate_Archive::index_node(Node * n) {
+  auto f = node_index.find(n);
+  if (f != node_index.end())
+    return f->second;
+  auto i = node_index.insert(std::make_pair(n, (uint32_t) nodes.size()));
+  if (i.second)
+    nodes.push_back(n);
+  return i.first->second;
+};
+
+void
+Candidate_Archive::flush(std::streambuf & sb) {
+  if (sb.sputn(buf.data(), buf.size()) != (std::streamsize) buf.size())
+    throw std::runtime_error("Unable to write saved candidates");
+  buf.clear();
+};
+
+void
+Candidate_Archive::prefetch_pulses(Tag_Candidate * tc) {
+  const char * p = (const char *) tc->pulses.data();
+  for (size_t i = 0; i < tc->pulses.size() * sizeof(Pulse); i += 64)
+    __builtin_prefetch(p + i);
+};
+
+void
+Candidate_Archive::write(std::streambuf & sb) {
+  buf.reserve(2 * BUFFER_BYTES);
+
+  Header h;
+  memset(& h, 0, sizeof(h));
+  memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.byte_order = BYTE_ORDER_MARK;
+  h.nFinders = finders.size();
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi)
+    for (auto cl = tfi->second->cands.begin(); cl != tfi->second->cands.end(); ++cl)
+      h.nCands += cl->size();
+  put(sb, h);
+
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi) {
+    Finder_Record fr = {tfi->first.first, 0, tfi->first.second};
+    put(sb, fr);
+  }
+
+  // candidates, and their pulses, are scattered through the heap, so
+  // walking the lists is bound by memory latency; the candidates
+  // PREFETCH_CANDS ahead, and the pulses of those PREFETCH_PULSES
+  // ahead, are fetched while earlier ones are written
+
+  uint64_t nPulses = 0;
+  uint32_t finder = 0;
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi, ++finder) {
+    Cand_List_Vec & cands = tfi->second->cands;
+    for (size_t list = 0; list < cands.size(); ++list) {
+      auto end = cands[list].end();
+      auto cand_ahead = cands[list].begin(), pulses_ahead = cand_ahead;
+      for (int k = 0; k < PREFETCH_CANDS && cand_ahead != end; ++k, ++cand_ahead)
+        __builtin_prefetch(cand_ahead->second);
+      for (int k = 0; k < PREFETCH_PULSES && pulses_ahead != end; ++k, ++pulses_ahead)
+        prefetch_pulses(pulses_ahead->second);
+      for (auto ci = cands[list].begin(); ci != end; ++ci) {
+        if (cand_ahead != end)
+          __builtin_prefetch((cand_ahead++)->second);
+        if (pulses_ahead != end)
+          prefetch_pulses((pulses_ahead++)->second);
+        Tag_Candidate * tc = ci->second;
+        Pulse_Buffer & pulses = tc->pulses;
+        Cand_Record cr;
+        memset(& cr, 0, sizeof(cr));
+        cr.key = ci->first;
+        cr.last_ts = tc->last_ts;
+        cr.last_dumped_ts = tc->last_dumped_ts;
+        cr.freq_low = tc->freq_range.low;
+        cr.freq_high = tc->freq_range.high;
+        cr.freq_width = tc->freq_range.width;
+        cr.sig_low = tc->sig_range.low;
+        cr.sig_high = tc->sig_range.high;
+        cr.sig_width = tc->sig_range.width;
+        cr.run_id = tc->run_id;
+        cr.hit_count = tc->hit_count;
+        cr.tag = index_tag(tc->tag);
+        cr.node = index_node(tc->state);
+        cr.finder = finder;
+        cr.nPulses = pulses.size();
+        cr.num_pulses = tc->num_pulses;
+        cr.list = list;
+        cr.tag_id_level = tc->tag_id_level;
+        cr.freq_have_bounds = tc->freq_range.have_bounds;
+        cr.sig_have_bounds = tc->sig_range.have_bounds;
+        buf.append((const char *) & cr, sizeof(cr));
+
+        // pulses are copied as a block, then their padding is cleared so
+        // the output doesn't depend on uninitialized bytes
+        size_t at = buf.size();
+        buf.append((const char *) pulses.data(), pulses.size() * sizeof(Pulse_Record));
+        for (auto pr = (Pulse_Record *) & buf[at]; pr != (Pulse_Record *) & buf[buf.size()]; ++pr)
+          pr->pad = 0;
+        nPulses += pulses.size();
+        if (buf.size() >= BUFFER_BYTES)
+          flush(sb);
+      }
+    }
+  }
+
+  // tags only used by nodes get indexes too, so the phases are found
+  // before the trailer, which gives the number of tags, is written
+
+  std::vector < Phase_Record > prs;
+  for (auto n = nodes.begin(); n != nodes.end(); ++n) {
+    TagPhaseSet & tps = (*n)->s->s;
+    for (auto p = tps.begin(); p != tps.end(); ++p) {
+      Phase_Record pr = {index_tag(p->first), p->second};
+      prs.push_back(pr);
+    }
+  }
+
+  Trailer t;
+  memset(& t, 0, sizeof(t));
+  t.nNodes = nodes.size();
+  t.nPhases = prs.size();
+  t.nTags = tags.size();
+  t.nPulses = nPulses;
+  put(sb, t);
+
+  for (auto n = nodes.begin(); n != nodes.end(); ++n) {
+    Node_Record nr = {(uint32_t) (*n)->s->s.size(), (*n)->_valid, {0}};
+    put(sb, nr);
+  }
+  for (auto pr = prs.begin(); pr != prs.end(); ++pr)
+    put(sb, *pr);
+  flush(sb);
+};
+
+void
+Candidate_Archive::read(std::streambuf & sb) {
+  Header h;
+  get(sb, & h, sizeof(h));
+  if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) || h.version != VERSION)
+    throw std::runtime_error("Saved candidates have an unknown format");
+  if (h.byte_order != BYTE_ORDER_MARK)
+    throw std::runtime_error("Saved candidates are from a host with a different byte order");
+
+  std::vector < Tag_Finder * > tfs;
+  for (uint32_t i = 0; i < h.nFinders; ++i) {
+    Finder_Record fr;
+    get(sb, & fr, sizeof(fr));
+    auto tfi = finders.find(Finder_Key(fr.port, fr.nom_freq));
+    if (tfi == finders.end())
+      throw std::runtime_error("Saved candidates don't match the saved Tag_Finders");
+    // a Tag_Finder's candidates aren't serialized with the rest of it
+    tfi->second->cands.resize(Tag_Finder::NUM_CAND_LISTS);
+    tfs.push_back(tfi->second);
+  }
+
+  tcs.reserve(h.nCands);
+  cand_tags.reserve(h.nCands);
+  cand_nodes.reserve(h.nCands);
+  uint64_t nPulses = 0;
+  for (uint64_t i = 0; i < h.nCands; ++i) {
+    Cand_Record cr;
+    get(sb, & cr, sizeof(cr));
+    if (cr.finder >= h.nFinders || cr.list >= Tag_Finder::NUM_CAND_LISTS)
+      throw std::runtime_error("Saved candidates are corrupt");
+    Tag_Finder * tf = tfs[cr.finder];
+
+    Tag_Candidate * tc = new Tag_Candidate();
+    tc->owner = tf;
+    tc->pulses.resize(cr.nPulses);
+    get(sb, tc->pulses.data(), cr.nPulses * sizeof(Pulse_Record));
+    nPulses += cr.nPulses;
+    tc->last_ts = cr.last_ts;
+    tc->last_dumped_ts = cr.last_dumped_ts;
+    tc->tag_id_level = (Tag_Candidate::Tag_ID_Level) cr.tag_id_level;
+    tc->run_id = cr.run_id;
+    tc->hit_count = cr.hit_count;
+    tc->num_pulses = cr.num_pulses;
+    tc->freq_range.low = cr.freq_low;
+    tc->freq_range.high = cr.freq_high;
+    tc->freq_range.width = cr.freq_width;
+    tc->freq_range.have_bounds = cr.freq_have_bounds;
+    tc->sig_range.low = cr.sig_low;
+    tc->sig_range.high = cr.sig_high;
+    tc->sig_range.width = cr.sig_width;
+    tc->sig_range.have_bounds = cr.sig_have_bounds;
+    tcs.push_back(tc);
+    cand_tags.push_back(cr.tag);
+    cand_nodes.push_back(cr.node);
+
+    // candidates were written in list order, so appending keeps the
+    // order of those with equal keys
+    Cand_List & cl = tf->cands[cr.list];
+    cl.insert(cl.end(), std::make_pair(cr.key, tc));
+  }
+
+  Trailer t;
+  get(sb, & t, sizeof(t));
+  if (t.nPulses != nPulses)
+    throw std::runtime_error("Saved candidates are corrupt");
+  node_recs.resize(t.nNodes);
+  get(sb, node_recs.data(), t.nNodes * sizeof(Node_Record));
+  phase_recs.resize(t.nPhases);
+  get(sb, phase_recs.data(), t.nPhases * sizeof(Phase_Record));
+  nTags = t.nTags;
+};
+
+void
+Candidate_Archive::restore() {
+  if (nTags != tags.size())
+    throw std::runtime_error("Saved candidates don't match the saved tags");
+
+  auto tag = [&](int32_t i) {
+    if (i >= (int32_t) tags.size())
+      throw std::runtime_error("Saved candidates are corrupt");
+    return i < 0 ? BOGUS_TAG : tags[i];
+  };
+
+  std::vector < uint32_t > first_phase;
+  uint32_t np = 0;
+  for (auto nr = node_recs.begin(); nr != node_recs.end(); ++nr) {
+    first_phase.push_back(np);
+    np += nr->nPhases;
+  }
+  if (np != phase_recs.size())
+    throw std::runtime_error("Saved candidates are corrupt");
+
+  // nodes are looked up in the rebuilt graph of the first candidate to
+  // use them; a node is only ever in one graph
+  std::vector < Node * > nodes(node_recs.size(), (Node *) 0);
+
+  for (size_t i = 0; i < tcs.size(); ++i) {
+    Tag_Candidate * tc = tcs[i];
+    if (i + PREFETCH_CANDS < tcs.size())
+      __builtin_prefetch(tcs[i + PREFETCH_CANDS]);
+    uint32_t ni = cand_nodes[i];
+    if (ni >= nodes.size())
+      throw std::runtime_error("Saved candidates are corrupt");
+    Node * & n = nodes[ni];
+    if (! n) {
+      const Node_Record & nr = node_recs[ni];
+      Node * p = new Node();
+      p->_valid = nr.valid;
+      if (nr.nPhases) {
+        p->s = new Set();
+        for (uint32_t j = first_phase[ni]; j < first_phase[ni] + nr.nPhases; ++j)
+          p->s->augment(TagPhase(tag(phase_recs[j].tag), phase_recs[j].phase));
+      }
+      n = tc->owner->graph->restoreNode(p);
+      if (n != p)
+        p->drop();
+    }
+    tc->state = n;
+    n->tcLink();
+    tc->tag = tag(cand_tags[i]);
+  }
+};
+
+const char
+Candidate_Archive::MAGIC[8] = {'F', 'T', 'C', 'A', 'N', 'D', 'S', '1'};
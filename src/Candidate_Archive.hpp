@@ -0,0 +1,168 @@
+#ifndef CANDIDATE_ARCHIVE_HPP
+#define CANDIDATE_ARCHIVE_HPP
+
+//!< Candidate_Archive - save and restore the Tag_Candidates of a
+// foray's Tag_Finders as flat arrays of fixed-size records.
+//
+// Tag_Foray::pause() writes the candidates this way, between parts of
+// the boost-serialized state, rather than through the boost archive:
+// there can be millions of candidates, and boost's tracking of each
+// Tag_Candidate, Node and Tag pointer makes that slow.  Instead,
+// records refer to tags and graph nodes by index.  A node is
+// identified by its set of tag phases, as for Graph::restoreNode().
+//
+// Candidates are visited once, and indexes are assigned to their tags
+// and nodes as their records are written, so the tables of nodes and
+// their phases follow the candidates.  The tags are the only pointers
+// shared with the rest of the state, so the list of them is serialized
+// with that, after write() (see tags, below).
+//
+// Loading creates each candidate, with its pulses, as its records are
+// read, and puts it in its Tag_Finder.  Once the tags have been
+// deserialized, restore() points the candidates to them and to nodes
+// of the rebuilt graphs.
+//
+// ## Format (version 2; all values in native byte order, which is
+//    little-endian on every host find_tags runs on; BYTE_ORDER_MARK
+//    lets a reader detect otherwise)
+//
+//   header:  Header, as below
+//   finders: Finder_Record[nFinders]  Tag_Finders, in key order
+//   cands:   nCands times:            candidates, finder by finder, and in
+//              Cand_Record            each, list by list, in list order
+//              Pulse_Record[nPulses]  the candidate's pulses
+//   trailer: Trailer, as below
+//   nodes:   Node_Record[nNodes]
+//   phases:  Phase_Record[nPhases]    tag phases of all nodes, node by node
+//
+// Every record is a multiple of 8 bytes, so each array is aligned.
+
+#include "find_tags_common.hpp"
+#include "Tag_Finder.hpp"
+
+#include <streambuf>
+
+class Candidate_Archive {
+
+public:
+  typedef std::pair < Port_Num, Nominal_Frequency_kHz > Finder_Key;
+  typedef std::map < Finder_Key, Tag_Finder * > Finder_Map;
+
+  Candidate_Archive(Finder_Map & finders); //!< archive for the candidates of finders
+
+  std::vector < Tag * > tags; //!< tags referred to by records, by index; complete once write() returns,
+  // when the caller serializes it with the rest of the state; the caller deserializes it between read() and restore()
+
+  void write(std::streambuf & sb); //!< write the candidates, and the nodes they use
+
+  void read(std::streambuf & sb); //!< read candidates into finders; they are not usable until restore()
+
+  void restore(); //!< point the candidates read to tags, and to nodes of their finders' graphs, which must have been rebuilt
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 2;
+  static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+  struct Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;  //!< BYTE_ORDER_MARK
+    uint32_t nFinders;
+    uint32_t pad;
+    uint64_t nCands;
+  };
+
+  struct Trailer {
+    uint32_t nNodes;
+    uint32_t nPhases;
+    uint32_t nTags;       //!< size of tags, as a check
+    uint32_t pad;
+    uint64_t nPulses;     //!< total of the candidates' nPulses, as a check
+  };
+
+  struct Finder_Record {
+    int16_t  port;
+    int16_t  pad;
+    int32_t  nom_freq;
+  };
+
+  struct Node_Record {
+    uint32_t nPhases;     //!< number of this node's phases; they follow those of the previous node
+    uint8_t  valid;       //!< is the node part of its graph?
+    uint8_t  pad[3];
+  };
+
+  struct Phase_Record {
+    int32_t  tag;         //!< index into tags
+    int32_t  phase;
+  };
+
+  struct Cand_Record {
+    double   key;         //!< key in its Cand_List
+    double   last_ts;
+    double   last_dumped_ts;
+    double   freq_low, freq_high, freq_width;
+    float    sig_low, sig_high, sig_width;
+    int32_t  run_id;
+    uint32_t hit_count;
+    int32_t  tag;         //!< index into tags, or -1 for BOGUS_TAG
+    uint32_t node;        //!< index into nodes
+    uint32_t finder;      //!< index into finders
+    uint32_t nPulses;     //!< number of this candidate's pulses; they follow those of the previous candidate
+    uint16_t num_pulses;
+    uint8_t  list;        //!< which of its finder's Cand_Lists holds it
+    uint8_t  tag_id_level;
+    uint8_t  freq_have_bounds;
+    uint8_t  sig_have_bounds;
+    uint8_t  pad[6];
+  };
+
+  struct Pulse_Record {    //!< laid out like a Pulse, so pulses are read straight into a Pulse_Buffer
+    double   ts;
+    float    dfreq;
+    uint32_t pad;
+    double   ant_freq;
+    float    sig;
+    float    noise;
+    int64_t  seq_no;
+  };
+
+protected:
+  Finder_Map & finders;
+
+  // for writing
+  std::unordered_map < Tag *, int32_t > tag_index;
+  std::unordered_map < Node *, uint32_t > node_index;
+  std::vector < Node * > nodes; //!< nodes, by index
+
+  // for reading; candidates aren't usable until restore()
+  std::vector < Tag_Candidate * > tcs;    //!< candidates, in the order read
+  std::vector < int32_t > cand_tags;      //!< index of each candidate's tag
+  std::vector < uint32_t > cand_nodes;    //!< index of each candidate's node
+  std::vector < Node_Record > node_recs;
+  std::vector < Phase_Record > phase_recs;
+  uint32_t nTags;                         //!< size of tags when written
+
+  std::string buf; //!< records not yet written
+
+  int32_t index_tag(Tag * t); //!< return the index of t in tags, adding it if necessary; -1 for BOGUS_TAG
+
+  uint32_t index_node(Node * n); //!< return the index of n in nodes, adding it if necessary
+
+  template < typename T >
+  void put(std::streambuf & sb, const T & rec) { //!< add a record, writing buf when it's full
+    buf.append((const char *) & rec, sizeof(rec));
+    if (buf.size() >= BUFFER_BYTES)
+      flush(sb);
+  };
+
+  void flush(std::streambuf & sb); //!< write buf
+
+  void prefetch_pulses(Tag_Candidate * tc); //!< start fetching the pulses of tc into cache
+
+  static const size_t BUFFER_BYTES = 1 << 20;
+  static const int PREFETCH_CANDS = 8;  //!< how far ahead of the candidate being written or restored to fetch candidates
+  static const int PREFETCH_PULSES = 4; //!< how far ahead of the candidate being written to fetch pulses
+};
+
+#endif // CANDIDATE_ARCHIVE_HPP
@@ -1,21 +1,25 @@
 #include "Clock_Repair.hpp"
+#include "Record_Pipe.hpp"
 
-Clock_Repair::Clock_Repair() {
+Clock_Repair::Clock_Repair() :
+  upstream(0)
+{
   init();
 };
 
 Clock_Repair::Clock_Repair(Data_Source *data, unsigned long long *line_no, DB_Filer * filer, Timestamp tol) :
   data(data),
+  upstream(dynamic_cast < Record_Pipe * > (data)),
   line_no(line_no),
   filer(filer),
   tol(tol),
   cp(),
   gpsv(),
+  spool(spool_mem),
   GPSstuck(false),
   correcting(false),
   offset(0.0),
-  offsetError(0.0),
-  buf()
+  offsetError(0.0)
 {
   init();
 };
@@ -34,8 +38,11 @@ Clock_Repair::handle( SG_Record & r) {
 
   // run it past the GPS validator, to look for a stuck GPS
 
-  if (r.type == SG_Record::PULSE || r.type == SG_Record::GPS) {
-    GPSstuck = gpsv.accept(r.ts, r.type == SG_Record::PULSE);
+  // a detection stands for the pulses of a burst
+  bool pulse = r.type == SG_Record::PULSE || r.type == SG_Record::DETECTION;
+
+  if (pulse || r.type == SG_Record::GPS) {
+    GPSstuck = gpsv.accept(r.ts, pulse);
 
     // skip stuck GPS records
     if (GPSstuck && r.type == SG_Record::GPS)
@@ -58,7 +65,7 @@ Clock_Repair::handle( SG_Record & r) {
   // monotonic or pre-GPS timestamps, so we have to use whatever
   // correction is available to this point
 
-  if (r.type == SG_Record::PULSE && isValid(r.ts)) {
+  if (pulse && isValid(r.ts)) {
     cp.force_estimate();
     got_estimate();
   }
@@ -79,34 +86,53 @@ Clock_Repair::got_estimate() {
 // if no records are available, return false.
 bool
 Clock_Repair::read_record(SG_Record & r) {
-  while (data->getline(buf, MAX_LINE_SIZE)) {
+  if (data->has_records()) {
+    // already parsed
+    while (data->next_record(r)) {
+      ++ *line_no;
+      if (! too_late(r))
+        return true;
+    }
+    return false;
+  }
+  const char * line;
+  int len;
+  while (data->next_line(& line, & len)) {
     ++ *line_no;
-    r.from_buf(buf);
+    // truncate to max permitted line size; we silently discard the remainder
+    len = std::min(len, (int) MAX_LINE_SIZE);
+    r.from_chars(line, line + len);
     if (r.type == SG_Record::BAD) {
       if (++num_bad_line_warnings <= MAX_BAD_LINE_WARNINGS ) {
-        std::cerr << "Warning: malformed line in input\n  at line " << * line_no << ":\n" << (string("") + buf) << std::endl;
+        std::cerr << "Warning: malformed line in input\n  at line " << * line_no << ":\n" << string(line, len) << std::endl;
         if (num_bad_line_warnings == MAX_BAD_LINE_WARNINGS)
           std::cerr << "(skipping further warnings about this)" << std::endl;
       }
       continue;
     }
-    if (r.ts > max_ts
-        || (isMonotonic(r.ts) && r.ts + TS_BEAGLEBONE_BOOT > max_ts)
-        || (isPreGPS(r.ts) && offset > 0.0 && r.ts + offset > max_ts)) {
-      // timestamp too large!
+    if (too_late(r))
       continue;
-    }
     return true;
   }
   return false;
 };
 
+bool
+Clock_Repair::too_late(const SG_Record & r) {
+  return r.ts > max_ts
+    || (isMonotonic(r.ts) && r.ts + TS_BEAGLEBONE_BOOT > max_ts)
+    || (isPreGPS(r.ts) && offset > 0.0 && r.ts + offset > max_ts);
+};
+
 bool
 Clock_Repair::get(SG_Record &r) {
 //!< get the next record available for processing, correct its
 // timestamp if necessary, and return true.  if no records are
 // available, return false.
 
+  if (upstream)
+    return upstream->get(r, filer);
+
   if (! correcting) {
   // process records until we can correct
     while (!correcting) {
@@ -116,13 +142,23 @@ Clock_Repair::get(SG_Record &r) {
         got_estimate();
         break;
       }
+      // keep the record as read, for replay once we can correct it
+      spool.put(r);
       handle(r);
     }
     filer->add_time_fix(TS_BEAGLEBONE_BOOT, TS_SG_EPOCH, offset, offsetError, 'S');
-    data->rewind();
+    for (auto i = tees.begin(); i != tees.end(); ++i)
+      (*i)->put_time_fix(TS_BEAGLEBONE_BOOT, TS_SG_EPOCH, offset, offsetError, 'S');
+    spool.start_replay();
     GPSstuck = false;  // on next round, unstick GPS so we get initial run of non-stuck records
   }
-  if (! read_record(r))
+  // replay spooled records before reading more; now that the offset
+  // is known, some might turn out to have too large a timestamp
+  bool have;
+  do
+    have = spool.get(r);
+  while (have && too_late(r));
+  if (! have && ! read_record(r))
     return false;
   if (isMonotonic(r.ts))
     // always correct monotonic timestamps to pre-GPS
@@ -131,15 +167,60 @@ Clock_Repair::get(SG_Record &r) {
   if (isPreGPS(r.ts))
     // correct the pre-GPS timestamps
     r.ts += offset;
+
+  if (tees.size())
+    tee(r);
   return true;
 };
 
+void
+Clock_Repair::tee(const SG_Record & r) {
+  for (auto i = tees.begin(); i != tees.end(); ) {
+    if ((*i)->put(r)) {
+      ++i;
+    } else {
+      std::cerr << "Warning: lost a parameter sweep configuration; no longer sending it records" << std::endl;
+      delete *i;
+      i = tees.erase(i);
+    }
+  }
+};
+
+void
+Clock_Repair::seek_file(Timestamp ts) {
+  spool.clear();
+  data->seek_file(ts);
+};
+
+void
+Clock_Repair::set_spool_mem(size_t bytes) {
+  spool_mem = bytes;
+};
+
+void
+Clock_Repair::add_tee(Record_Pipe * p) {
+  tees.push_back(p);
+};
+
+void
+Clock_Repair::close_tees() {
+  for (auto i = tees.begin(); i != tees.end(); ++i)
+    delete *i;
+  tees.clear();
+};
+
 Timestamp
 Clock_Repair::max_ts = 0;
 
+size_t
+Clock_Repair::spool_mem = Record_Spool::DEFAULT_MAX_MEM;
+
 int
 Clock_Repair::num_bad_line_warnings = 0;
 
+std::vector < Record_Pipe * >
+Clock_Repair::tees;
+
 double
 time_now() {
   struct timespec tsp;
@@ -7,6 +7,9 @@
 #include "Clock_Pinner.hpp"
 #include "GPS_Validator.hpp"
 #include "Data_Source.hpp"
+#include "Record_Spool.hpp"
+
+class Record_Pipe;
 
 class Clock_Repair {
 
@@ -14,7 +17,7 @@ class Clock_Repair {
 //
 //   This class accepts a sequence of records from raw SG data files, and tries
 //   to correct faulty timestamps.  When a reasonably good correction is possible,
-//   the data source is rewound and timestamps are corrected before the
+//   the records read so far are replayed, and timestamps are corrected before the
 //   records are returned to the instance's user.
 //
 //   This class would not be necessary if the SG on-board software and the GPS
@@ -116,9 +119,12 @@ class Clock_Repair {
 //        - splits up clock fixing logic between Clock_Repair and Tag_Foray
 //        - need to implement restarts on data sources
 //
-// To avoid arbitrarily large buffer sizes, we went with a slightly hybrid
-// version of the two choices above.  We use rewinds() but keep all
-// clock fixing logic in this class.
+// To avoid arbitrarily large buffer sizes, we first went with a slightly hybrid
+// version of the two choices above, using rewinds() but keeping all
+// clock fixing logic in this class.  Now, we buffer instead, but in a
+// Record_Spool, which holds parsed records compactly and spills them
+// to a temporary file beyond a memory limit, so that input is only
+// decoded once, and can come from a pipe.
 
 public:
 
@@ -132,6 +138,20 @@ public:
   // if no (corrected) records are available, return false.
   bool get(SG_Record &r);
 
+  //!< copy all records returned by get() to a pipe; used for parameter sweeps
+  static void add_tee(Record_Pipe * p);
+
+  //!< close all pipes added by add_tee()
+  static void close_tees();
+
+  //!< continue from the start of the first file with timestamp >= ts,
+  // dropping any records not yet replayed; used by time shards
+  void seek_file(Timestamp ts);
+
+  //!< set how many bytes of records awaiting a clock fix are held in
+  // memory, rather than in a temporary file
+  static void set_spool_mem(size_t bytes);
+
 protected:
 
   //!< indicate there are no more input records
@@ -143,6 +163,9 @@ protected:
   //!< try read a record from the data source
   bool read_record( SG_Record & r);
 
+  //!< is the timestamp of a record too large, even after correction?
+  bool too_late(const SG_Record & r);
+
   typedef enum {  // sources of timestamps (i.e. what kind of record in the raw file)
     TSS_PULSE = 0,  // pulse record
     TSS_GPS   = 1,  // GPS record
@@ -165,11 +188,13 @@ protected:
   bool isPreGPS(Timestamp ts) { return ts >= TS_BEAGLEBONE_BOOT && ts < TS_SG_EPOCH; } //!< is timestamp in PRE_GPS era?
 
   Data_Source *data; //!< data source we get records from
+  Record_Pipe *upstream; //!< if not 0, data is a pipe of records already repaired by another process
   unsigned long long *line_no; //!< pointer to line number so we can update it
   DB_Filer * filer;   //!< for filing time corrections
   Timestamp tol;  //!< maximum allowed error (seconds) in correcting timestamps
   Clock_Pinner cp;    //!< for pinning CLOCK_PRE_GPS to CLOCK_REALTIME
   GPS_Validator gpsv; //!< for detecting a stuck GPS
+  Record_Spool spool; //!< records read before a correction was available, to be replayed
 
   bool GPSstuck; // true iff we see the GPS is stuck, as determined by the GPS_Validator class
   bool correcting; //!< true if we're able to correct records
@@ -177,13 +202,17 @@ protected:
   Timestamp offset;
   Timestamp offsetError;
 
-  char buf[MAX_LINE_SIZE + 1]; //!< input buffer
-
   //!< are pulses using CLOCK_MONOTONIC?
   bool clock_monotonic();
 
   static Timestamp max_ts; //!< maximum valid timestamp; records with larger timestamps are ignored.
 
+  static size_t spool_mem; //!< bytes of spooled records held in memory
+
+  static std::vector < Record_Pipe * > tees; //!< pipes to which records are copied
+
+  void tee(const SG_Record & r); //!< copy a record to all tees, dropping any which are broken
+
   static constexpr int MAX_BAD_LINE_WARNINGS = 5; // maximum number of bad line warnings to issue
   static int num_bad_line_warnings; // number of bad line warnings issued
 
@@ -0,0 +1,140 @@
+#include "Columnar_Sink.hpp"
+
+#include <zlib.h>
+
+Columnar_Sink::Columnar_Sink(std::string path) :
+  f(fopen(path.c_str(), "wb")),
+  path(path)
+{
+  if (! f)
+    throw std::runtime_error("Unable to create output file " + path);
+  uint32_t hdr[2] = {VERSION, 0};
+  fwrite(MAGIC, sizeof(MAGIC), 1, f);
+  fwrite(hdr, sizeof(hdr), 1, f);
+  for (int t = 0; t < NUM_TABLES; ++t) {
+    blocks[t].cols.resize(num_cols[t]);
+    blocks[t].rows = 0;
+  }
+};
+
+Columnar_Sink::~Columnar_Sink() {
+  // a file not close()d is left incomplete
+  if (f)
+    fclose(f);
+};
+
+void
+Columnar_Sink::add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done) {
+  put(RUNS, 0, (int32_t) rid);
+  put(RUNS, 1, (int32_t) rb.bid);
+  put(RUNS, 2, (double) rb.ts);
+  put(RUNS, 3, (double) tsEnd);
+  put(RUNS, 4, (int32_t) done);
+  put(RUNS, 5, (int32_t) rb.mid);
+  put(RUNS, 6, (int32_t) rb.ant);
+  put(RUNS, 7, (int32_t) len);
+  end_row(RUNS);
+};
+
+void
+Columnar_Sink::add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) {
+  put(HITS, 0, (int32_t) bid);
+  put(HITS, 1, (int32_t) rid);
+  put(HITS, 2, ts);
+  put(HITS, 3, sig);
+  put(HITS, 4, sigSD);
+  put(HITS, 5, noise);
+  put(HITS, 6, freq);
+  put(HITS, 7, freqSD);
+  put(HITS, 8, slop);
+  put(HITS, 9, burstSlop);
+  end_row(HITS);
+};
+
+void
+Columnar_Sink::add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt) {
+  put(GPS, 0, ts);
+  put(GPS, 1, (int32_t) bid);
+  put(GPS, 2, lat);
+  put(GPS, 3, lon);
+  put(GPS, 4, alt);
+  end_row(GPS);
+};
+
+void
+Columnar_Sink::add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count) {
+  put(PULSE_COUNTS, 0, (int32_t) bid);
+  put(PULSE_COUNTS, 1, (int32_t) ant);
+  put(PULSE_COUNTS, 2, hourBin);
+  put(PULSE_COUNTS, 3, (int32_t) count);
+  end_row(PULSE_COUNTS);
+};
+
+void
+Columnar_Sink::add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra) {
+  put(PARAMS, 0, (int32_t) bid);
+  put(PARAMS, 1, (double) ts);
+  put(PARAMS, 2, (int32_t) ant);
+  put(PARAMS, 3, param);
+  put(PARAMS, 4, val);
+  put(PARAMS, 5, (int32_t) error);
+  put(PARAMS, 6, extra);
+  end_row(PARAMS);
+};
+
+void
+Columnar_Sink::add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p) {
+  put(PULSES, 0, (int32_t) bid);
+  put(PULSES, 1, p.ts);
+  put(PULSES, 2, (int32_t) ant);
+  put(PULSES, 3, (double) p.ant_freq);
+  put(PULSES, 4, (float) p.dfreq);
+  put(PULSES, 5, p.sig);
+  put(PULSES, 6, p.noise);
+  end_row(PULSES);
+};
+
+void
+Columnar_Sink::end_row(Table t) {
+  if (++ blocks[t].rows == BLOCK_ROWS)
+    write_block(t);
+};
+
+void
+Columnar_Sink::write_block(Table t) {
+  Block & b = blocks[t];
+  if (b.rows == 0)
+    return;
+  raw.clear();
+  for (auto & c : b.cols) {
+    uint32_t n = c.size();
+    raw.append((const char *) & n, sizeof(n));
+    raw.append(c);
+    c.clear();
+  }
+  uLongf zlen = compressBound(raw.size());
+  z.resize(zlen);
+  if (Z_OK != compress2((Bytef *) & z[0], & zlen, (const Bytef *) raw.data(), raw.size(), COMPRESSION_LEVEL))
+    throw std::runtime_error("Unable to compress block for output file " + path);
+  uint32_t hdr[4] = {(uint32_t) t, b.rows, (uint32_t) raw.size(), (uint32_t) zlen};
+  fwrite(hdr, sizeof(hdr), 1, f);
+  fwrite(z.data(), zlen, 1, f);
+  if (ferror(f))
+    throw std::runtime_error("Unable to write output file " + path);
+  b.rows = 0;
+};
+
+void
+Columnar_Sink::close() {
+  for (int t = 0; t < NUM_TABLES; ++t)
+    write_block((Table) t);
+  if (fclose(f))
+    throw std::runtime_error("Unable to write output file " + path);
+  f = 0;
+};
+
+const char
+Columnar_Sink::MAGIC[8] = {'F', 'T', 'C', 'O', 'L', 'U', 'M', 'N'};
+
+const int
+Columnar_Sink::num_cols[NUM_TABLES] = {8, 10, 5, 4, 7, 7};
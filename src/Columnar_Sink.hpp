@@ -0,0 +1,97 @@
+#ifndef COLUMNAR_SINK_HPP
+#define COLUMNAR_SINK_HPP
+
+//!< Columnar_Sink - write output to a single file of compressed column blocks.
+//
+// ## Format (version 1; all values in native byte order)
+//
+//   header:  char[8] MAGIC, uint32 VERSION, uint32 0
+//
+//   then blocks, each holding up to BLOCK_ROWS rows of one table:
+//
+//     uint32 table, uint32 nRows, uint32 rawBytes, uint32 zBytes
+//     zBytes bytes: zlib stream which inflates to rawBytes bytes,
+//                   holding each column of the table in turn, as a
+//                   uint32 byte count followed by nRows values
+//
+//   The tables, and the types of their columns, are:
+//
+//     0 runs:        int32 runID, int32 batchIDbegin, float64 tsBegin, float64 tsEnd,
+//                    int32 done, int32 motusTagID, int32 ant, int32 len
+//     1 hits:        int32 batchID, int32 runID, float64 ts, float32 sig, float32 sigSD,
+//                    float32 noise, float32 freq, float32 freqSD, float32 slop, float32 burstSlop
+//     2 gps:         float64 ts, int32 batchID, float64 lat, float64 lon, float64 alt
+//     3 pulseCounts: int32 batchID, int32 ant, float64 hourBin, int32 count
+//     4 params:      int32 batchID, float64 ts, int32 ant, string param, float64 val,
+//                    int32 error, string errinfo
+//     5 pulses:      int32 batchID, float64 ts, int32 ant, float64 antFreq, float32 dfreq,
+//                    float32 sig, float32 noise
+//
+//   where a string value is its bytes followed by a NUL.
+//
+// Columns are as in the receiver database table of the same name.  A
+// run is written when it ends, or when the batch does.  Blocks of
+// different tables are interleaved in the order they fill.
+
+#include "Output_Sink.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+class Columnar_Sink : public Output_Sink {
+
+public:
+  Columnar_Sink(std::string path); //!< create the file, replacing any existing one
+  ~Columnar_Sink();
+
+  void add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop);
+
+  void add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt);
+
+  void add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count);
+
+  void add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra);
+
+  void add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p);
+
+  void close();
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const uint32_t BLOCK_ROWS = 65536;
+  static const int COMPRESSION_LEVEL = 1; //!< zlib level; output is written as fast as it is found, so favour speed
+
+protected:
+
+  typedef enum {RUNS = 0, HITS, GPS, PULSE_COUNTS, PARAMS, PULSES, NUM_TABLES} Table;
+
+  static const int num_cols[NUM_TABLES];
+
+  struct Block {
+    std::vector < std::string > cols; //!< column values not yet written
+    uint32_t rows;
+  };
+
+  FILE * f;
+  std::string path;
+  Block blocks[NUM_TABLES];
+  std::string raw;     //!< uncompressed block being written
+  std::string z;       //!< compressed block being written
+
+  void add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done);
+
+  template < typename T >
+  void put(Table t, int c, T v) { //!< append a value to column c of table t
+    blocks[t].cols[c].append((const char *) & v, sizeof(v));
+  };
+
+  void put(Table t, int c, const char * s) { //!< append a string to column c of table t
+    blocks[t].cols[c].append(s, strlen(s) + 1);
+  };
+
+  void end_row(Table t); //!< count a row added to t, and write t's block if full
+
+  void write_block(Table t); //!< write t's block, and start another
+};
+
+#endif // COLUMNAR_SINK_HPP
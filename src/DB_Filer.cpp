@@ -1,17 +1,49 @@
 #include "DB_Filer.hpp"
+#include "Shard_Journal.hpp"
+#include "SQLite_Sink.hpp"
+#include "Blob_Prefetcher.hpp"
 #include <stdio.h>
 #include <time.h>
 #include <math.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <unistd.h>
 
 DB_Filer::DB_Filer (const string &out, const string &prog_name, const string &prog_version, double prog_ts, int  bootnum, double minGPSdt):
+  db_name(out),
+  blob_monoBN(0),
+  blobs(0),
+  blob_prefetch(DEFAULT_BLOB_PREFETCH),
+  max_blob(Blob_Prefetcher::DEFAULT_MAX_BLOB),
+  last_blob_file(0),
+  journal(0),
+  sink(new SQLite_Sink(this)),
+  st_add_run(0),
+  st_add_hits(0),
+  st_add_compact_hit(0),
+  st_get_DTAtags(0),
+  st_get_pulses(0),
+  st_merge_pulses(0),
+  st_clear_pulses(0),
   prog_name(prog_name),
   num_hits(0),
   num_steps(0),
   bootnum(bootnum),
+  pulse_capture(PULSES_INDEXED),
   minGPSdt(minGPSdt),
-  lastGPSts(0)
+  lastGPSts(0),
+  fill(),
+  writer(0),
+  writer_pid(0),
+  max_pending(0),
+  pending(),
+  w_busy(false),
+  w_stopping(false),
+  bulk_load(false),
+  open_runs(),
+  bulk_hits(),
+  compact_hits(false),
+  hit_chains()
 {
   Check(sqlite3_open_v2(out.c_str(),
                         & outdb,
@@ -25,6 +57,29 @@ DB_Filer::DB_Filer (const string &out, const string &prog_name, const string &pr
                0,
                0);
 
+  // Input streams (file lists, DTAtags, pulses) are read through a
+  // separate read-only connection, so that long-lived read cursors
+  // don't share a page cache and transaction with the inserts.  This
+  // needs WAL mode; otherwise, an open read cursor would prevent the
+  // write connection from committing.  If WAL mode isn't available,
+  // everything uses the write connection, as before.
+
+  indb = outdb;
+  sqlite3_stmt * st_wal;
+  if (SQLITE_OK == sqlite3_prepare_v2(outdb, "pragma journal_mode=wal", -1, & st_wal, 0)) {
+    bool wal = SQLITE_ROW == sqlite3_step(st_wal)
+      && ! strcmp("wal", (const char *) sqlite3_column_text(st_wal, 0));
+    sqlite3_finalize(st_wal);
+    if (wal) {
+      if (SQLITE_OK == sqlite3_open_v2(out.c_str(), & indb, SQLITE_OPEN_READONLY, 0)) {
+        sqlite3_exec(indb, "pragma cache_size=4000;", 0, 0, 0);
+      } else {
+        sqlite3_close(indb);
+        indb = outdb;
+      }
+    }
+  }
+
   string msg = "SQLite output database does not have valid 'batches' table.";
 
   Check( sqlite3_prepare_v2(outdb,
@@ -58,8 +113,30 @@ DB_Filer::DB_Filer (const string &out, const string &prog_name, const string &pr
   Check( sqlite3_prepare_v2(outdb, q_end_run2, -1, &st_end_run2, 0),
          msg);
 
-  Check(sqlite3_prepare_v2(outdb, q_add_hit, -1, &st_add_hit, 0),
-        "output DB does not have valid 'hits' table.");
+  // a database whose hits are stored compactly has a view called `hits`
+
+  sqlite3_stmt * st_get_hits_type;
+  Check( sqlite3_prepare_v2(outdb,
+                            "select type from sqlite_master where name='hits'",
+                            -1,
+                            & st_get_hits_type,
+                            0),
+         "unable to read output DB schema");
+  compact_hits = SQLITE_ROW == sqlite3_step(st_get_hits_type)
+    && ! strcmp("view", (const char *) sqlite3_column_text(st_get_hits_type, 0));
+  sqlite3_finalize(st_get_hits_type);
+
+  if (compact_hits) {
+    if (SQLITE_OK != sqlite3_exec(outdb, "select * from hitsCompact indexed by hitsCompact_runID_batchID limit 0", 0, 0, 0))
+      Check( sqlite3_exec(outdb, q_compact_hits_view, 0, 0, 0),
+             "unable to update compact hits view in output database");
+    st_add_hit = 0;
+    Check(sqlite3_prepare_v2(outdb, q_add_compact_hit, -1, &st_add_compact_hit, 0),
+          "output DB does not have valid 'hitsCompact' table.");
+  } else {
+    Check(sqlite3_prepare_v2(outdb, q_add_hit, -1, &st_add_hit, 0),
+          "output DB does not have valid 'hits' table.");
+  }
 
   if (minGPSdt >= 0) {
     Check(sqlite3_prepare_v2(outdb, q_add_GPS_fix,-1, &st_add_GPS_fix, 0),
@@ -151,36 +228,7 @@ DB_Filer::DB_Filer (const string &out, const string &prog_name, const string &pr
 
   const char * ftsm = "SQLite output database does not have valid 'batchState' table";
 
-  sqlite3_enable_load_extension(outdb, 1);
-
-  const static int MAX_PATH_SIZE = 2048;
-  char extension_lib_path_buffer[2*MAX_PATH_SIZE + 1];
-  int n = readlink("/proc/self/exe", extension_lib_path_buffer, MAX_PATH_SIZE);
-  for (;;) { // not a loop
-    if (n > 0) {
-      extension_lib_path_buffer[n] = '\0';
-      char * dir_slash = (char *) memrchr(extension_lib_path_buffer, '/', n);
-      if (dir_slash) {
-        strcpy( dir_slash + 1, "Sqlite_Compression_Extension.so");
-        Check( sqlite3_prepare_v2(outdb,
-                                  q_load_extension,
-                                  -1,
-                                  &st_load_extension,
-                                  0),
-               "Can't prepare statement to load extension library!");
-
-        sqlite3_bind_text(st_load_extension, 1, extension_lib_path_buffer, -1, SQLITE_STATIC);
-        int res = sqlite3_step(st_load_extension);
-        if (res == SQLITE_DONE || res == SQLITE_ROW) {
-          sqlite3_finalize(st_load_extension);
-          st_load_extension = 0;
-          break;
-        }
-      }
-    }
-    // all errors end up here
-    throw std::runtime_error("Unable to load Sqlite_Compression_Extension.so from folder with `find_tags_motus`");
-  };
+  load_extension(outdb);
 
   Check ( sqlite3_prepare_v2(outdb, q_save_findtags_state, -1, & st_save_findtags_state, 0), ftsm);
   sqlite3_bind_text(st_save_findtags_state, 2, prog_name.c_str(), -1, SQLITE_TRANSIENT);
@@ -238,7 +286,38 @@ create index if not exists pulses_batchID on pulses(batchID);",
 
 DB_Filer::~DB_Filer() {
 
-  end_tx();
+  stop_writer();
+  try {
+    sink->close();
+  } catch (std::runtime_error & e) {
+    std::cerr << "find_tags_motus: failed writing output: " << e.what() << std::endl;
+  }
+  delete sink;
+  sink = 0;
+  // staged pulses are in a temporary table, which closing the
+  // connection would drop, so they are kept even if the batch is
+  // ending because of an error; a destructor mustn't throw
+  try {
+    write_bulk_hits();
+    write_open_runs();
+    merge_pulses();
+    end_tx();
+  } catch (std::runtime_error & e) {
+    std::cerr << "find_tags_motus: failed writing to output database: " << e.what() << std::endl;
+  }
+
+  // the journal mode can only be changed once other connections are
+  // closed, and no statement is part way through its results
+  end_pulses_reader();
+  end_DTAtags_reader();
+  if (indb != outdb)
+    sqlite3_close(indb);
+  indb = 0;
+  for (sqlite3_stmt * st = sqlite3_next_stmt(outdb, 0); st; st = sqlite3_next_stmt(outdb, st))
+    sqlite3_reset(st);
+
+  // leave the database in rollback-journal mode, so that it is a
+  // single, portable file
   sqlite3_exec(outdb,
                "pragma journal_mode=delete;",
                0,
@@ -255,7 +334,12 @@ DB_Filer::~DB_Filer() {
   if (minGPSdt >= 0)
     sqlite3_finalize(st_add_GPS_fix);
   sqlite3_finalize(st_add_hit);
+  sqlite3_finalize(st_add_run);
+  sqlite3_finalize(st_add_hits);
+  sqlite3_finalize(st_add_compact_hit);
   sqlite3_finalize(st_add_pulse);
+  sqlite3_finalize(st_merge_pulses);
+  sqlite3_finalize(st_clear_pulses);
   sqlite3_close(outdb);
   outdb = 0;
 };
@@ -267,15 +351,17 @@ DB_Filer::q_begin_run =
 
 DB_Filer::Run_ID
 DB_Filer::begin_run(Motus_Tag_ID mid, int ant, Timestamp ts) {
-  sqlite3_bind_int(st_begin_run, 1, rid); // bind run ID
-  // batchIDbegin bound at start of batch
-  sqlite3_bind_int(st_begin_run, 3, mid); // bind tag ID
-  sqlite3_bind_int(st_begin_run, 4, ant); // bind antenna
-  sqlite3_bind_double(st_begin_run, 5, ts); // bind tsBegin
-  step_commit(st_begin_run);
+  if (journal)
+    return journal->begin_run(mid, ant, ts);
+  sink->begin_run(rid, bid, mid, ant, ts);
   return rid++;
 };
 
+const char *
+DB_Filer::q_add_run =
+ "insert into runs (runID, batchIDbegin, motusTagID, ant, tsBegin, len, tsEnd, done) values (?, ?, ?, ?, ?, ?, ?, ?)";
+//                  1      2             3           4    5        6    7      8
+
 const char *
 DB_Filer::q_end_run  = "update runs set len=?,tsEnd=?,done=? where runID=?";
 //                                      1     2       3            4
@@ -284,18 +370,11 @@ DB_Filer::q_end_run2 = "insert into batchRuns (batchID, runID) values (?,    ?)"
 //                                             1        2
 void
 DB_Filer::end_run(Run_ID rid, int n, Timestamp ts, bool countOnly) {
-  sqlite3_bind_int(st_end_run, 1, n); // bind number of hits in run
-  sqlite3_bind_double(st_end_run, 2, ts); // bind tsEnd
-  sqlite3_bind_int(st_end_run, 3, countOnly ? 0: 1); // is this run really finished?
-  sqlite3_bind_int(st_end_run, 4, rid);  // bind run number
-  step_commit(st_end_run);
-
-  // add record indicating this run overlaps this batch
-  // (this doesn't necessarily mean the run had hits in this batch; it might
-  // simply have ended due to no more hits, or the run might still be active
-  // because a short batch didn't span enough time to expire the candidate)
-  sqlite3_bind_int(st_end_run2, 2, rid); // bind run ID
-  step_commit(st_end_run2);
+  if (journal) {
+    journal->end_run(rid, n, ts, countOnly);
+    return;
+  }
+  sink->end_run(rid, n, ts, countOnly);
 };
 
 const char *
@@ -304,19 +383,71 @@ DB_Filer::q_add_hit =
          values   (?,       ?,     ?,  ?,   ?,     ?,     ?,    ?,      ?,    ?)";
 //               1       2     3  4    5     6     7    8      9     10
 
+const char *
+DB_Filer::q_compact_hits = R"(
+drop table hits;
+create table hitsCompact (
+   hitID integer primary key,    -- unique ID of this hit
+   runID integer not null,       -- ID of run this hit belongs to
+   batchID integer not null,     -- ID of batch this hit belongs to
+   dts integer not null,         -- interval since the run's previous hit minus the interval before that,
+                                 -- in units of 0.1 ms; 0 for the first hit of a run in a batch
+   tsBase integer,               -- for the first hit of a run in a batch, its timestamp in units of 0.1 ms;
+                                 -- otherwise null
+   tsExact float(53),            -- timestamp, if it isn't a whole number of 0.1 ms; otherwise null
+   sig integer,                  -- in units of 0.01
+   sigSD integer,                -- in units of 0.01
+   noise integer,                -- in units of 0.01
+   freq integer,                 -- in units of 0.001
+   freqSD integer,               -- in units of 0.001
+   slop integer,                 -- in units of 0.000001
+   burstSlop integer             -- in units of 0.000001
+);
+create index hitsCompact_batchID_runID on hitsCompact(batchID, runID);
+)";
+
+// The view's windows are partitioned by columns which both indexes
+// begin with, so that SQLite pushes a filter on runID or on batchID
+// down into the innermost query, and reads only those hits rather
+// than decoding all of them.  Databases made before the
+// hitsCompact_runID_batchID index was added get it, and this view,
+// when opened.
+
+const char *
+DB_Filer::q_compact_hits_view = R"(
+savepoint compact_hits_view;
+create index if not exists hitsCompact_runID_batchID on hitsCompact(runID, batchID);
+drop view if exists hits;
+create view hits as
+  select hitID, runID, batchID,
+         coalesce(tsExact, (base + sum(spacing) over run) / 10000.0) as ts,
+         sig / 100.0 as sig, sigSD / 100.0 as sigSD, noise / 100.0 as noise,
+         freq / 1000.0 as freq, freqSD / 1000.0 as freqSD,
+         slop / 1000000.0 as slop, burstSlop / 1000000.0 as burstSlop
+    from (select *, sum(dts) over run as spacing, first_value(tsBase) over run as base
+            from hitsCompact
+          window run as (partition by runID, batchID order by hitID))
+  window run as (partition by runID, batchID order by hitID);
+release compact_hits_view;
+)";
+
+const char *
+DB_Filer::q_add_compact_hit =
+"insert into hitsCompact (batchID, runID, dts, tsBase, tsExact, sig, sigSD, noise, freq, freqSD, slop, burstSlop) \
+         values          (?,       ?,     ?,   ?,      ?,       ?,   ?,     ?,     ?,    ?,      ?,    ?)";
+//                        1        2      3    4       5        6    7      8      9     10      11    12
+
+// must match the units in q_compact_hits
+const double
+DB_Filer::HIT_SCALE[8] = {0, 100, 100, 100, 1000, 1000, 1000000, 1000000};
+
 void
 DB_Filer::add_hit(Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) {
-  sqlite3_bind_int   (st_add_hit, 1, bid);
-  sqlite3_bind_int   (st_add_hit, 2, rid);
-  sqlite3_bind_double(st_add_hit, 3, ts);
-  sqlite3_bind_double(st_add_hit, 4, sig);
-  sqlite3_bind_double(st_add_hit, 5, sigSD);
-  sqlite3_bind_double(st_add_hit, 6, noise);
-  sqlite3_bind_double(st_add_hit, 7, freq);
-  sqlite3_bind_double(st_add_hit, 8, freqSD);
-  sqlite3_bind_double(st_add_hit, 9, slop);
-  sqlite3_bind_double(st_add_hit, 10, burstSlop);
-  step_commit(st_add_hit);
+  if (journal) {
+    journal->add_hit(rid, ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop);
+    return;
+  }
+  sink->add_hit(bid, rid, ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop);
   ++ num_hits;
 };
 
@@ -328,16 +459,15 @@ DB_Filer::q_add_GPS_fix =
 
 void
 DB_Filer::add_GPS_fix(double ts, double lat, double lon, double alt) {
+  if (journal) {
+    // the minGPSdt filter is applied when the journal is replayed
+    journal->add_GPS_fix(ts, lat, lon, alt);
+    return;
+  }
   if (ts - lastGPSts < minGPSdt)
     return;
   lastGPSts = ts;
-  sqlite3_bind_double   (st_add_GPS_fix, 1, ts);
-  sqlite3_bind_int      (st_add_GPS_fix, 2, bid);
-  // for now, there is no gpsts, so we use null; eventually:  sqlite3_bind_double   (st_add_GPS_fix, 3, gpsts);
-  sqlite3_bind_double   (st_add_GPS_fix, 3, lat);
-  sqlite3_bind_double   (st_add_GPS_fix, 4, lon);
-  sqlite3_bind_double   (st_add_GPS_fix, 5, alt);
-  step_commit(st_add_GPS_fix);
+  sink->add_GPS_fix(bid, ts, lat, lon, alt);
 };
 
 
@@ -349,13 +479,8 @@ DB_Filer::q_add_time_fix =
 
 void
 DB_Filer::add_time_fix(Timestamp tsLow, Timestamp tsHigh, Timestamp by, Timestamp error, char fixType) {
-  sqlite3_bind_int    (st_add_time_fix, 1, bootnum);
-  sqlite3_bind_double (st_add_time_fix, 2, tsLow);
-  sqlite3_bind_double (st_add_time_fix, 3, tsHigh);
-  sqlite3_bind_double (st_add_time_fix, 4, by);
-  sqlite3_bind_double (st_add_time_fix, 5, error);
-  sqlite3_bind_text   (st_add_time_fix, 6, & fixType, 1, SQLITE_TRANSIENT);
-  step_commit(st_add_time_fix);
+  Write_Record w = {W_TIME_FIX, {bootnum, fixType}, {tsLow, tsHigh, by, error}};
+  queue(w);
 };
 
 const char *
@@ -366,14 +491,48 @@ DB_Filer::q_add_pulse_count =
 
 void
 DB_Filer::add_pulse_count(double hourBin, int ant, int count) {
-  sqlite3_bind_int    (st_add_pulse_count, 1, bid);
-  sqlite3_bind_int    (st_add_pulse_count, 2, ant);
-  sqlite3_bind_double (st_add_pulse_count, 3, hourBin);
-  sqlite3_bind_int    (st_add_pulse_count, 4, count);
-  step_commit(st_add_pulse_count);
+  if (journal) {
+    journal->add_pulse_count(hourBin, ant, count);
+    return;
+  }
+  sink->add_pulse_count(bid, hourBin, ant, count);
 };
 
 
+void
+DB_Filer::load_extension(sqlite3 * db) {
+  sqlite3_enable_load_extension(db, 1);
+
+  const static int MAX_PATH_SIZE = 2048;
+  char extension_lib_path_buffer[2*MAX_PATH_SIZE + 1];
+  int n = readlink("/proc/self/exe", extension_lib_path_buffer, MAX_PATH_SIZE);
+  for (;;) { // not a loop
+    if (n > 0) {
+      extension_lib_path_buffer[n] = '\0';
+      char * dir_slash = (char *) memrchr(extension_lib_path_buffer, '/', n);
+      if (dir_slash) {
+        strcpy( dir_slash + 1, "Sqlite_Compression_Extension.so");
+        Check( sqlite3_prepare_v2(db,
+                                  q_load_extension,
+                                  -1,
+                                  &st_load_extension,
+                                  0),
+               "Can't prepare statement to load extension library!");
+
+        sqlite3_bind_text(st_load_extension, 1, extension_lib_path_buffer, -1, SQLITE_STATIC);
+        int res = sqlite3_step(st_load_extension);
+        if (res == SQLITE_DONE || res == SQLITE_ROW) {
+          sqlite3_finalize(st_load_extension);
+          st_load_extension = 0;
+          break;
+        }
+      }
+    }
+    // all errors end up here
+    throw std::runtime_error("Unable to load Sqlite_Compression_Extension.so from folder with `find_tags_motus`");
+  };
+};
+
 void
 DB_Filer::step_commit(sqlite3_stmt * st) {
   Check(sqlite3_step(st), SQLITE_DONE, "unable to step statement");
@@ -389,6 +548,7 @@ DB_Filer::qbuf[256];
 
 void
 DB_Filer::add_param(const string &name, double value) {
+  flush();
   sqlite3_reset(st_check_param);
   sqlite3_bind_text(st_check_param, 2, name.c_str(), -1, SQLITE_TRANSIENT);
   int rv = sqlite3_step(st_check_param);
@@ -407,6 +567,7 @@ DB_Filer::add_param(const string &name, double value) {
 
 void
 DB_Filer::add_param(const string &name, const string &value) {
+  flush();
   sqlite3_reset(st_check_param);
   sqlite3_bind_text(st_check_param, 2, name.c_str(), -1, SQLITE_TRANSIENT);
   int rv = sqlite3_step(st_check_param);
@@ -432,6 +593,25 @@ DB_Filer::Check(int code, int wants, int wants2, int wants3, const std::string &
   throw std::runtime_error(err + "\nSqlite error: " + sqlite3_errmsg(outdb));
 };
 
+int
+DB_Filer::Check_Read(int code, const std::string & err) {
+  if (code == SQLITE_OK)
+    return code;
+  throw std::runtime_error(err + "\nSqlite error: " + sqlite3_errmsg(indb));
+};
+
+void
+DB_Filer::set_db_memory(double cache_mb, double mmap_mb) {
+  // a negative cache_size is in units of KiB, rather than pages
+  sprintf(qbuf, "pragma cache_size=%lld; pragma mmap_size=%lld;",
+          - (long long) (cache_mb * 1024),
+          (long long) (mmap_mb * 1024 * 1024));
+  flush();
+  sqlite3_exec(outdb, qbuf, 0, 0, 0);
+  if (indb != outdb)
+    sqlite3_exec(indb, qbuf, 0, 0, 0);
+};
+
 
 // start new batch; uses 1 + ID of latest ended batch
 
@@ -443,7 +623,9 @@ DB_Filer::q_drop_saved_state = "delete from batchState where monoBN=?";
 
 void
 DB_Filer::begin_batch(int bootnum) {
+  flush();
   num_hits = 0;
+  hit_chains.clear();
 
   sqlite3_bind_int(st_begin_batch, 1, bootnum);
   // get current time, in GMT
@@ -453,8 +635,10 @@ DB_Filer::begin_batch(int bootnum) {
   step_commit(st_begin_batch);
   bid = sqlite3_last_insert_rowid(outdb);
 
-  // set batch ID for "insert into runs" query
+  // set batch ID for "insert into runs" queries
   sqlite3_bind_int(st_begin_run, 2, bid);
+  if (st_add_run)
+    sqlite3_bind_int(st_add_run, 2, bid);
 
   // set batch ID for "insert into batchRuns" query
   sqlite3_bind_int(st_end_run2, 1, bid);
@@ -468,6 +652,8 @@ DB_Filer::q_end_batch = "update batches set tsStart=?, tsEnd=?, numHits=? where
 //                                     1         2       3             4
 void
 DB_Filer::end_batch(Timestamp tsStart, Timestamp tsEnd) {
+  flush();
+  merge_pulses();
   sqlite3_bind_double(st_end_batch, 1, tsStart);
   sqlite3_bind_double(st_end_batch, 2, tsEnd);
   sqlite3_bind_int64(st_end_batch, 3, num_hits);
@@ -475,6 +661,17 @@ DB_Filer::end_batch(Timestamp tsStart, Timestamp tsEnd) {
   step_commit(st_end_batch);
 };
 
+void
+DB_Filer::drop_batch() {
+  // nothing else refers to the batch until tags are found; the next
+  // batch reuses its ID
+  flush();
+  sprintf(qbuf,
+          "delete from batchFiles where batchID=%d; delete from batchProgs where batchID=%d; delete from batches where batchID=%d;",
+          bid, bid, bid);
+  Check( sqlite3_exec(outdb, qbuf, 0, 0, 0), "unable to remove batch from output database");
+};
+
 void
 DB_Filer::begin_tx() {
   num_steps = 0;
@@ -483,7 +680,10 @@ DB_Filer::begin_tx() {
 
 void
 DB_Filer::end_tx() {
-  if (num_steps > 0) {
+  // commit even if nothing was written, so that the connection is
+  // no longer in a transaction, which would prevent changing its
+  // journal mode
+  if (num_steps > 0 || ! sqlite3_get_autocommit(outdb)) {
     Check( sqlite3_exec(outdb, "commit", 0, 0, 0), "Failed to commit remaining inserts.");
     num_steps = 0;
   }
@@ -530,6 +730,7 @@ DB_Filer::save_ambiguity(Motus_Tag_ID proxyID, const Ambiguity::AmbigIDs & tags)
   // add mid to its ambiguity group.
   if (proxyID >= 0)
     throw std::runtime_error("Called add_ambiguity with non-negative proxyID");
+  flush();
   sqlite3_reset(st_save_ambig);
   sqlite3_bind_int(st_save_ambig, 1, proxyID);
   auto t = tags.begin();
@@ -546,17 +747,20 @@ const char *
 DB_Filer::q_save_findtags_state =
   "insert or replace into batchState \
              (batchID, progName, monoBN, tsData, tsRun, state, version)\
-      values (?,       ?,        ?,      ?,      ?,     gzcompress(?),     ? );";
-  //          1        2         3       4       5                 6       7
+      values (?,       ?,        ?,      ?,      ?,     ?,     ? );";
+  //          1        2         3       4       5      6      7
 
 void
-DB_Filer::save_findtags_state(Timestamp tsData, Timestamp tsRun, std::string state, int version) {
+DB_Filer::save_findtags_state(Timestamp tsData, Timestamp tsRun, const std::string & state, int version) {
   // drop any saved state for previous batch
   // FIXME: we need a reasonable way to decide when we can drop saved state from
   // boot session; i.e. when do we have all of its files?  This argues for a file counter...
   // The primary key on the batchState table will permit only one saved state per boot session,
   // and this will be the latest, given the use of "insert or replace" in q_save_findtags_state
 
+  // the saved state must not refer to runs or hits which haven't been written
+  flush();
+
   sqlite3_reset(st_save_findtags_state);
   sqlite3_bind_int(st_save_findtags_state,    1, bid);
   sqlite3_bind_int(st_save_findtags_state,    3, bootnum);
@@ -573,11 +777,12 @@ DB_Filer::save_findtags_state(Timestamp tsData, Timestamp tsRun, std::string sta
 // number (the upper 16 bits)
 
 const char *
-DB_Filer::q_load_findtags_state = "select (select max(batchID) from batchState) as batchID, tsData, tsRun, gzuncompress(state), version from batchState where progName=? and monoBN=? and cast(version/65536 as integer)=cast(?/65536 as integer)";
-//                                                                                 0        1       2      3                    4
+DB_Filer::q_load_findtags_state = "select (select max(batchID) from batchState) as batchID, tsData, tsRun, state, version from batchState where progName=? and monoBN=? and cast(version/65536 as integer)=cast(?/65536 as integer)";
+//                                                                                 0        1       2      3      4
 
 bool
 DB_Filer::load_findtags_state(long long monoBN, Timestamp & tsData, Timestamp & tsRun, std::string & state, int version, int &blob_version) {
+  flush(); // queued records are written with the batch ID
   sqlite3_reset(st_load_findtags_state);
   sqlite3_bind_int64(st_load_findtags_state, 2, monoBN);
   sqlite3_bind_int(st_load_findtags_state, 3, version);
@@ -595,24 +800,20 @@ const char *
 DB_Filer::q_get_file_repo = R"(select val from meta where key='fileRepo')";
 
 const char *
-DB_Filer::q_get_blob = R"(select ts,
-readfile2(filename, compressed),
-fileID from
-(select
+DB_Filer::q_get_blob_files = R"(select fileID,
+   ts,
    (printf('%s/%s/%s%s',
            ?,
-           strftime('%Y-%m-%d', datetime(t1.ts, 'unixepoch')),
-           t1.name,
+           strftime('%Y-%m-%d', datetime(ts, 'unixepoch')),
+           name,
            case isDone when 0 then '' else '.gz' end)
    ) as filename,
-   t1.ts as ts,
-   t1.isDone as compressed,
-   t1.fileID as fileID
+   size
 from
-   files as t1
+   files
 where
-   t1.monoBN=? and t1.ts >= ?
-order by ts)
+   monoBN=?
+order by ts
 )";
 
 const char *
@@ -622,16 +823,27 @@ DB_Filer::q_add_batch_file = "insert or ignore into batchFiles values (?, ?)";
 const char *
 DB_Filer::q_load_extension = "select load_extension(?)";
 
+void
+DB_Filer::set_blob_prefetch(unsigned int depth) {
+  blob_prefetch = depth;
+};
+
+void
+DB_Filer::set_max_blob(size_t bytes) {
+  max_blob = bytes;
+};
+
 void
 DB_Filer::start_blob_reader(int monoBN) {
 
+  sqlite3_stmt * st_get_blob_files;
 
-  Check( sqlite3_prepare_v2(outdb,
-                            q_get_blob,
+  Check_Read( sqlite3_prepare_v2(indb,
+                            q_get_blob_files,
                             -1,
-                            &st_get_blob,
+                            &st_get_blob_files,
                             0),
-         "SQLite input database does not have valid 'files' or 'fileContents' table.");
+         "SQLite input database does not have valid 'files' table.");
 
   Check( sqlite3_prepare_v2(outdb,
                             q_add_batch_file,
@@ -640,7 +852,7 @@ DB_Filer::start_blob_reader(int monoBN) {
                             0),
          "SQLite input database does not have valid 'batchFiles' table.");
 
-  Check( sqlite3_prepare_v2(outdb,
+  Check_Read( sqlite3_prepare_v2(indb,
                                q_get_file_repo,
                                -1,
                                &st_get_file_repo,
@@ -660,55 +872,115 @@ DB_Filer::start_blob_reader(int monoBN) {
   if (!file_repo_okay)
     throw std::runtime_error("missing or invalid value for 'fileRepo' key in receiver DB 'meta' table");
 
-  sqlite3_bind_text(st_get_blob, 1, file_repo, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(st_get_blob_files, 1, file_repo, -1, SQLITE_TRANSIENT);
+  this->file_repo = file_repo;
   sqlite3_finalize(st_get_file_repo);
 
-  sqlite3_bind_int(st_get_blob, 2, monoBN);
+  sqlite3_bind_int(st_get_blob_files, 2, monoBN);
+  blob_monoBN = monoBN;
+
+  // list the boot session's files, in the order they are read; their
+  // contents are read and decompressed by the prefetcher
 
-  // initially, assume we're starting at the first file in that boot session, by specifying fileTS=0.
+  std::vector < Blob_Prefetcher::File > files;
+  while (SQLITE_ROW == sqlite3_step(st_get_blob_files)) {
+    Blob_Prefetcher::File f;
+    f.fileID = sqlite3_column_int(st_get_blob_files, 0);
+    f.ts = sqlite3_column_double(st_get_blob_files, 1);
+    f.path = (const char *) sqlite3_column_text(st_get_blob_files, 2);
+    f.size = sqlite3_column_int64(st_get_blob_files, 3);
+    files.push_back(f);
+  }
+  sqlite3_finalize(st_get_blob_files);
+
+  // initially, assume we're starting at the first file in that boot session.
   // this might be changed by the resume() code.
-  sqlite3_bind_int(st_get_blob, 3, 0);
+  blobs = new Blob_Prefetcher(files, blob_prefetch, max_blob);
+  last_blob_file = 0;
 };
 
 void
-DB_Filer::seek_blob (Timestamp tsseek) {
-  sqlite3_bind_int(st_get_blob, 3, tsseek);
+DB_Filer::seek_blob (Timestamp tsseek, int offset) {
+  // file timestamps were compared to a whole number of seconds when
+  // this was a query parameter; keep doing so
+  blobs->seek((int) tsseek, offset);
+  last_blob_file = 0;
 };
 
 bool
-DB_Filer::get_blob (const char **bufout, int * lenout, Timestamp *ts) {
-  int res = sqlite3_step(st_get_blob);
-  if (res == SQLITE_DONE)
-    return false; // indicate we're done
-
-  if (res != SQLITE_ROW)
-    throw std::runtime_error("Problem getting next blob.");
-
-  // if row's second field was null (e.g. if decompression failed),
-  // the following will set lenout = 0 and bufout = (void*) 0
+DB_Filer::get_blob (const char **bufout, int * lenout, Timestamp *ts, int * offset) {
+  // if a file couldn't be read or decompressed, this sets lenout = 0.
   // The caller should then try read the next blob.
 
-  * lenout = sqlite3_column_bytes(st_get_blob, 1);
-  * bufout = reinterpret_cast < const char * > (sqlite3_column_blob(st_get_blob, 1));
-  * ts = sqlite3_column_double(st_get_blob, 0);
+  const Blob_Prefetcher::File * f;
+  if (! blobs->get(bufout, lenout, & f, offset))
+    return false; // indicate we're done
+
+  * ts = f->ts;
 
   // record which file we're reading
-  sqlite3_bind_int(st_add_batch_file, 1, bid);
-  sqlite3_bind_int(st_add_batch_file, 2, sqlite3_column_int(st_get_blob, 2));
-  step_commit(st_add_batch_file);
+  if (f->fileID != last_blob_file)
+    add_batch_file(f->fileID);
+  last_blob_file = f->fileID;
 
   return true;
 };
 
 void
-DB_Filer::rewind_blob_reader(Timestamp origin) {
-  sqlite3_reset (st_get_blob);
-  seek_blob(origin);
+DB_Filer::add_batch_file(int fileID) {
+  if (journal) {
+    journal->add_batch_file(fileID);
+    return;
+  }
+  Write_Record w = {W_BATCH_FILE, {fileID}};
+  queue(w);
+};
+
+void
+DB_Filer::rewind_blob_reader(Timestamp origin, int offset) {
+  seek_blob(origin, offset);
 };
 
 void
 DB_Filer::end_blob_reader () {
-  sqlite3_finalize (st_get_blob);
+  delete blobs;
+  blobs = 0;
+};
+
+void
+DB_Filer::restart_blob_reader() {
+  // The existing prefetcher is abandoned, not destroyed: after a
+  // fork(), its threads belong to the parent process.
+
+  blobs = new Blob_Prefetcher(blobs->get_files(), blob_prefetch, max_blob);
+};
+
+void
+DB_Filer::get_file_timestamps(int monoBN, std::vector < Timestamp > & ts) {
+  sqlite3_stmt * st_get_file_ts;
+  Check_Read( sqlite3_prepare_v2(indb,
+                            "select ts from files where monoBN=? order by ts",
+                            -1,
+                            & st_get_file_ts,
+                            0),
+         "SQLite input database does not have valid 'files' table.");
+  sqlite3_bind_int(st_get_file_ts, 1, monoBN);
+  ts.clear();
+  while (SQLITE_ROW == sqlite3_step(st_get_file_ts))
+    ts.push_back(sqlite3_column_double(st_get_file_ts, 0));
+  sqlite3_finalize(st_get_file_ts);
+};
+
+void
+DB_Filer::set_journal(Shard_Journal * j) {
+  journal = j;
+};
+
+void
+DB_Filer::set_sink(Output_Sink * s) {
+  flush();
+  delete sink;
+  sink = s ? s : new SQLite_Sink(this);
 };
 
 const char *
@@ -720,7 +992,7 @@ DB_Filer::q_get_DTAtags = "select ts, id, ant, sig, antFreq, gain, 0+substr(code
 
 void
 DB_Filer::start_DTAtags_reader(Timestamp ts, int bootnum) {
-  Check(sqlite3_prepare_v2(outdb, q_get_DTAtags, -1, &st_get_DTAtags, 0),
+  Check_Read(sqlite3_prepare_v2(indb, q_get_DTAtags, -1, &st_get_DTAtags, 0),
         "output DB does not have valid 'DTAtags' table.");
   sqlite3_bind_int(st_get_DTAtags, 1, bootnum);
   sqlite3_bind_int(st_get_DTAtags, 2, bootnum + 1);
@@ -775,6 +1047,53 @@ DB_Filer::rewind_DTAtags_reader() {
   start_DTAtags_reader(0, bootnum);
 };
 
+const char *
+DB_Filer::q_get_pulses = "select rowid, ts, ant, antFreq, dfreq, sig, noise from pulses "
+  //                             0      1   2    3        4      5    6
+  "where batchID in (select batchID from batches where monoBN=?) and (ts > ? or (ts = ? and rowid > ?)) order by ts, rowid"
+  //                                                          1          2         3                4
+  ;
+
+void
+DB_Filer::start_pulses_reader(int monoBN, Timestamp ts, long long rowid) {
+  end_pulses_reader();
+  Check_Read(sqlite3_prepare_v2(indb, q_get_pulses, -1, &st_get_pulses, 0),
+        "output DB does not have valid 'pulses' table.");
+  sqlite3_bind_int(st_get_pulses, 1, monoBN);
+  sqlite3_bind_double(st_get_pulses, 2, ts);
+  sqlite3_bind_double(st_get_pulses, 3, ts);
+  sqlite3_bind_int64(st_get_pulses, 4, rowid);
+};
+
+bool
+DB_Filer::get_pulses_record(Pulse_Record &pr) {
+  if (! st_get_pulses)
+    throw std::runtime_error("Attempt to use uninitialized st_get_pulses in get_pulses_record");
+
+  int rv = sqlite3_step(st_get_pulses);
+  if (rv == SQLITE_DONE)
+    return false; // indicate we're done
+
+  if (rv != SQLITE_ROW)
+    throw std::runtime_error("Problem getting next pulses record.");
+
+  pr.rowid   = sqlite3_column_int64  (st_get_pulses, 0);
+  pr.ts      = sqlite3_column_double (st_get_pulses, 1);
+  pr.ant     = sqlite3_column_int    (st_get_pulses, 2);
+  pr.antFreq = sqlite3_column_double (st_get_pulses, 3);
+  pr.dfreq   = sqlite3_column_double (st_get_pulses, 4);
+  pr.sig     = sqlite3_column_double (st_get_pulses, 5);
+  pr.noise   = sqlite3_column_double (st_get_pulses, 6);
+  return true;
+};
+
+void
+DB_Filer::end_pulses_reader() {
+  if (st_get_pulses)
+    sqlite3_finalize(st_get_pulses);
+  st_get_pulses = 0;
+};
+
 const char *
 DB_Filer::q_add_pulse =
 "insert into pulses (batchID, ts, ant, antFreq, dfreq, sig, noise) \
@@ -783,14 +1102,62 @@ DB_Filer::q_add_pulse =
 
 void
 DB_Filer::add_pulse(int ant, Pulse &p) {
-  sqlite3_bind_int   (st_add_pulse, 1, bid);
-  sqlite3_bind_double(st_add_pulse, 2, p.ts);
-  sqlite3_bind_int   (st_add_pulse, 3, ant);
-  sqlite3_bind_double(st_add_pulse, 4, p.ant_freq);
-  sqlite3_bind_double(st_add_pulse, 5, p.dfreq);
-  sqlite3_bind_double(st_add_pulse, 6, p.sig);
-  sqlite3_bind_double(st_add_pulse, 7, p.noise);
-  step_commit(st_add_pulse);
+  if (pulse_capture == PULSES_SKIPPED)
+    return;
+  sink->add_pulse(bid, ant, p);
+};
+
+const char *
+DB_Filer::q_stage_pulses = "\
+create temp table if not exists pulsesStaged ( \
+   batchID integer,                  \
+   ts      float(53),                \
+   ant     integer,                  \
+   antFreq float(53),                \
+   dfreq    float(53),               \
+   sig     float,                    \
+   noise   float                     \
+);";
+
+const char *
+DB_Filer::q_add_staged_pulse =
+"insert into pulsesStaged (batchID, ts, ant, antFreq, dfreq, sig, noise) \
+           values         (?,       ?,  ?,   ?,       ?,     ?,   ?)";
+//                         1        2   3    4        5      6    7
+
+const char *
+DB_Filer::q_merge_pulses =
+"insert into pulses (batchID, ts, ant, antFreq, dfreq, sig, noise) \
+   select batchID, ts, ant, antFreq, dfreq, sig, noise from pulsesStaged order by ts, rowid";
+
+void
+DB_Filer::set_pulse_capture(Pulse_Capture pc) {
+  flush();
+  merge_pulses();
+  sqlite3_finalize(st_add_pulse);
+  std::string msg = "unable to prepare query for add_pulse";
+  if (pc == PULSES_STAGED) {
+    // staged pulses are added to the indexes in order by timestamp,
+    // so the pulses_ts index only grows at its end
+    Check( sqlite3_exec(outdb, q_stage_pulses, 0, 0, 0),
+           "unable to create table for staging pulses");
+    Check( sqlite3_prepare_v2(outdb, q_add_staged_pulse, -1, &st_add_pulse, 0), msg);
+    if (! st_merge_pulses) {
+      Check( sqlite3_prepare_v2(outdb, q_merge_pulses, -1, &st_merge_pulses, 0), msg);
+      Check( sqlite3_prepare_v2(outdb, "delete from pulsesStaged", -1, &st_clear_pulses, 0), msg);
+    }
+  } else {
+    Check( sqlite3_prepare_v2(outdb, q_add_pulse, -1, &st_add_pulse, 0), msg);
+  }
+  pulse_capture = pc;
+};
+
+void
+DB_Filer::merge_pulses() {
+  if (! st_merge_pulses)
+    return;
+  step_commit(st_merge_pulses);
+  step_commit(st_clear_pulses);
 };
 
 const char *
@@ -801,12 +1168,361 @@ DB_Filer::q_add_recv_param =
 
 void
 DB_Filer::add_recv_param(Timestamp ts, int ant, char *param, double val, int error, char *extra) {
-  sqlite3_bind_int   (st_add_recv_param, 1, bid);
-  sqlite3_bind_double(st_add_recv_param, 2, ts);
-  sqlite3_bind_int   (st_add_recv_param, 3, ant);
-  sqlite3_bind_text  (st_add_recv_param, 4, param, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_double(st_add_recv_param, 5, val);
-  sqlite3_bind_int   (st_add_recv_param, 6, error);
-  sqlite3_bind_text  (st_add_recv_param, 7, extra, -1, SQLITE_TRANSIENT);
-  step_commit(st_add_recv_param);
+  if (journal) {
+    journal->add_recv_param(ts, ant, param, val, error, extra);
+    return;
+  }
+  sink->add_recv_param(bid, ts, ant, param, val, error, extra);
+};
+
+void
+DB_Filer::set_write_queue(unsigned int records) {
+  stop_writer();
+  write_bulk_hits();
+  if (records == 0 || ! sqlite3_threadsafe())
+    return; // write records as they are reported
+  max_pending = std::max(1U, records / WRITE_BLOCK_RECORDS);
+  w_stopping = false;
+  w_error.clear();
+  fill.recs.reserve(WRITE_BLOCK_RECORDS);
+  writer_pid = getpid();
+  writer = new std::thread(& DB_Filer::write_loop, this);
+};
+
+void
+DB_Filer::set_bulk_load(bool on) {
+  flush();
+  if (on && ! st_add_run) {
+    Check(sqlite3_prepare_v2(outdb, q_add_run, -1, &st_add_run, 0),
+          "output DB table 'runs' is invalid");
+    sqlite3_bind_int(st_add_run, 2, bid); // as bound into st_begin_run by begin_batch
+  }
+  if (on && ! st_add_hits && ! compact_hits) {
+    std::string q = "insert into hits (batchID, runID, ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop) values ";
+    for (int i = 0; i < HITS_PER_INSERT; ++i)
+      q += i ? ",(?,?,?,?,?,?,?,?,?,?)" : "(?,?,?,?,?,?,?,?,?,?)";
+    Check(sqlite3_prepare_v2(outdb, q.c_str(), -1, &st_add_hits, 0),
+          "output DB does not have valid 'hits' table.");
+  }
+  // these last only as long as the connection, i.e. this batch, and
+  // can't be changed inside a transaction
+  end_tx();
+  Check( sqlite3_exec(outdb, on ? "pragma synchronous=off; pragma temp_store=memory;" : "pragma synchronous=full; pragma temp_store=default;", 0, 0, 0),
+         "unable to set pragmas for bulk loading");
+  begin_tx();
+  bulk_load = on;
+};
+
+void
+DB_Filer::set_compact_hits() {
+  if (compact_hits)
+    return;
+  flush();
+  sqlite3_stmt * st_count_hits;
+  Check( sqlite3_prepare_v2(outdb, "select exists (select * from hits)", -1, & st_count_hits, 0),
+         "output DB does not have valid 'hits' table.");
+  bool has_hits = SQLITE_ROW == sqlite3_step(st_count_hits) && sqlite3_column_int(st_count_hits, 0);
+  sqlite3_finalize(st_count_hits);
+  if (has_hits)
+    throw std::runtime_error("Can't store hits compactly in a receiver database which already has hits stored the usual way");
+
+  // statements on the hits table would be invalid once it's dropped
+  sqlite3_finalize(st_add_hit);
+  sqlite3_finalize(st_add_hits);
+  st_add_hit = st_add_hits = 0;
+  Check( sqlite3_exec(outdb, q_compact_hits, 0, 0, 0),
+         "unable to create compact hits table in output database");
+  Check( sqlite3_exec(outdb, q_compact_hits_view, 0, 0, 0),
+         "unable to create compact hits view in output database");
+  Check( sqlite3_prepare_v2(outdb, q_add_compact_hit, -1, &st_add_compact_hit, 0),
+         "output DB does not have valid 'hitsCompact' table.");
+  compact_hits = true;
+};
+
+void
+DB_Filer::queue(Write_Record & w) {
+  fill.recs.push_back(w);
+  if (! writer || writer_pid != getpid()) {
+    // no writer thread in this process
+    write_block(fill);
+  } else if (fill.recs.size() >= WRITE_BLOCK_RECORDS) {
+    hand_off();
+  }
+};
+
+void
+DB_Filer::hand_off() {
+  std::unique_lock < std::mutex > lock(w_mutex);
+  w_done.wait(lock, [this] {return pending.size() < max_pending || w_error.size();});
+  if (w_error.size())
+    throw std::runtime_error(w_error);
+  pending.push_back(Write_Block());
+  pending.back().recs.swap(fill.recs);
+  pending.back().text.swap(fill.text);
+  fill.recs.reserve(WRITE_BLOCK_RECORDS);
+  w_ready.notify_one();
+};
+
+void
+DB_Filer::flush() {
+  if (! writer || writer_pid != getpid()) {
+    write_bulk_hits();
+    return;
+  }
+  if (fill.recs.size())
+    hand_off();
+  std::unique_lock < std::mutex > lock(w_mutex);
+  w_done.wait(lock, [this] {return (pending.empty() && ! w_busy) || w_error.size();});
+  if (w_error.size())
+    throw std::runtime_error(w_error);
+};
+
+void
+DB_Filer::write_loop() {
+  std::unique_lock < std::mutex > lock(w_mutex);
+  for (;;) {
+    w_ready.wait(lock, [this] {return w_stopping || pending.size();});
+    if (pending.empty())
+      return; // stopping, with everything written
+    Write_Block b;
+    b.recs.swap(pending.front().recs);
+    b.text.swap(pending.front().text);
+    pending.pop_front();
+    w_busy = true;
+    lock.unlock();
+    std::string err;
+    try {
+      write_block(b);
+    } catch (std::exception & e) {
+      err = e.what();
+    }
+    lock.lock();
+    if (err.size() && w_error.empty())
+      w_error = err;
+    w_busy = false;
+    w_done.notify_all();
+  }
+};
+
+void
+DB_Filer::stop_writer() {
+  if (! writer || writer_pid != getpid())
+    return; // none, or it belongs to another process
+  if (fill.recs.size())
+    hand_off();
+  {
+    std::unique_lock < std::mutex > lock(w_mutex);
+    w_stopping = true;
+  }
+  w_ready.notify_one();
+  writer->join();
+  delete writer;
+  writer = 0;
+  if (w_error.size())
+    std::cerr << "find_tags_motus: failed writing to output database: " << w_error << std::endl;
+};
+
+void
+DB_Filer::write_bulk_hits() {
+  auto h = bulk_hits.begin();
+  if (bulk_hits.size() == HITS_PER_INSERT) {
+    for (int i = 0; i < HITS_PER_INSERT; ++i, ++h) {
+      sqlite3_bind_int(st_add_hits, 10 * i + 1, bid);
+      sqlite3_bind_int(st_add_hits, 10 * i + 2, h->n[0]);
+      for (int j = 0; j < 8; ++j)
+        sqlite3_bind_double(st_add_hits, 10 * i + 3 + j, h->v[j]);
+    }
+    step_commit(st_add_hits);
+  }
+  // any left over are written singly
+  for (; h != bulk_hits.end(); ++h) {
+    sqlite3_bind_int(st_add_hit, 1, bid);
+    sqlite3_bind_int(st_add_hit, 2, h->n[0]);
+    for (int j = 0; j < 8; ++j)
+      sqlite3_bind_double(st_add_hit, 3 + j, h->v[j]);
+    step_commit(st_add_hit);
+  }
+  bulk_hits.clear();
+};
+
+void
+DB_Filer::write_compact_hit(const Write_Record & w) {
+  long long ticks = llround(w.v[0] * TICKS_PER_SECOND);
+  sqlite3_bind_int(st_add_compact_hit, 1, bid);
+  sqlite3_bind_int(st_add_compact_hit, 2, w.n[0]);
+  auto c = hit_chains.find(w.n[0]);
+  if (c == hit_chains.end()) {
+    // first hit of this run in this batch; later ones are relative to it
+    Hit_Chain hc = {ticks, 0};
+    hit_chains[w.n[0]] = hc;
+    sqlite3_bind_int64(st_add_compact_hit, 3, 0);
+    sqlite3_bind_int64(st_add_compact_hit, 4, ticks);
+  } else {
+    // hits from a tag are separated by nearly whole multiples of its
+    // period, so the change in interval is usually small, or zero
+    long long delta = ticks - c->second.ticks;
+    sqlite3_bind_int64(st_add_compact_hit, 3, delta - c->second.delta);
+    sqlite3_bind_null(st_add_compact_hit, 4);
+    c->second.ticks = ticks;
+    c->second.delta = delta;
+  }
+  // dividing is correctly rounded, as is the view's decoding, so this
+  // tells whether the timestamp is recovered exactly from ticks
+  if (ticks / TICKS_PER_SECOND == w.v[0])
+    sqlite3_bind_null(st_add_compact_hit, 5);
+  else
+    sqlite3_bind_double(st_add_compact_hit, 5, w.v[0]);
+  for (int i = 1; i < 8; ++i) {
+    if (isnan(w.v[i]))
+      sqlite3_bind_null(st_add_compact_hit, 5 + i);
+    else
+      sqlite3_bind_int64(st_add_compact_hit, 5 + i, llround(w.v[i] * HIT_SCALE[i]));
+  }
+  step_commit(st_add_compact_hit);
+};
+
+void
+DB_Filer::write_open_runs() {
+  for (auto r = open_runs.begin(); r != open_runs.end(); ++r) {
+    sqlite3_bind_int(st_begin_run, 1, r->first);
+    sqlite3_bind_int(st_begin_run, 3, r->second.mid);
+    sqlite3_bind_int(st_begin_run, 4, r->second.ant);
+    sqlite3_bind_double(st_begin_run, 5, r->second.ts);
+    step_commit(st_begin_run);
+  }
+  open_runs.clear();
+};
+
+void
+DB_Filer::write_block(Write_Block & b) {
+  for (auto w = b.recs.begin(); w != b.recs.end(); ++w) {
+    switch (w->type) {
+    case W_BEGIN_RUN:
+      if (bulk_load) {
+        Open_Run r = {w->n[1], w->n[2], w->v[0]};
+        open_runs[w->n[0]] = r;
+        break;
+      }
+      sqlite3_bind_int(st_begin_run, 1, w->n[0]); // bind run ID
+      // batchIDbegin bound at start of batch
+      sqlite3_bind_int(st_begin_run, 3, w->n[1]); // bind tag ID
+      sqlite3_bind_int(st_begin_run, 4, w->n[2]); // bind antenna
+      sqlite3_bind_double(st_begin_run, 5, w->v[0]); // bind tsBegin
+      step_commit(st_begin_run);
+      break;
+
+    case W_END_RUN:
+      {
+        auto r = open_runs.find(w->n[0]);
+        if (r != open_runs.end()) {
+          // run began in this batch, so write all of it
+          sqlite3_bind_int(st_add_run, 1, w->n[0]);
+          // batchIDbegin bound at start of batch
+          sqlite3_bind_int(st_add_run, 3, r->second.mid);
+          sqlite3_bind_int(st_add_run, 4, r->second.ant);
+          sqlite3_bind_double(st_add_run, 5, r->second.ts);
+          sqlite3_bind_int(st_add_run, 6, w->n[1]);
+          sqlite3_bind_double(st_add_run, 7, w->v[0]);
+          sqlite3_bind_int(st_add_run, 8, w->n[2] ? 0: 1);
+          step_commit(st_add_run);
+          open_runs.erase(r);
+        } else {
+          sqlite3_bind_int(st_end_run, 1, w->n[1]); // bind number of hits in run
+          sqlite3_bind_double(st_end_run, 2, w->v[0]); // bind tsEnd
+          sqlite3_bind_int(st_end_run, 3, w->n[2] ? 0: 1); // is this run really finished?
+          sqlite3_bind_int(st_end_run, 4, w->n[0]);  // bind run number
+          step_commit(st_end_run);
+        }
+      }
+
+      // add record indicating this run overlaps this batch
+      // (this doesn't necessarily mean the run had hits in this batch; it might
+      // simply have ended due to no more hits, or the run might still be active
+      // because a short batch didn't span enough time to expire the candidate)
+      sqlite3_bind_int(st_end_run2, 2, w->n[0]); // bind run ID
+      step_commit(st_end_run2);
+      break;
+
+    case W_HIT:
+      if (compact_hits) {
+        write_compact_hit(*w);
+        break;
+      }
+      if (bulk_load) {
+        bulk_hits.push_back(*w);
+        if (bulk_hits.size() == HITS_PER_INSERT)
+          write_bulk_hits();
+        break;
+      }
+      sqlite3_bind_int   (st_add_hit, 1, bid);
+      sqlite3_bind_int   (st_add_hit, 2, w->n[0]);
+      for (int i = 0; i < 8; ++i)
+        sqlite3_bind_double(st_add_hit, 3 + i, w->v[i]);
+      step_commit(st_add_hit);
+      break;
+
+    case W_GPS_FIX:
+      sqlite3_bind_double   (st_add_GPS_fix, 1, w->v[0]);
+      sqlite3_bind_int      (st_add_GPS_fix, 2, bid);
+      // for now, there is no gpsts, so we use null; eventually:  sqlite3_bind_double   (st_add_GPS_fix, 3, gpsts);
+      sqlite3_bind_double   (st_add_GPS_fix, 3, w->v[1]);
+      sqlite3_bind_double   (st_add_GPS_fix, 4, w->v[2]);
+      sqlite3_bind_double   (st_add_GPS_fix, 5, w->v[3]);
+      step_commit(st_add_GPS_fix);
+      break;
+
+    case W_TIME_FIX:
+      {
+        char fixType = w->n[1];
+        sqlite3_bind_int    (st_add_time_fix, 1, w->n[0]);
+        sqlite3_bind_double (st_add_time_fix, 2, w->v[0]);
+        sqlite3_bind_double (st_add_time_fix, 3, w->v[1]);
+        sqlite3_bind_double (st_add_time_fix, 4, w->v[2]);
+        sqlite3_bind_double (st_add_time_fix, 5, w->v[3]);
+        sqlite3_bind_text   (st_add_time_fix, 6, & fixType, 1, SQLITE_TRANSIENT);
+        step_commit(st_add_time_fix);
+      }
+      break;
+
+    case W_PULSE_COUNT:
+      sqlite3_bind_int    (st_add_pulse_count, 1, bid);
+      sqlite3_bind_int    (st_add_pulse_count, 2, w->n[0]);
+      sqlite3_bind_double (st_add_pulse_count, 3, w->v[0]);
+      sqlite3_bind_int    (st_add_pulse_count, 4, w->n[1]);
+      step_commit(st_add_pulse_count);
+      break;
+
+    case W_PULSE:
+      sqlite3_bind_int   (st_add_pulse, 1, bid);
+      sqlite3_bind_double(st_add_pulse, 2, w->v[0]);
+      sqlite3_bind_int   (st_add_pulse, 3, w->n[0]);
+      for (int i = 1; i < 5; ++i)
+        sqlite3_bind_double(st_add_pulse, 3 + i, w->v[i]);
+      step_commit(st_add_pulse);
+      break;
+
+    case W_RECV_PARAM:
+      sqlite3_bind_int   (st_add_recv_param, 1, bid);
+      sqlite3_bind_double(st_add_recv_param, 2, w->v[0]);
+      sqlite3_bind_int   (st_add_recv_param, 3, w->n[0]);
+      sqlite3_bind_text  (st_add_recv_param, 4, b.text[w->n[2]].c_str(), -1, SQLITE_STATIC);
+      sqlite3_bind_double(st_add_recv_param, 5, w->v[1]);
+      sqlite3_bind_int   (st_add_recv_param, 6, w->n[1]);
+      sqlite3_bind_text  (st_add_recv_param, 7, b.text[w->n[2] + 1].c_str(), -1, SQLITE_STATIC);
+      step_commit(st_add_recv_param);
+      break;
+
+    case W_BATCH_FILE:
+      sqlite3_bind_int(st_add_batch_file, 1, bid);
+      sqlite3_bind_int(st_add_batch_file, 2, w->n[0]);
+      step_commit(st_add_batch_file);
+      break;
+    }
+  }
+  // without a writer thread, blocks hold a single record, so hits are
+  // kept for a multi-row insert until flush()
+  if (writer && writer_pid == getpid())
+    write_bulk_hits();
+  b.recs.clear();
+  b.text.clear();
 };
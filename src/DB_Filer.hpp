@@ -8,12 +8,62 @@
 #include "Tag_Database.hpp"
 #include "Pulse.hpp"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <map>
+#include <sys/types.h>
+
+class Shard_Journal;
+class Output_Sink;
+class Blob_Prefetcher;
+
 /*
   DB_Filer - manage sqlite databases (input for data file indexes, resuming state; output for detections and saving state)
+
+  Once set_write_queue() is called with a non-zero size, runs, hits,
+  pulses, GPS and time fixes, pulse counts, receiver parameters and
+  batch files are not written when reported, but appended to a block
+  of records which is handed to a writer thread when full.  That
+  thread writes them to the database, in transactions of steps_per_tx
+  statements.  Run IDs are still assigned when begin_run() is called.
+  flush() waits until all records reported so far have been written;
+  methods which write anything else, or which depend on what has been
+  written (end_batch, save_findtags_state, ...), call it first.
+
+  Threads do not survive fork(), so in a process other than the one
+  which called set_write_queue(), records are written as they are
+  reported.  Call flush() before forking.
+
+  With set_bulk_load(true), a run begun in this batch is written once,
+  as a complete row, when it ends (or the batch does), rather than
+  inserted by begin_run() and updated by end_run().  Hits are inserted
+  HITS_PER_INSERT at a time by a multi-row insert, and the connection
+  doesn't wait for writes to reach the disk.  Without a writer thread,
+  hits are kept until there are enough for that, or until flush().
+
+  Runs, hits, GPS fixes, pulse counts, pulses and receiver parameters
+  go to an Output_Sink.  This is an SQLite_Sink, which hands them to
+  the write queue above; set_sink() replaces it with another (e.g. CSV
+  files).  Batches, batch files, time fixes, program parameters,
+  ambiguities and saved state are always recorded in the database.
+
+  A receiver database can store its hits compactly: set_compact_hits()
+  replaces an empty `hits` table with `hitsCompact`, which holds each
+  hit's timestamp as the change from the previous interval between
+  hits of the same run, and its other values as integers in small
+  units, and a view called `hits` which decodes them, with the same
+  columns as the table it replaces.  A database with such a view is
+  always written this way.  The view is read-only: hits can't be
+  deleted or changed through it.
 */
 
 class DB_Filer {
 
+  friend class SQLite_Sink;
+
 public:
   static const int MAX_ANT_NAME_CHARS = 11; //!< maximum number of chars in an antenna name; currently 11, for "A1+A2+A3+A4"
 
@@ -33,6 +83,16 @@ public:
     double lon;
   } DTA_Record;
 
+  typedef struct _pulse_record {
+    long long rowid;
+    Timestamp ts;
+    Port_Num ant;
+    Frequency_MHz antFreq;
+    Frequency_Offset_kHz dfreq;
+    SignaldB sig;
+    SignaldB noise;
+  } Pulse_Record;
+
   static const int MAX_TAGS_PER_AMBIGUITY_GROUP = 6;
 
   DB_Filer (const string &out, const string &prog_name, const string &prog_version, double prog_ts, int bootnum=1, double minGPSdt = 300); // initialize a filer on an existing sqlite database file
@@ -57,24 +117,42 @@ public:
 
   void end_batch(Timestamp tsStart, Timestamp tsEnd); //!< end current batch
 
+  void drop_batch(); //!< remove the current batch, and the records of the files and program it used, as when it produced no output
+
   void save_ambiguity(Motus_Tag_ID proxyID, const Ambiguity::AmbigIDs & tags); // save one ambiguity group
 
   void load_ambiguity(); // restore all ambiguity groups
 
-  void save_findtags_state(Timestamp tsData, Timestamp tsRun, std::string state, int version);
+  void save_findtags_state(Timestamp tsData, Timestamp tsRun, const std::string & state, int version); //!< save the serialized state of the foray, which is stored as given; Tag_Foray compresses it
 
   bool load_findtags_state(long long monoBN, Timestamp & tsData, Timestamp & tsRun, std::string & state, int version, int &blob_version);
 
+  void set_blob_prefetch(unsigned int depth); //!< set how many files beyond the current one are read and decompressed in parallel, ahead of use; takes effect for the next start_blob_reader()
+
+  void set_db_memory(double cache_mb, double mmap_mb); //!< set the page cache size and the amount of the database file memory-mapped, for each connection
+
+  void set_max_blob(size_t bytes); //!< set the largest uncompressed file held in memory whole; larger files are streamed in pieces of about this size; takes effect for the next start_blob_reader()
+
   void start_blob_reader(int monoBN); //!< initialize reading of filecontents blobs for a given boot number
 
-  void seek_blob (Timestamp tsseek); //!< skip to the first blob whose file timestamp >= ts.  This is used for resuming.
+  void seek_blob (Timestamp tsseek, int offset = 0); //!< skip to the first blob whose file timestamp >= ts, starting offset bytes into it.  This is used for resuming.
 
-  bool get_blob (const char **bufout, int * lenout, Timestamp *ts); //!< get the next available blob; return true on success, false if none; set caller's pointer and length
+  bool get_blob (const char **bufout, int * lenout, Timestamp *ts, int * offset); //!< get the next available blob, or the next piece of a large one; return true on success, false if none; set caller's pointer and length, and the offset of the pointer into the blob
 
-  void rewind_blob_reader(Timestamp origin); //!< reset blob reader to start of stream; might be beginning of boot session, or part way into it
+  void rewind_blob_reader(Timestamp origin, int offset = 0); //!< reset blob reader to start of stream; might be beginning of boot session, or part way into it
 
   void end_blob_reader(); //!< finalize blob reader
 
+  void restart_blob_reader(); //!< read blobs with a new prefetcher; used by forked time-shard workers, which must not use the parent's
+
+  void get_file_timestamps(int monoBN, std::vector < Timestamp > & ts); //!< get the timestamps of all files in a boot session, in the order blobs are read
+
+  void add_batch_file(int fileID); //!< record use of an input file
+
+  void set_journal(Shard_Journal * j); //!< divert output to a time-shard journal; if j is 0, output goes to the database again
+
+  void set_sink(Output_Sink * s); //!< send output to s instead of the database; s is closed and deleted with this filer; if s is 0, output goes to the database again
+
   void start_DTAtags_reader(Timestamp ts = 0, int bootnum = 0); //!< initialize reading of DTAtags lines, starting at the specified timestamp and boot number
 
   bool get_DTAtags_record(DTA_Record &dta ); //!< get the next DTAtags record; return true on success, false if none left; set items in &dat.
@@ -83,14 +161,51 @@ public:
 
   void rewind_DTAtags_reader(); //!< rewind DTAtags reader
 
+  void start_pulses_reader(int monoBN, Timestamp ts = 0, long long rowid = 0); //!< initialize reading of the pulses recorded for a boot session by --pulses_only, in order by timestamp, starting after the pulse with the given timestamp and rowid
+
+  bool get_pulses_record(Pulse_Record &pr); //!< get the next pulses record; return true on success, false if none left
+
+  void end_pulses_reader(); //!< finalize pulses reader
+
   void add_pulse(int ant, Pulse &p); //!< record a pulse
 
+  typedef enum {
+    PULSES_INDEXED = 0, //!< pulses are inserted straight into the indexed `pulses` table
+    PULSES_STAGED  = 1, //!< pulses are inserted into an unindexed temporary table, and moved into `pulses`, in order by timestamp, by end_batch(), or by the destructor if the batch isn't ended, e.g. after an error
+    PULSES_SKIPPED = 2  //!< pulses are not recorded
+  } Pulse_Capture;
+
+  void set_pulse_capture(Pulse_Capture pc); //!< set how add_pulse() records pulses
+
   void add_recv_param(Timestamp ts, int ant, char *param, double val, int error, char *extra); //!< record a receiver parameter setting
 
+  void set_write_queue(unsigned int records); //!< write output records from a separate thread, with up to about this many queued for it; 0 means write them as they are reported
+
+  void set_bulk_load(bool on); //!< write runs and hits in bulk, and don't sync the database file to disk; see above
+
+  void set_compact_hits(); //!< store hits compactly; see above.  Throws if the database already has hits stored the usual way.
+
+  void flush(); //!< wait until all output records reported so far have been written to the database; throws if the writer thread failed
+
 protected:
   // settings
 
   sqlite3 * outdb; //<! handle to sqlite connection
+  sqlite3 * indb; //<! read-only connection to the same database, for input streams; same as outdb if the database can't use WAL mode
+
+  string db_name; //!< path to database file
+  string file_repo; //!< path to folder of raw receiver files; from the `meta` table
+  int blob_monoBN; //!< boot number whose blobs are being read
+  Blob_Prefetcher * blobs; //!< reads and decompresses the files of the boot session being read
+  unsigned int blob_prefetch; //!< number of files to read ahead
+  size_t max_blob; //!< largest uncompressed file held in memory whole
+  int last_blob_file; //!< fileID of the blob most recently handed out, so that each file is recorded in batchFiles once when read in pieces
+
+  static const unsigned int DEFAULT_BLOB_PREFETCH = 2;
+
+  Shard_Journal * journal; //!< if not 0, output is diverted here instead of to the database
+
+  Output_Sink * sink; //!< unless output is diverted to journal, it goes here; an SQLite_Sink unless set_sink() was called
 
   // sqlite3 pre-compiled statements
   sqlite3_stmt * st_begin_batch; //!< create a batch record
@@ -100,6 +215,9 @@ protected:
   sqlite3_stmt * st_end_run; //!< end a run
   sqlite3_stmt * st_end_run2; //!< end a run - part 2
   sqlite3_stmt * st_add_hit; //!< add a hit to a run
+  sqlite3_stmt * st_add_run; //!< add a whole run, for bulk_load
+  sqlite3_stmt * st_add_hits; //!< add HITS_PER_INSERT hits, for bulk_load
+  sqlite3_stmt * st_add_compact_hit; //!< add a hit to hitsCompact
   sqlite3_stmt * st_add_prog; //!< add batch program entry
   sqlite3_stmt * st_add_GPS_fix; //!< add a GPS fix
   sqlite3_stmt * st_add_time_fix; //!< add a time jump
@@ -111,9 +229,11 @@ protected:
   sqlite3_stmt * st_save_findtags_state; //!< save state of running findtags, for pause
   sqlite3_stmt * st_load_findtags_state; //!< load state of paused findtags, for resume
   sqlite3_stmt * st_get_file_repo; //!< check whether we have a `fileRepo` symbol in DB meta table
-  sqlite3_stmt * st_get_blob; //!< grab and decompress file contents
   sqlite3_stmt * st_get_DTAtags; //!< grab DTA tag records
+  sqlite3_stmt * st_get_pulses; //!< grab pulses recorded by --pulses_only
   sqlite3_stmt * st_add_pulse; //!< record a pulse
+  sqlite3_stmt * st_merge_pulses; //!< move staged pulses into the pulses table
+  sqlite3_stmt * st_clear_pulses; //!< empty the table of staged pulses
   sqlite3_stmt * st_add_recv_param; //!< record a receiver parameter setting
   sqlite3_stmt * st_add_batch_file; //!< record use of an input file
   sqlite3_stmt * st_load_extension; //!< load an extension library
@@ -134,12 +254,18 @@ protected:
 
   int bootnum; //!< boot number for current batch
 
+  Pulse_Capture pulse_capture; //!< how add_pulse() records pulses
+
+  void merge_pulses(); //!< move staged pulses into the pulses table
+
   double minGPSdt; //!< minimum time step for GPS fixes
 
   double lastGPSts; //!< most recent GPS timestamp
 
   void step_commit(sqlite3_stmt *st); //!< step statement, and if number of steps has reached steps_per_tx, commit and start new tx
 
+  void load_extension(sqlite3 * db); //!< load Sqlite_Compression_Extension.so from the folder holding this program, into connection db
+
   int Check(int code, int wants, int wants2, int wants3, const std::string & err); //!< check that sqlite3 result is one of specified values, otherwise throuw runtime error with given text; -1 is not a valid SQLITE return code
   int Check(int code, int wants, int wants2, const std::string & err) {
     return Check(code, wants, wants2, -1, err);
@@ -153,16 +279,97 @@ protected:
     return Check(code, SQLITE_OK, -1, -1, err);
   };
 
+  int Check_Read(int code, const std::string & err); //!< like Check(code, err), but for a call on indb
+
   void begin_tx(); //!< begin transaction, which is just a bunch of insert queries
   void end_tx(); //!< end transaction
 
+  // output records queued for the writer thread
+
+  typedef enum {
+    W_BEGIN_RUN,    //!< n: run ID, tag ID, antenna; v: tsBegin
+    W_END_RUN,      //!< n: run ID, hits, countOnly; v: tsEnd
+    W_HIT,          //!< n: run ID; v: ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop
+    W_GPS_FIX,      //!< v: ts, lat, lon, alt
+    W_TIME_FIX,     //!< n: monoBN, fixType; v: tsLow, tsHigh, by, error
+    W_PULSE_COUNT,  //!< n: antenna, count; v: hourBin
+    W_PULSE,        //!< n: antenna; v: ts, antFreq, dfreq, sig, noise
+    W_RECV_PARAM,   //!< n: antenna, error, index of param in block text (extra follows it); v: ts, val
+    W_BATCH_FILE    //!< n: fileID
+  } Write_Type;
+
+  struct Write_Record {
+    Write_Type type;
+    int n[3];     //!< integer fields
+    double v[8];  //!< real fields
+  };
+
+  struct Write_Block {
+    std::vector < Write_Record > recs;
+    std::vector < std::string > text; //!< strings for W_RECV_PARAM records
+  };
+
+  static const unsigned int WRITE_BLOCK_RECORDS = 4096; //!< records handed to the writer thread at a time
+
+  Write_Block fill;                    //!< block being filled by the caller
+  std::thread * writer;                //!< if not 0, writes blocks of output records
+  pid_t writer_pid;                    //!< process in which writer was started
+  size_t max_pending;                  //!< maximum number of full blocks waiting for writer
+  std::mutex w_mutex;                  //!< protects the following:
+  std::condition_variable w_ready;     //!< signalled when a block is queued, or writer should stop
+  std::condition_variable w_done;      //!< signalled when writer has written a block
+  std::deque < Write_Block > pending;  //!< full blocks waiting for writer
+  bool w_busy;                         //!< true while writer is writing a block
+  bool w_stopping;                     //!< true when writer should stop once pending is empty
+  std::string w_error;                 //!< error which stopped a block from being written
+
+  void queue(Write_Record & w); //!< write w now, or add it to the block for the writer thread
+  void hand_off();              //!< queue the block being filled for the writer thread
+  bool bulk_load; //!< if true, write runs and hits in bulk
+
+  static const int HITS_PER_INSERT = 64; //!< hits written by each step of st_add_hits; 10 variables each must fit in SQLite's limit of 999
+
+  struct Open_Run {
+    Motus_Tag_ID mid;
+    int ant;
+    Timestamp ts;
+  };
+
+  std::map < Run_ID, Open_Run > open_runs; //!< with bulk_load, runs begun but not yet written; used only while writing records
+
+  std::vector < Write_Record > bulk_hits; //!< with bulk_load, hits not yet written; without a writer thread, these are kept until flush()
+
+  bool compact_hits; //!< if true, hits are written to hitsCompact
+
+  static constexpr double TICKS_PER_SECOND = 1e4; //!< units of hitsCompact timestamps
+  static const double HIT_SCALE[8]; //!< for hitsCompact, each hit value is multiplied by this and rounded; the first, ts, is not stored this way
+
+  struct Hit_Chain {
+    long long ticks; //!< timestamp of the run's latest hit, in ticks
+    long long delta; //!< ticks between the run's latest two hits; 0 if just one
+  };
+
+  std::map < Run_ID, Hit_Chain > hit_chains; //!< with compact_hits, the runs with hits in this batch; used only while writing records
+
+  void write_compact_hit(const Write_Record & w); //!< write a W_HIT record to hitsCompact
+
+  void write_block(Write_Block & b); //!< write a block's records to the database
+  void write_bulk_hits(); //!< write bulk_hits, as many as possible with st_add_hits
+  void write_open_runs(); //!< write runs not yet ended, as begin_run would have
+  void write_loop();            //!< body of the writer thread
+  void stop_writer();           //!< write all queued records, and end the writer thread
+
   static const char * q_begin_batch;
   static const char * q_drop_saved_state;
   static const char * q_end_batch;
   static const char * q_begin_run;
+  static const char * q_add_run;
   static const char * q_end_run;
   static const char * q_end_run2;
   static const char * q_add_hit;
+  static const char * q_compact_hits;
+  static const char * q_compact_hits_view;
+  static const char * q_add_compact_hit;
   static const char * q_add_GPS_fix;
   static const char * q_add_time_fix;
   static const char * q_add_pulse_count;
@@ -171,9 +378,13 @@ protected:
   static const char * q_load_findtags_state;
   static const char * q_save_findtags_state;
   static const char * q_get_file_repo;
-  static const char * q_get_blob;
+  static const char * q_get_blob_files;
   static const char * q_get_DTAtags;
+  static const char * q_get_pulses;
   static const char * q_add_pulse;
+  static const char * q_stage_pulses;
+  static const char * q_add_staged_pulse;
+  static const char * q_merge_pulses;
   static const char * q_add_recv_param;
   static const char * q_add_batch_file;
   static const char * q_load_extension;
@@ -1,18 +1,56 @@
 #include "Data_Source.hpp"
 #include "Lotek_Data_Source.hpp"
 #include "SG_File_Data_Source.hpp"
+#include "SG_Mmap_Data_Source.hpp"
+#include "Pulse_Archive_Data_Source.hpp"
+#include "Pulses_SQLite_Data_Source.hpp"
 #include "SG_SQLite_Data_Source.hpp"
 
 #include <iostream>
+#include <string.h>
+#include <sys/stat.h>
 
 Data_Source::Data_Source() {};
 
 Data_Source::~Data_Source(){};
 
+bool
+Data_Source::getline(char * buf, int maxLen) {
+  const char * line;
+  int len;
+  if (! next_line(& line, & len))
+    return false;
+  len = std::min(len, maxLen);
+  memcpy(buf, line, len);
+  buf[len] = '\0';
+  return true;
+};
+
+bool
+Data_Source::next_line(const char ** line, int * len) {
+  if (! getline(lineBuf, MAX_LINE_SIZE))
+    return false;
+  * line = lineBuf;
+  * len = strlen(lineBuf);
+  return true;
+};
+
+void
+Data_Source::seek_file(Timestamp ts) {
+  throw std::runtime_error("This data source does not support seeking to a file");
+};
+
 Data_Source *
 Data_Source::make_SG_source(std::string infile) {
   if (infile.length() == 0)
     return new SG_File_Data_Source(& std::cin);
+  // regular files are mapped; others (e.g. named pipes) are streamed
+  struct stat st;
+  if (stat(infile.c_str(), & st) == 0 && S_ISREG(st.st_mode)) {
+    if (Pulse_Archive_Data_Source::is_archive(infile))
+      return new Pulse_Archive_Data_Source(infile);
+    return new SG_Mmap_Data_Source(infile);
+  }
   return new SG_File_Data_Source(new std::ifstream(infile));
 };
 
@@ -22,7 +60,12 @@ Data_Source::make_SQLite_source(DB_Filer * db, unsigned int monoBN) {
 };
 
 Data_Source *
-Data_Source::make_Lotek_source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum) {
-  return new Lotek_Data_Source(db, tdb, defFreq, bootnum);
+Data_Source::make_pulses_source(DB_Filer * db, int monoBN) {
+  return new Pulses_SQLite_Data_Source(db, monoBN);
+};
+
+Data_Source *
+Data_Source::make_Lotek_source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum, bool detections) {
+  return new Lotek_Data_Source(db, tdb, defFreq, bootnum, detections);
 
 };
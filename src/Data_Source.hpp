@@ -11,14 +11,31 @@
 
 using boost::serialization::make_nvp;
 
+struct SG_Record;
+
 
 class Data_Source {
 
 public:
   Data_Source();
-  ~Data_Source();
+  virtual ~Data_Source();
+
+  //!< Sources provide lines through either or both of getline() and
+  //!< next_line(); each has a default implementation as an adapter for
+  //!< the other, so a source must override at least one of them.
+  //!< Sources which hold their input in memory should override
+  //!< next_line(), so that lines needn't be copied.
+
+  virtual bool getline(char * buf, int maxLen); //!< copy the next line to buf, truncated to maxLen chars and 0-terminated; false if none
+
+  virtual bool next_line(const char ** line, int * len); //!< point *line at the next line, *len chars long, without its '\n' and not 0-terminated; valid until the next call; false if none
 
-  virtual bool getline(char * buf, int maxLen) = 0;
+  //!< Sources which hold records already parsed provide them through
+  //!< next_record() instead, and return true from has_records().
+
+  virtual bool has_records() { return false; }; //!< true if records come from next_record(), rather than from lines
+
+  virtual bool next_record(SG_Record & r) { return false; }; //!< get the next record; false if none
 
   virtual void serialize(boost::archive::binary_iarchive & ar, const unsigned int version){};
 
@@ -26,12 +43,18 @@ public:
 
   virtual void rewind(){};
 
+  virtual void seek_file(Timestamp ts); //!< continue reading from the start of the first file with timestamp >= ts; used by time shards
+
   static Data_Source * make_SQLite_source(DB_Filer * dbf, unsigned int monoBN=0);
 
   static Data_Source * make_SG_source(std::string infile);
 
-  static Data_Source * make_Lotek_source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum);
+  static Data_Source * make_pulses_source(DB_Filer * dbf, int monoBN);
+
+  static Data_Source * make_Lotek_source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum, bool detections=false);
 
+protected:
+  char lineBuf[MAX_LINE_SIZE + 1]; //!< buffer for the default next_line()
 };
 
 #endif // DATA_SOURCE
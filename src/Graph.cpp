@@ -4,6 +4,7 @@
 #include "find_tags_common.hpp"
 #include "Graph.hpp"
 #include <cmath>
+#include <algorithm>
 
 Graph::Graph(std::string vizPrefix) :
   vizPrefix(vizPrefix),
@@ -278,6 +279,44 @@ Graph::find(Tag * tag, double tol, double timeFuzz) {
   return 0;
 };
 
+std::vector < Tag * >
+Graph::getTags() {
+  // every tag in the graph appears in the set of at least one node
+  TagSet ts;
+  for (auto i = setToNode.begin(); i != setToNode.end(); ++i)
+    if (i->first)
+      for (auto j = i->first->s.begin(); j != i->first->s.end(); ++j)
+        ts.insert(j->first);
+  std::vector < Tag * > rv(ts.begin(), ts.end());
+  std::sort(rv.begin(), rv.end(), [](Tag * a, Tag * b) {return a->motusID < b->motusID;});
+  return rv;
+};
+
+void
+Graph::restoreTag(Tag * tag, double tol, double timeFuzz, double maxTime, unsigned int timestamp_wonkiness) {
+#ifdef ACTIVE_TAG_DIAGNOSTICS
+  active_tags.insert(tag);
+#endif // ACTIVE_TAG_DIAGNOSTICS
+  _addTag(tag, tol, timeFuzz, maxTime, timestamp_wonkiness);
+};
+
+Node *
+Graph::restoreNode(Node * n) {
+  // n holds only the set of tag phases for a state of the graph this
+  // one was rebuilt from.  The root isn't in setToNode under its set
+  // (all tags at phase 0, or the empty set if there are none), but it
+  // is the only state with that set.
+  if (n->_valid) {
+    if (n->s == Set::empty() || *n->s == *_root->s)
+      return _root;
+    auto i = setToNode.find(n->s);
+    if (i != setToNode.end())
+      return i->second;
+  }
+  n->_valid = false;
+  return n;
+};
+
 
 void
 Graph::viz() {
@@ -630,19 +669,29 @@ Graph::renTagRec(Node * n, Tag *t1, Tag *t2) {
       renTagRec(i->second, t1, t2);
 
   // for this node's set, replace any tagphase having t1
-  // with a tagphase having t2
+  // with a tagphase having t2; the set's hash changes with it, so
+  // it is re-entered in setToNode (the root is mapped from 0, not
+  // from its set)
 
   TagPhaseSet & s = n->s->s;
   auto r = s.equal_range(t1);
+  if (r.first == r.second)
+    return;
 
+  if (n != _root)
+    unmapSet(n->s);
   for (auto i = r.first; i != r.second; /**/) {
     auto j = i;
     ++j;
     auto p = i->second;
     s.erase(i);
-    s.insert(std::make_pair(t2, p));
+    n->s->hash ^= Set::hashT(t1);
+    if (s.insert(std::make_pair(t2, p)).second)
+      n->s->hash ^= Set::hashT(t2);
     i = j;
   }
+  if (n != _root)
+    mapSet(n->s, n);
 };
 
 void
@@ -40,6 +40,11 @@ public:
   std::pair < Tag *, Tag * >  delTag(Tag * tag); //!< remove a tag from the tree, handling ambiguity
   void renTag(Tag *t1, Tag *t2);//!< "rename" tag t1 to tag t2
   Tag * find(Tag * tag, double tol, double timeFuzz);
+  std::vector < Tag * > getTags(); //!< return the tags (real or ambiguity proxies) in the graph, ordered by motusID
+  void restoreTag(Tag * tag, double tol, double timeFuzz, double maxTime, unsigned int timestamp_wonkiness); //!< add a tag returned by getTags() for an earlier graph;
+  // such tags are distinguishable, so there is no handling of ambiguity
+  Node * restoreNode(Node * n); //!< return the node equivalent to a deserialized placeholder, or the placeholder itself,
+  // marked invalid, if the graph has no such node
   void viz();
   void dumpSetToNode();
   void validateSetToNode();
@@ -102,17 +107,6 @@ public:
 protected:
   void findTagRec(Node * n, Tag *tag); //!< dump a list of nodes mentioning the given tag
 #endif
-
-public:
-
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version) {
-    ar & BOOST_SERIALIZATION_NVP( _root );
-    ar & BOOST_SERIALIZATION_NVP( vizPrefix );
-    ar & BOOST_SERIALIZATION_NVP( numViz );
-    ar & BOOST_SERIALIZATION_NVP( setToNode );
-    ar & BOOST_SERIALIZATION_NVP( stamp );
-  };
 };
 
 #endif // GRAPH_HPP
@@ -1,13 +1,16 @@
 #include "Lotek_Data_Source.hpp"
-#include <sstream>
 #include <cstdio>
+#include <cmath>
+#include <limits>
+#include <string.h>
 
-Lotek_Data_Source::Lotek_Data_Source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum) :
+Lotek_Data_Source::Lotek_Data_Source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum, bool detections) :
   db(db),
   done(false),
   sgbuf(),
   latestInputTS(0),
-  bootnum(bootnum)
+  bootnum(bootnum),
+  detections(detections)
 {
   // generate the map from (codeSet, ID) -> Tag *
   auto kf = tdb->get_nominal_freqs();
@@ -43,46 +46,68 @@ Lotek_Data_Source::getInputLine() {
  };
 
 bool
-Lotek_Data_Source::getline(char * buf, int maxLen) {
+Lotek_Data_Source::next_line(const char ** line, int * len) {
+  return false;
+};
+
+bool
+Lotek_Data_Source::next_record(SG_Record & r) {
 
   for(;;) {
     // wait until either the true input is done, or
-    // we have sufficiently old data in sgbuf (i.e. lines which
+    // we have sufficiently old data in sgbuf (i.e. records which
     // are old enough to be guaranteed (by the value of MAX_LEAD_SECONDS)
     // that no older data will be generated from subsequent input records
     auto i = sgbuf.begin();
     if (i != sgbuf.end() && i->first + MAX_LEAD_SECONDS <= latestInputTS) {
-      // easy case - there's a sufficiently old line in the buffer
-      strncpy(buf, i->second.c_str(), maxLen);
-#ifdef DEBUG
-      std::cerr << i->second << std::endl;
-#endif
+      // easy case - there's a sufficiently old record in the buffer
+      r = i->second;
       sgbuf.erase(i);
       return true;
     }
-    // no lines in sgbuf are sufficiently old.  If there are no true
+    // no records in sgbuf are sufficiently old.  If there are no true
     // input lines left, we're done (we save insufficiently old
-    // sgbuf lines until the next time the algorithm is run with
+    // sgbuf records until the next time the algorithm is run with
     // subsequent data, because there might be pulses from there
     // which precede some of those in the current sgbuf.
 
     if (done)
       return false;
 
-    // typical case; no sufficiently old lines left in sgbuf, but we haven't
+    // typical case; no sufficiently old records left in sgbuf, but we haven't
     // reached EOF on input
 
     if (getInputLine())
       translateLine();
 
-    // loop around until eof or a line is found
+    // loop around until eof or a record is found
   }
 };
 
+void
+Lotek_Data_Source::emit(SG_Record & r) {
+  sgbuf.insert(std::make_pair(dtar.ts, r));
+};
+
+double
+Lotek_Data_Source::round_sig(double x, int digits) {
+  // records used to be formatted as text with this many significant
+  // digits, then parsed; round the same way, so that output is unchanged
+  if (x == 0 || ! std::isfinite(x))
+    return x;
+  int places = digits - 1 - (int) floor(log10(fabs(x)));
+  if (places >= 0) {
+    double s = pow(10.0, places);
+    return round(x * s) / s;
+  }
+  double s = pow(10.0, - places);
+  return round(x / s) * s;
+};
+
 void
 Lotek_Data_Source::translateLine()
 {
-  // add appropriate SG lines to the buffer for a given Lotek line
+  // add appropriate SG records to the buffer for a given Lotek line
   // The lotek line is in components of class field dtar
   //
   // Algorithm: if the current tag detection frequency does not match the
@@ -99,22 +124,28 @@ Lotek_Data_Source::translateLine()
 
   // output a GPS fix, if the tag record has valid lat and lon; DTA files don't report altitude, so report as nan
   if (!(isnan(dtar.lat) || isnan(dtar.lon))) {
-    /* a GPS fix line like:
-       G,1458001712,44.34021,-66.118733333,21.6
-    */
-    std::ostringstream gpsRec;
-    gpsRec << "G," << std::setprecision(14) << dtar.ts << std::setprecision(8) << "," << dtar.lat << "," << dtar.lon << ",nan";
-    sgbuf.insert(std::make_pair(dtar.ts, gpsRec.str()));
+    SG_Record gps;
+    gps.type = SG_Record::GPS;
+    gps.ts = round_sig(dtar.ts, 14);
+    gps.v.lat = round_sig(dtar.lat, 8);
+    gps.v.lon = round_sig(dtar.lon, 8);
+    gps.v.alt = std::numeric_limits < double > :: quiet_NaN();
+    emit(gps);
   }
 
   latestInputTS = dtar.ts;
   if (dtar.freq != antFreq[dtar.ant + 1]) {
     antFreq[dtar.ant + 1] = dtar.freq;
-    std::ostringstream freqRec;
-    // make frequency setting record like: S,1366227448.192,5,-m,166.376,0,
-
-    freqRec << "S," << std::setprecision(14) << dtar.ts << std::setprecision(6) << "," << dtar.ant << ",-m," << dtar.freq << ",0,";
-    sgbuf.insert(std::make_pair(dtar.ts, freqRec.str()));
+    // a frequency setting record, as if from a line like: S,1366227448.192,5,-m,166.376,0,
+    SG_Record freq;
+    freq.type = SG_Record::PARAM;
+    freq.ts = round_sig(dtar.ts, 14);
+    freq.port = dtar.ant;
+    strcpy(freq.v.param_flag, "-m");
+    freq.v.param_value = round_sig(dtar.freq, 6);
+    freq.v.return_code = 0;
+    freq.v.error[0] = '\0';
+    emit(freq);
   }
 
   bool validTag = dtar.id != 999;
@@ -137,9 +168,27 @@ Lotek_Data_Source::translateLine()
     // records activity on this antenna at this time.  We use values of -999
     // (effectively sentinels) for dfreq, sig, and noise, to make sure
     // this pulse doesn't end up as part of any real detection.
-    std::ostringstream pRec;
-    pRec << "p" << dtar.ant << "," << std::setprecision(14) << dtar.ts << std::setprecision(3) << ",-999,-999,-999";
-    sgbuf.insert(std::make_pair(dtar.ts, pRec.str()));
+    SG_Record p;
+    p.type = SG_Record::PULSE;
+    p.ts = round_sig(dtar.ts, 14);
+    p.port = dtar.ant;
+    p.v.dfreq = p.v.sig = p.v.noise = -999;
+    emit(p);
+    return;
+  }
+
+  if (detections) {
+    // pass the receiver's decoding along, for Lotek_Run_Finder
+    SG_Record d;
+    d.type = SG_Record::DETECTION;
+    d.ts = round_sig(dtar.ts, 14);
+    d.port = dtar.ant;
+    d.v.dfreq = 4;
+    d.v.sig = dtar.sig;
+    d.v.noise = -96;
+    d.v.codeSet = dtar.codeSet;
+    d.v.mfgID = dtar.id;
+    emit(d);
     return;
   }
 
@@ -147,12 +196,16 @@ Lotek_Data_Source::translateLine()
   // generate a record for each tag pulse
 
   for(auto i = gg->begin(); i != gg->end(); ++i) {
-    std::ostringstream pRec;
-    // "%hd,%lf,%f,%f,%f", &port_num, &ts, &dfreq, &sig, &noise)) {
     // we use dfreq=4 to put it at the usual nominal SG frequency (i.e. funcube is tuned 4 kHz
     // below nominal, so dfreq=4 means a tag on nominal)
-    pRec << "p" << dtar.ant << "," << std::setprecision(14) << dtar.ts << std::setprecision(3) << ",4," << dtar.sig << ",-96";
-    sgbuf.insert(std::make_pair(dtar.ts, pRec.str()));
+    SG_Record p;
+    p.type = SG_Record::PULSE;
+    p.ts = round_sig(dtar.ts, 14);
+    p.port = dtar.ant;
+    p.v.dfreq = 4;
+    p.v.sig = dtar.sig; // an integer, which the text format's precision of 3 never rounded
+    p.v.noise = -96;
+    emit(p);
     dtar.ts += *i; // NB: the last gap takes us to the next burst, so is not actually used
   }
 }
@@ -172,7 +225,6 @@ Lotek_Data_Source::rewind() {
 // copy saved might be saved with motus in the future).
 
 #define SERIALIZE_FUN_BODY \
-   ar & BOOST_SERIALIZATION_NVP( sgbuf );                       \
    ar & BOOST_SERIALIZATION_NVP( latestInputTS );               \
    ar & BOOST_SERIALIZATION_NVP( antFreq );                     \
    ar & BOOST_SERIALIZATION_NVP( warned );
@@ -180,6 +232,7 @@ Lotek_Data_Source::rewind() {
 void
 Lotek_Data_Source::serialize(boost::archive::binary_iarchive & ar, const unsigned int version) {
 
+  ar & BOOST_SERIALIZATION_NVP( sgbuf );
   SERIALIZE_FUN_BODY;
 
 };
@@ -187,6 +240,7 @@ Lotek_Data_Source::serialize(boost::archive::binary_iarchive & ar, const unsigne
 void
 Lotek_Data_Source::serialize(boost::archive::binary_oarchive & ar, const unsigned int version) {
 
+  ar & BOOST_SERIALIZATION_NVP( sgbuf );
   SERIALIZE_FUN_BODY;
 
 };
@@ -48,6 +48,7 @@
 #include "Data_Source.hpp"
 #include "Tag_Database.hpp"
 #include "Tag_Candidate.hpp"
+#include "SG_Record.hpp"
 #include <map>
 #include <unordered_set>
 #include <boost/serialization/map.hpp>
@@ -57,8 +58,10 @@
 class Lotek_Data_Source : public Data_Source {
 
 public:
-  Lotek_Data_Source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum=0);
-  bool getline(char * buf, int maxLen);
+  Lotek_Data_Source(DB_Filer * db, Tag_Database *tdb, Frequency_MHz defFreq, int bootnum=0, bool detections=false);
+  bool next_line(const char ** line, int * len); //!< always false: this source provides records, not lines
+  bool has_records() { return true; };
+  bool next_record(SG_Record & r);
   static const int MAX_LOTEK_LINE_SIZE = 100;
   static const int MAX_LEAD_SECONDS = 10;  //!< maximum number of
                                          //! seconds before we dump
@@ -68,6 +71,7 @@ public:
                                          //! output pulses
   static const int MAX_ANTENNAS=8;      //!< maximum number of antennas (0: direct connection; 1-6 multiplex; -1: Lotek "Master" antenna A1+A2+A3+A4
   static const int MAX_LINE_FORMAT_CHARS=64; //!< maximum number of chars in scanf format string for an input line
+  static double round_sig(double x, int digits); //!< round x to the given number of significant decimal digits, as when it was formatted for an SG-format line
 
 
 
@@ -76,12 +80,13 @@ protected:
   typedef std::map < std::pair < short , short > , std::vector < Gap > * > tcode_t; //!< type of a map from (codeset, ID) to pulse gaps
   tcode_t tcode;                                                          //!< populated from the Lotek tag databse.
   bool done;                                                              //!< true if input stream is finished
-  std::multimap < double, std::string > sgbuf;                            //!< buffer of SG-format lines
+  std::multimap < double, SG_Record > sgbuf;                              //!< buffer of SG records
   Timestamp latestInputTS;                                                //!< timestamp of most recent input line
   std::vector < Frequency_MHz > antFreq;                                  //!< most recent listen frequency on each antenna, in MHz
   std::set < std::pair < short, short > > warned;                         //!< sets of tag/codeset combos for which 'non-existent' warning has been issued
   DB_Filer::DTA_Record dtar;                                              //!< record read from database DTAtags table
   int bootnum;                                                            //!< relative boot number of source data
+  bool detections;                                                        //!< if true, a detection of a known tag becomes a single DETECTION record, rather than its pulses
 
   // methods
 
@@ -91,6 +96,8 @@ protected:
 
   void translateLine(); //!< translate the line into zero or more SG-style records; return true if any records generated
 
+  void emit(SG_Record & r); //!< add a record to sgbuf, ordered by the timestamp of the current detection's pulse
+
   void serialize(boost::archive::binary_iarchive & ar, const unsigned int version);
   void serialize(boost::archive::binary_oarchive & ar, const unsigned int version);
 
@@ -0,0 +1,490 @@
+#include "Lotek_Run_Finder.hpp"
+
+#include "Ambiguity.hpp"
+#include "Freq_Setting.hpp"
+#include "Gap_Range.hpp"
+#include "Lotek_Data_Source.hpp"
+#include "Tag_Finder.hpp"
+#include "Tag_Foray.hpp"
+
+#include <algorithm>
+
+Lotek_Run_Finder::Lotek_Run_Finder(Tag_Database * tags, Gap pulse_slop, float time_fuzz, Gap max_time) :
+  pulse_slop(pulse_slop),
+  time_fuzz(time_fuzz),
+  max_time(max_time),
+  expansions(),
+  active(),
+  matches(),
+  finders(),
+  num_bursts(0),
+  pulses()
+{
+  // Lotek_Data_Source expands a detection using the first tag it
+  // finds with that codeset and ID, whether or not it's active
+  auto fs = tags->get_nominal_freqs();
+  for (auto f = fs.begin(); f != fs.end(); ++f) {
+    auto ts = tags->get_tags_at_freq(*f);
+    for (auto t = ts->begin(); t != ts->end(); ++t)
+      expansions.insert(std::make_pair(Lotek_ID((*t)->codeSet, (*t)->mfgID), (*t)->gaps));
+  }
+};
+
+Lotek_Run_Finder::~Lotek_Run_Finder() {
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi) {
+    std::vector < Cand_List > & cands = tfi->second;
+    for (auto cl = cands.begin(); cl != cands.end(); ++cl) {
+      for (auto ci = cl->begin(); ci != cl->end(); ++ci) {
+        Cand * c = ci->second;
+        if (c->tag_id_level == Tag_Candidate::CONFIRMED && ! c->bursts.empty())
+          dump_bursts(tfi->first.first, c);
+        delete_cand(c);
+      }
+    }
+  }
+};
+
+void
+Lotek_Run_Finder::process_event(Event e) {
+  auto t = e.tag;
+  Nominal_Frequency_kHz nf = Freq_Setting::as_Nominal_Frequency_kHz(t->freq);
+  auto & tags = active[nf];
+  switch (e.code) {
+  case Event::E_ACTIVATE:
+    {
+      if (t->active)
+        return;
+      // is there an active tag which can't be told apart from this
+      // one?  If so, replace it with a proxy for both.
+      Tag * ot = find(t, tags);
+      if (! ot) {
+        tags.push_back(t);
+      } else {
+        Tag * nt = Ambiguity::add(ot, t);
+        std::replace(tags.begin(), tags.end(), ot, nt);
+        rename(nf, ot, nt);
+        nt->active = true;
+      }
+      t->active = true;
+    }
+    break;
+  case Event::E_DEACTIVATE:
+    {
+      if (! t->active)
+        return;
+      auto p = Ambiguity::proxyFor(t);
+      if (! p) {
+        tags.remove(t);
+        drop(nf, t);
+      } else {
+        // replace the proxy with one for the remaining tags, or with
+        // the only one left
+        auto newp = Ambiguity::remove(p, t);
+        std::replace(tags.begin(), tags.end(), p, newp);
+        rename(nf, p, newp);
+        p->active = false;
+        newp->active = true;
+      }
+      t->active = false;
+    }
+    break;
+  default:
+    std::cerr << "Warning: Unknown event code " << e.code << " for tag " << t->motusID << std::endl;
+    return;
+  };
+  matches.clear();
+};
+
+int
+Lotek_Run_Finder::num_pulses(const SG_Record & r) {
+  auto x = expansions.find(Lotek_ID(r.v.codeSet, r.v.mfgID));
+  return x == expansions.end() ? 1 : x->second.size();
+};
+
+void
+Lotek_Run_Finder::process(const SG_Record & r, Nominal_Frequency_kHz nom_freq) {
+  auto x = expansions.find(Lotek_ID(r.v.codeSet, r.v.mfgID));
+  if (x == expansions.end())
+    return;
+  const std::vector < Gap > & gaps = x->second;
+  unsigned int n = gaps.size();
+
+  Burst b;
+  b.ts = r.ts;
+  b.dfreq = r.v.dfreq;
+  b.sig = r.v.sig;
+  b.noise = r.v.noise;
+  b.gaps = & gaps;
+  b.seq_no = ++num_bursts;
+  // the last pulse is where Lotek_Data_Source would put it
+  double ts = r.ts;
+  for (unsigned int i = 0; i + 1 < n; ++i)
+    ts += gaps[i];
+  b.last_ts = Lotek_Data_Source::round_sig(ts, 14);
+
+  const std::vector < Tag * > & s = matching(nom_freq, x->first);
+
+  std::vector < Cand_List > & cands = finders[Finder_Key(r.port, nom_freq)];
+  if (cands.empty())
+    cands.resize(Tag_Finder::NUM_CAND_LISTS);
+
+  // Each candidate which can accept the burst is followed through it
+  // as Tag_Finder::process would follow it pulse by pulse: levels[j]
+  // is its Tag_ID_Level after accepting the j'th pulse.  Offset
+  // frequencies of Lotek detections are all the same, so only signal
+  // strengths are checked.
+
+  struct Step {
+    Cand * c;                        // candidate accepting the burst; 0 for a new one
+    std::vector < Tag * > tags;
+    Tag * tag;
+    std::vector < Tag_Candidate::Tag_ID_Level > levels;
+  };
+  std::vector < Step > steps;
+
+  auto follow = [&](Step & st, const std::vector < Tag * > & first, Tag_Candidate::Tag_ID_Level level, unsigned int count) {
+    st.levels.push_back(level);
+    for (unsigned int j = 1; j <= n; ++j) {
+      ++count;
+      const std::vector < Tag * > & u = j == 1 ? first : st.tags;
+      if (level == Tag_Candidate::MULTIPLE && u.size() == 1) {
+        level = Tag_Candidate::SINGLE;
+        st.tag = u[0];
+      }
+      if (level == Tag_Candidate::SINGLE && count >= Tag_Candidate::pulses_to_confirm_id)
+        level = Tag_Candidate::CONFIRMED;
+      st.levels.push_back(level);
+    }
+  };
+
+  for (int i = 0; i < Tag_Finder::NUM_CAND_LISTS; ++i) {
+    Cand_List & cs = cands[i];
+    for (auto ci = cs.begin(); ci != cs.end() && b.ts >= ci->first; ) {
+      Cand * c = ci->second;
+      if (expired(c, b.ts)) {
+        ci = cs.erase(ci);
+        delete_cand(c);
+        continue;
+      }
+      ++ci;
+      if (! c->sig_range.is_compatible(b.sig))
+        continue;
+      // the gap from its last burst selects the tags the first pulse
+      // can be from; the gaps within the burst, those the rest can be
+      std::vector < Tag * > first;
+      for (auto t = c->tags.begin(); t != c->tags.end(); ++t)
+        if (follows(*t, b.ts - c->last_ts))
+          first.push_back(*t);
+      Step st = {c, std::vector < Tag * > (), c->tag, std::vector < Tag_Candidate::Tag_ID_Level > ()};
+      for (auto t = first.begin(); t != first.end(); ++t)
+        if (std::find(s.begin(), s.end(), *t) != s.end())
+          st.tags.push_back(*t);
+      if (st.tags.empty())
+        continue;
+      follow(st, first, c->tag_id_level, c->num_pulses);
+      steps.push_back(st);
+    }
+  }
+
+  // a new candidate begins at the burst, but its first pulse could be
+  // from any tag
+  if (! s.empty()) {
+    Step st = {0, s, BOGUS_TAG, std::vector < Tag_Candidate::Tag_ID_Level > ()};
+    follow(st, std::vector < Tag * > (), Tag_Candidate::MULTIPLE, 0);
+    steps.push_back(st);
+  }
+
+  // each pulse re-indexes candidates which accept it by level, after
+  // those at the same level which haven't yet; so they are visited by
+  // the next pulse in this order
+  for (unsigned int j = 1; j < n; ++j)
+    std::stable_sort(steps.begin(), steps.end(), [j](const Step & a, const Step & b) {return a.levels[j] < b.levels[j];});
+
+  // a candidate accepting the burst is cloned, and the clone (with the
+  // same key) remains in its place; here, the original is the clone
+  auto extend = [&](const Step & st) {
+    Cand * e;
+    if (st.c) {
+      e = new Cand(* st.c);
+      if (e->tag_id_level == Tag_Candidate::CONFIRMED && e->run_id > 0)
+        Tag_Foray::num_cands_with_run_id(e->run_id, 1);
+    } else {
+      e = new Cand();
+      e->sig_range = Bounded_Range < float > (Tag_Candidate::sig_slop_dB, b.sig);
+      e->num_pulses = 0;
+      e->last_dumped_ts = BOGUS_TIMESTAMP;
+      e->run_id = 0;
+      e->hit_count = 0;
+    }
+    e->tags = st.tags;
+    e->tag = st.tag;
+    e->tag_id_level = st.levels[n];
+    e->bursts.push_back(b);
+    e->num_pulses += n;
+    e->last_ts = b.last_ts;
+    // once the tag is known, bounds on signal strength are reset after
+    // each burst
+    if (e->tag_id_level == Tag_Candidate::MULTIPLE)
+      e->sig_range.extend_by(b.sig);
+    else
+      e->sig_range.clear_bounds();
+    return e;
+  };
+
+  auto owner = std::find_if(steps.begin(), steps.end(), [n](const Step & st) {return st.levels[n] == Tag_Candidate::CONFIRMED;});
+  if (owner == steps.end()) {
+    for (auto st = steps.begin(); st != steps.end(); ++st)
+      insert(cands, extend(*st));
+    return;
+  }
+
+  // the first candidate confirmed by the burst owns it, and all the
+  // bursts it has accepted; other candidates for the same tag or with
+  // any of those bursts are deleted, as by Tag_Finder::delete_competitors
+  Cand * e = extend(*owner);
+  for (auto cl = cands.begin(); cl != cands.end(); ++cl) {
+    for (auto ci = cl->begin(); ci != cl->end(); ) {
+      Cand * c = ci->second;
+      bool compete = c->tag != BOGUS_TAG && c->tag == e->tag;
+      for (auto cb = c->bursts.begin(); ! compete && cb != c->bursts.end(); ++cb)
+        for (auto eb = e->bursts.begin(); ! compete && eb != e->bursts.end(); ++eb)
+          compete = cb->seq_no == eb->seq_no;
+      if (compete) {
+        ci = cl->erase(ci);
+        delete_cand(c);
+      } else {
+        ++ci;
+      }
+    }
+  }
+  dump_bursts(r.port, e);
+  insert(cands, e);
+};
+
+void
+Lotek_Run_Finder::reap(Timestamp now) {
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi) {
+    for (auto cl = tfi->second.begin(); cl != tfi->second.end(); ++cl) {
+      for (auto ci = cl->begin(); ci != cl->end(); ) {
+        Cand * c = ci->second;
+        if (expired(c, now)) {
+          ci = cl->erase(ci);
+          delete_cand(c);
+        } else {
+          ++ci;
+        }
+      }
+    }
+  }
+};
+
+Gap
+Lotek_Run_Finder::last_gap_min(Tag * t) {
+  return Gap_Range(t->gaps.back(), pulse_slop, time_fuzz).first;
+};
+
+Gap
+Lotek_Run_Finder::last_gap_max(Tag * t) {
+  // skipped bursts lengthen the gap by whole periods, up to max_time
+  Gap g = t->gaps.back();
+  if (t->period > 0)
+    while (g + t->period < max_time)
+      g += t->period;
+  return Gap_Range(g, pulse_slop, time_fuzz).second;
+};
+
+bool
+Lotek_Run_Finder::follows(Tag * t, Gap g) {
+  // the gap from the last pulse of one burst to the first pulse of the
+  // next must match an edge Graph::addTag would have built
+  Gap h = t->gaps.back();
+  do {
+    Gap_Range gr(h, pulse_slop, time_fuzz);
+    if (g >= gr.first && g < gr.second)
+      return true;
+    h += t->period;
+  } while (t->period > 0 && h < max_time);
+  return false;
+};
+
+Tag *
+Lotek_Run_Finder::find(Tag * t, std::list < Tag * > & tags) {
+  // t's own gaps must lead, through the states of the graph, to a
+  // state unique to the other tag; the last gap is widened to its
+  // range, as in Graph::find
+  unsigned int n = t->gaps.size();
+  for (auto o = tags.begin(); o != tags.end(); ++o) {
+    if ((*o)->gaps.size() != n)
+      continue;
+    unsigned int i;
+    for (i = 0; i + 1 < n; ++i) {
+      Gap_Range gr((*o)->gaps[i], pulse_slop, time_fuzz);
+      if (t->gaps[i] < gr.first || t->gaps[i] >= gr.second)
+        break;
+    }
+    if (i + 1 < n)
+      continue;
+    Gap_Range gr(t->gaps[n - 1], pulse_slop, time_fuzz);
+    if (follows(*o, t->gaps[n - 1]) || follows(*o, gr.first) || follows(*o, gr.second))
+      return *o;
+  }
+  return 0;
+};
+
+const std::vector < Tag * > &
+Lotek_Run_Finder::matching(Nominal_Frequency_kHz nom_freq, Lotek_ID id) {
+  auto k = Match_Key(nom_freq, id);
+  auto m = matches.find(k);
+  if (m != matches.end())
+    return m->second;
+
+  std::vector < Tag * > & v = matches[k];
+  const std::vector < Gap > & gaps = expansions[id];
+  auto a = active.find(nom_freq);
+  if (a == active.end())
+    return v;
+  for (auto t = a->second.begin(); t != a->second.end(); ++t) {
+    if ((*t)->gaps.size() != gaps.size())
+      continue;
+    unsigned int i;
+    for (i = 0; i + 1 < gaps.size(); ++i) {
+      Gap_Range gr((*t)->gaps[i], pulse_slop, time_fuzz);
+      if (gaps[i] < gr.first || gaps[i] >= gr.second)
+        break;
+    }
+    if (i + 1 == gaps.size())
+      v.push_back(*t);
+  }
+  return v;
+};
+
+Timestamp
+Lotek_Run_Finder::min_next_pulse_ts(Cand * c) {
+  Gap g = last_gap_min(c->tags.front());
+  for (auto t = c->tags.begin(); t != c->tags.end(); ++t)
+    g = std::min(g, last_gap_min(*t));
+  return c->last_ts + g;
+};
+
+bool
+Lotek_Run_Finder::expired(Cand * c, Timestamp ts) {
+  Gap g = 0;
+  for (auto t = c->tags.begin(); t != c->tags.end(); ++t)
+    g = std::max(g, last_gap_max(*t));
+  return ts - c->last_ts > g;
+};
+
+void
+Lotek_Run_Finder::insert(std::vector < Cand_List > & cands, Cand * c) {
+  cands[c->tag_id_level].insert(std::make_pair(min_next_pulse_ts(c), c));
+};
+
+void
+Lotek_Run_Finder::delete_cand(Cand * c) {
+  maybe_end_run(c);
+  delete c;
+};
+
+void
+Lotek_Run_Finder::maybe_end_run(Cand * c) {
+  if (c->tag_id_level == Tag_Candidate::CONFIRMED && c->run_id > 0) {
+    if (Tag_Foray::num_cands_with_run_id(c->run_id, -1) == 0)
+      Tag_Candidate::filer->end_run(c->run_id, c->hit_count, c->last_dumped_ts, Tag_Candidate::ending_batch);
+  }
+  c->hit_count = 0;
+  c->run_id = 0;
+};
+
+void
+Lotek_Run_Finder::dump_bursts(Port_Num port, Cand * c) {
+  // regenerate the pulses Lotek_Data_Source would have, so that hits
+  // have the same burst parameters
+  pulses.clear();
+  for (auto b = c->bursts.begin(); b != c->bursts.end(); ++b) {
+    double ts = b->ts;
+    for (auto g = b->gaps->begin(); g != b->gaps->end(); ++g) {
+      Pulse p;
+      p.ts = Lotek_Data_Source::round_sig(ts, 14);
+      p.dfreq = b->dfreq;
+      p.sig = b->sig;
+      p.noise = b->noise;
+      pulses.push_back(p);
+      ts += *g;
+    }
+  }
+
+  Tag * t = c->tag;
+  auto p = pulses.begin();
+  while (p != pulses.end()) {
+    Timestamp ts = p->ts;
+    if (++c->hit_count == 1) {
+      // first hit, so start a run
+      c->run_id = Tag_Candidate::filer->begin_run(t->motusID, port, ts);
+      Tag_Foray::num_cands_with_run_id(c->run_id, 1);
+    }
+    Tag_Candidate::calculate_burst_params(p, t, t->gaps.size(), c->last_dumped_ts, c->hit_count); // advances p
+    Burst_Params & bp = Tag_Candidate::burst_par;
+    Tag_Candidate::filer->add_hit(c->run_id, ts, bp.sig, bp.sig_sd, bp.noise, bp.freq, bp.freq_sd, bp.slop, bp.burst_slop);
+    ++ t->count;
+  }
+  c->bursts.clear();
+  c->num_pulses = 0;
+};
+
+void
+Lotek_Run_Finder::rename(Nominal_Frequency_kHz nom_freq, Tag * t1, Tag * t2) {
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi) {
+    if (tfi->first.second != nom_freq)
+      continue;
+    for (auto cl = tfi->second.begin(); cl != tfi->second.end(); ++cl) {
+      for (auto ci = cl->begin(); ci != cl->end(); ++ci) {
+        Cand * c = ci->second;
+        auto i = std::find(c->tags.begin(), c->tags.end(), t1);
+        if (i != c->tags.end()) {
+          if (std::find(c->tags.begin(), c->tags.end(), t2) == c->tags.end())
+            *i = t2;
+          else
+            c->tags.erase(i);
+        }
+        if (c->tag == t1) {
+          // end the current run for t1; subsequent hits are reported as t2
+          maybe_end_run(c);
+          c->tag = t2;
+        }
+      }
+    }
+  }
+};
+
+void
+Lotek_Run_Finder::drop(Nominal_Frequency_kHz nom_freq, Tag * t) {
+  // candidates which can no longer be from any active tag are deleted;
+  // those left with only one become SINGLE, as in Tag_Finder::tag_removed
+  for (auto tfi = finders.begin(); tfi != finders.end(); ++tfi) {
+    if (tfi->first.second != nom_freq)
+      continue;
+    std::vector < Cand_List > & cands = tfi->second;
+    for (auto cl = cands.begin(); cl != cands.end(); ++cl) {
+      for (auto ci = cl->begin(); ci != cl->end(); ) {
+        Cand * c = ci->second;
+        auto i = std::find(c->tags.begin(), c->tags.end(), t);
+        if (i == c->tags.end()) {
+          ++ci;
+          continue;
+        }
+        c->tags.erase(i);
+        if (c->tags.empty() || c->tag == t) {
+          ci = cl->erase(ci);
+          delete_cand(c);
+        } else if (c->tag_id_level == Tag_Candidate::MULTIPLE && c->tags.size() == 1) {
+          ci = cl->erase(ci);
+          c->tag_id_level = Tag_Candidate::SINGLE;
+          c->tag = c->tags.front();
+          insert(cands, c);
+        } else {
+          ++ci;
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,148 @@
+#ifndef LOTEK_RUN_FINDER_HPP
+#define LOTEK_RUN_FINDER_HPP
+
+#include "find_tags_common.hpp"
+
+#include "Tag.hpp"
+#include "Tag_Database.hpp"
+#include "Event.hpp"
+#include "SG_Record.hpp"
+#include "DB_Filer.hpp"
+#include "Pulse.hpp"
+#include "Bounded_Range.hpp"
+#include "Tag_Candidate.hpp"
+
+#include <map>
+#include <list>
+#include <vector>
+
+/*
+  Lotek_Run_Finder - assemble runs directly from detections decoded
+  by a Lotek receiver.
+
+  A Lotek receiver has already decoded each burst into a (codeset, ID)
+  pair.  Lotek_Data_Source would expand each detection into the
+  pulses of its burst, for Tag_Finder to walk through the DFA graph of
+  every active tag.  Instead, this finds the same runs and hits by
+  following those pulses a burst at a time:
+
+  - a detection can only be from the active tags whose in-burst gaps
+    match those of its pulses, and a burst can only follow another
+    from one of these tags if the gap between them matches an edge
+    Graph::addTag would have built;
+
+  - candidates are kept, cloned, confirmed, and deleted as
+    Tag_Finder::process does with Tag_Candidates, and in the same
+    order, so that the same candidate owns each burst.  In particular,
+    until a candidate's tag is known, the range of signal strengths it
+    accepts spans all its bursts; and once confirmed, it reports all
+    the bursts it has accepted, with the same burst parameters;
+
+  - tags which the graph can't tell apart are merged into an
+    Ambiguity, as Graph::addTag does.
+
+  Detections on the same antenna whose bursts overlap in time are
+  followed one after the other, although their pulses would have been
+  interleaved, so runs and hits can differ from Tag_Finder's there.
+  Clock jumps allowed by --timestamp_wonkiness aren't followed, since
+  the graph's edges for them never lead to a complete burst, so
+  find_tags_motus refuses that option with --lotek_direct.  When a tag
+  is activated, candidates keep the tags they were compatible with
+  rather than being re-examined as by Tag_Finder::tag_added, so the
+  new tag is only considered for later detections; a deactivated tag
+  is dropped from candidates, as by Tag_Finder::tag_removed.
+*/
+
+class Lotek_Run_Finder {
+
+public:
+
+  Lotek_Run_Finder(Tag_Database * tags, Gap pulse_slop, float time_fuzz, Gap max_time);
+
+  ~Lotek_Run_Finder(); //!< report remaining bursts of confirmed candidates and delete all candidates, as ~Tag_Finder does
+
+  void process_event(Event e); //!< activate or deactivate a tag
+
+  int num_pulses(const SG_Record & r); //!< number of pulses a DETECTION record stands for
+
+  void process(const SG_Record & r, Nominal_Frequency_kHz nom_freq); //!< process a DETECTION record from an antenna listening at nom_freq
+
+  void reap(Timestamp now); //!< delete candidates which have expired by time now, ending their runs
+
+protected:
+
+  Gap pulse_slop;                    //!< tolerance for gaps, as for Graph::addTag
+  float time_fuzz;                   //!< fractional tolerance for gaps, as for Graph::addTag
+  Gap max_time;                      //!< gaps between bursts must be shorter than this
+
+  typedef std::pair < short, short > Lotek_ID; //!< (codeset, ID)
+
+  std::map < Lotek_ID, std::vector < Gap > > expansions; //!< gaps between the pulses Lotek_Data_Source generates for each detection
+
+  std::map < Nominal_Frequency_kHz, std::list < Tag * > > active; //!< tags (or Ambiguity proxies) in the graph for each nominal frequency
+
+  typedef std::pair < Nominal_Frequency_kHz, Lotek_ID > Match_Key;
+
+  std::map < Match_Key, std::vector < Tag * > > matches; //!< active tags whose in-burst gaps match a detection's; cleared by events
+
+  struct Burst {
+    Timestamp ts;                    //!< timestamp of first pulse
+    Timestamp last_ts;               //!< timestamp of last pulse
+    Frequency_Offset_kHz dfreq;
+    SignaldB sig;
+    SignaldB noise;
+    const std::vector < Gap > * gaps; //!< gaps between its pulses
+    long long seq_no;                //!< identifies the burst's pulses, for Tag_Candidate::shares_any_pulses
+  };
+
+  struct Cand {
+    std::vector < Tag * > tags;      //!< tags compatible with the bursts accepted so far; the tag set of a Tag_Candidate's state
+    Tag * tag;                       //!< the only compatible tag, unless tag_id_level is MULTIPLE
+    Tag_Candidate::Tag_ID_Level tag_id_level;
+    std::vector < Burst > bursts;    //!< bursts accepted, but not yet reported
+    unsigned int num_pulses;         //!< pulses in those bursts
+    Bounded_Range < float > sig_range;
+    Timestamp last_ts;               //!< timestamp of last pulse accepted
+    Timestamp last_dumped_ts;        //!< timestamp of last pulse of last burst reported
+    DB_Filer::Run_ID run_id;
+    unsigned int hit_count;
+  };
+
+  typedef std::multimap < Timestamp, Cand * > Cand_List; //!< candidates by minimum timestamp of their next pulse, as in Tag_Finder
+
+  typedef std::pair < Port_Num, Nominal_Frequency_kHz > Finder_Key;
+
+  std::map < Finder_Key, std::vector < Cand_List > > finders; //!< lists of candidates by Tag_ID_Level, for each Tag_Finder that would exist
+
+  long long num_bursts;              //!< bursts processed so far
+
+  Pulse_Buffer pulses;               //!< pulses of a burst being reported
+
+  Gap last_gap_min(Tag * t); //!< smallest gap from the end of one burst of t to the next
+
+  Gap last_gap_max(Tag * t); //!< largest gap from the end of one burst of t to the next
+
+  bool follows(Tag * t, Gap g); //!< can a burst from t begin g after the end of the last one?
+
+  Tag * find(Tag * t, std::list < Tag * > & tags); //!< the tag in tags which t can't be told apart from, as Graph::find; 0 if none
+
+  const std::vector < Tag * > & matching(Nominal_Frequency_kHz nom_freq, Lotek_ID id); //!< active tags which could have sent a detection of id
+
+  Timestamp min_next_pulse_ts(Cand * c); //!< as Tag_Candidate::min_next_pulse_ts
+
+  bool expired(Cand * c, Timestamp ts); //!< as Tag_Candidate::expired
+
+  void insert(std::vector < Cand_List > & cands, Cand * c); //!< index c in the list for its Tag_ID_Level
+
+  void delete_cand(Cand * c); //!< delete c, ending its run if no other candidate has it, as ~Tag_Candidate does
+
+  void maybe_end_run(Cand * c); //!< as Tag_Candidate::maybe_end_run
+
+  void dump_bursts(Port_Num port, Cand * c); //!< report all bursts of c, as Tag_Candidate::dump_bursts
+
+  void rename(Nominal_Frequency_kHz nom_freq, Tag * t1, Tag * t2); //!< t1 is now t2, as for Tag_Finder::rename_tag and Graph::renTag
+
+  void drop(Nominal_Frequency_kHz nom_freq, Tag * t); //!< delete candidates compatible with t, which is no longer active
+};
+
+#endif // LOTEK_RUN_FINDER_HPP
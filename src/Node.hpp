@@ -13,6 +13,7 @@ class Node {
   friend class Graph;
   friend class Tag_Finder;
   friend class Tag_Foray;
+  friend class Candidate_Archive;
 
   typedef std::map < Gap, Node * > Edges;
 
@@ -66,16 +67,6 @@ public:
   void tcLink(); //!< indicate a Tag Candidate is pointing to this state
   bool tcUnlink(); //!< indicate a Tag Candidate no longer points to this state; returns true iff this call deletes the state
 
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version) {
-    ar & BOOST_SERIALIZATION_NVP( s );
-    ar & BOOST_SERIALIZATION_NVP( e );
-    ar & BOOST_SERIALIZATION_NVP( useCount );
-    ar & BOOST_SERIALIZATION_NVP( tcUseCount );
-    ar & BOOST_SERIALIZATION_NVP( _valid );
-    ar & BOOST_SERIALIZATION_NVP( label );
-  };
-
 };
 
 #endif // NODE_HPP
@@ -0,0 +1,42 @@
+#include "Output_Sink.hpp"
+#include "CSV_Sink.hpp"
+#include "Columnar_Sink.hpp"
+#include "Binary_Sink.hpp"
+
+Output_Sink::Output_Sink() :
+  open_runs()
+{
+};
+
+Output_Sink::~Output_Sink() {
+};
+
+void
+Output_Sink::begin_run(DB_Filer::Run_ID rid, DB_Filer::Batch_ID bid, Motus_Tag_ID mid, int ant, Timestamp ts) {
+  Run_Begin rb = {bid, mid, ant, ts};
+  open_runs[rid] = rb;
+};
+
+void
+Output_Sink::end_run(DB_Filer::Run_ID rid, int n, Timestamp ts, bool countOnly) {
+  auto r = open_runs.find(rid);
+  if (r == open_runs.end())
+    throw std::runtime_error("Output sink asked to end a run it didn't begin");
+  add_run(rid, r->second, n, ts, countOnly ? 0 : 1);
+  open_runs.erase(r);
+};
+
+Output_Sink *
+Output_Sink::make_CSV_sink(std::string prefix) {
+  return new CSV_Sink(prefix);
+};
+
+Output_Sink *
+Output_Sink::make_columnar_sink(std::string path) {
+  return new Columnar_Sink(path);
+};
+
+Output_Sink *
+Output_Sink::make_binary_sink(std::string path) {
+  return new Binary_Sink(path);
+};
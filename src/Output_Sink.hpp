@@ -0,0 +1,62 @@
+#ifndef OUTPUT_SINK_HPP
+#define OUTPUT_SINK_HPP
+
+//!< Destination for detections and the other output generated while
+//!< processing a batch.  DB_Filer sends all of it to a sink: an
+//!< SQLite_Sink for the receiver database, unless set_sink() gives it
+//!< another.  DB_Filer still records batches, parameters, ambiguities
+//!< and saved state in the database, and assigns run IDs; see
+//!< DB_Filer::set_sink().
+
+#include "find_tags_common.hpp"
+#include "DB_Filer.hpp"
+#include "Pulse.hpp"
+
+#include <map>
+
+class Output_Sink {
+
+public:
+  Output_Sink();
+  virtual ~Output_Sink();
+
+  virtual void begin_run(DB_Filer::Run_ID rid, DB_Filer::Batch_ID bid, Motus_Tag_ID mid, int ant, Timestamp ts); //!< note the start of a run; it is written by end_run()
+
+  virtual void end_run(DB_Filer::Run_ID rid, int n, Timestamp ts, bool countOnly); //!< write a run begun by begin_run(); if countOnly, the run is not finished, but the batch is
+
+  virtual void add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) = 0;
+
+  virtual void add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt) = 0;
+
+  virtual void add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count) = 0;
+
+  virtual void add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra) = 0;
+
+  virtual void add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p) = 0;
+
+  virtual void close() = 0; //!< write anything buffered, and close the sink's files; called before the sink is destroyed
+
+  static Output_Sink * make_CSV_sink(std::string prefix);
+
+  static Output_Sink * make_columnar_sink(std::string path);
+
+  static Output_Sink * make_binary_sink(std::string path);
+
+protected:
+
+  struct Run_Begin {
+    DB_Filer::Batch_ID bid;
+    Motus_Tag_ID mid;
+    int ant;
+    Timestamp ts;
+  };
+
+  std::map < DB_Filer::Run_ID, Run_Begin > open_runs; //!< runs begun but not yet written
+
+  //!< write a whole run; as in the `runs` table, done is 1 if the
+  //!< run is finished, 0 if it might continue in a later batch
+  virtual void add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done) = 0;
+
+};
+
+#endif // OUTPUT_SINK_HPP
@@ -0,0 +1,126 @@
+#include "Pulse_Archive_Data_Source.hpp"
+#include "Pulse_Archive_Writer.hpp"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const size_t HEADER_SIZE = sizeof(Pulse_Archive_Writer::MAGIC) + 2 * sizeof(uint32_t);
+
+Pulse_Archive_Data_Source::Pulse_Archive_Data_Source(std::string path) :
+  data(0),
+  size(0),
+  path(path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Unable to open pulse archive " + path);
+  struct stat st;
+  if (fstat(fd, & st) < 0 || (size_t) st.st_size < HEADER_SIZE) {
+    close(fd);
+    throw std::runtime_error("Not a pulse archive: " + path);
+  }
+  size = st.st_size;
+  void * p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    throw std::runtime_error("Unable to map pulse archive " + path);
+  madvise(p, size, MADV_SEQUENTIAL);
+  data = reinterpret_cast < const char * > (p);
+
+  uint32_t version;
+  memcpy(& version, data + sizeof(Pulse_Archive_Writer::MAGIC), sizeof(version));
+  if (memcmp(data, Pulse_Archive_Writer::MAGIC, sizeof(Pulse_Archive_Writer::MAGIC)) || version != Pulse_Archive_Writer::VERSION) {
+    munmap(p, size);
+    throw std::runtime_error("Not a pulse archive, or one from an incompatible version: " + path);
+  }
+  rewind();
+};
+
+Pulse_Archive_Data_Source::~Pulse_Archive_Data_Source() {
+  if (data)
+    munmap(const_cast < char * > (data), size);
+};
+
+bool
+Pulse_Archive_Data_Source::next_line(const char ** line, int * len) {
+  return false;
+};
+
+bool
+Pulse_Archive_Data_Source::is_archive(std::string path) {
+  char magic[sizeof(Pulse_Archive_Writer::MAGIC)];
+  FILE * f = fopen(path.c_str(), "rb");
+  if (! f)
+    return false;
+  bool rv = fread(magic, sizeof(magic), 1, f) == 1 && ! memcmp(magic, Pulse_Archive_Writer::MAGIC, sizeof(magic));
+  fclose(f);
+  return rv;
+};
+
+void
+Pulse_Archive_Data_Source::rewind() {
+  block = data + HEADER_SIZE;
+  nPulses = nOthers = iPulse = iOther = 0;
+  nextBefore = 0;
+};
+
+bool
+Pulse_Archive_Data_Source::next_block() {
+  uint32_t hdr[4];
+  if (block + sizeof(hdr) > data + size)
+    return false;
+  memcpy(hdr, block, sizeof(hdr));
+  nPulses = hdr[0];
+  nOthers = hdr[1];
+  ts = block + sizeof(hdr);
+  dfreq = ts + hdr[2];
+  sig = dfreq + nPulses * sizeof(float);
+  noise = sig + nPulses * sizeof(float);
+  port = reinterpret_cast < const int8_t * > (noise + nPulses * sizeof(float));
+  other = reinterpret_cast < const char * > (port + nPulses);
+  block = other + hdr[3];
+  if (block > data + size)
+    throw std::runtime_error("Truncated pulse archive " + path);
+  iPulse = iOther = 0;
+  ticks = 0;
+  if (nOthers)
+    memcpy(& nextBefore, other, sizeof(nextBefore));
+  return true;
+};
+
+bool
+Pulse_Archive_Data_Source::next_record(SG_Record & r) {
+  while (iPulse == nPulses && iOther == nOthers) {
+    if (! next_block())
+      return false;
+  }
+  if (iOther < nOthers && nextBefore == iPulse) {
+    other += sizeof(nextBefore);
+    other += r.unpack(other);
+    if (++iOther < nOthers)
+      memcpy(& nextBefore, other, sizeof(nextBefore));
+    return true;
+  }
+  // a zigzag varint
+  unsigned long long zz = 0;
+  int shift = 0;
+  for (;;) {
+    unsigned char c = * ts++;
+    zz |= (unsigned long long) (c & 0x7f) << shift;
+    if (! (c & 0x80))
+      break;
+    shift += 7;
+  }
+  ticks += (long long) (zz >> 1) ^ - (long long) (zz & 1);
+  r.type = SG_Record::PULSE;
+  r.ts = ticks / Pulse_Archive_Writer::TICKS_PER_SECOND;
+  r.port = port[iPulse];
+  memcpy(& r.v.dfreq, dfreq + iPulse * sizeof(float), sizeof(float));
+  memcpy(& r.v.sig, sig + iPulse * sizeof(float), sizeof(float));
+  memcpy(& r.v.noise, noise + iPulse * sizeof(float), sizeof(float));
+  ++ iPulse;
+  return true;
+};
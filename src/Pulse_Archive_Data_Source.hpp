@@ -0,0 +1,49 @@
+#ifndef PULSE_ARCHIVE_DATA_SOURCE_HPP
+#define PULSE_ARCHIVE_DATA_SOURCE_HPP
+
+//!< Source for SG records from a pulse archive written by
+//!< Pulse_Archive_Writer.  The archive is memory-mapped, and records
+//!< are decoded from its columns, without parsing any text.  They
+//!< still pass through Clock_Repair, as the archive holds records as
+//!< they were in the raw files.
+
+#include "find_tags_common.hpp"
+#include "Data_Source.hpp"
+#include "SG_Record.hpp"
+
+class Pulse_Archive_Data_Source : public Data_Source {
+
+public:
+  Pulse_Archive_Data_Source(std::string path);
+  ~Pulse_Archive_Data_Source();
+  bool next_line(const char ** line, int * len); //!< always false: an archive holds records, not lines
+  bool has_records() { return true; };
+  bool next_record(SG_Record & r);
+  void rewind();
+
+  static bool is_archive(std::string path); //!< does the file begin like a pulse archive?
+
+protected:
+  const char * data;   //!< start of the mapped archive
+  size_t size;         //!< size of the archive
+  const char * block;  //!< start of the next block to read
+  std::string path;
+
+  // the block being read
+  uint32_t nPulses;
+  uint32_t nOthers;
+  uint32_t iPulse;     //!< index of next pulse
+  uint32_t iOther;     //!< index of next other record
+  uint32_t nextBefore; //!< index of the pulse which the next other record precedes
+  long long ticks;     //!< timestamp of the previous pulse, in ticks
+  const char * ts;     //!< next byte of the ts column
+  const char * dfreq;  //!< dfreq, sig, and noise columns, which needn't be aligned
+  const char * sig;
+  const char * noise;
+  const int8_t * port;
+  const char * other;  //!< next other record
+
+  bool next_block();   //!< start reading the next block; false if there are none
+};
+
+#endif // PULSE_ARCHIVE_DATA_SOURCE
@@ -0,0 +1,115 @@
+#include "Pulse_Archive_Writer.hpp"
+
+#include <string.h>
+#include <math.h>
+
+Pulse_Archive_Writer::Pulse_Archive_Writer(std::string path) :
+  f(fopen(path.c_str(), "wb")),
+  path(path),
+  prevTicks(0),
+  nOthers(0)
+{
+  if (! f)
+    throw std::runtime_error("Unable to create pulse archive " + path);
+  uint32_t hdr[2] = {VERSION, 0};
+  fwrite(MAGIC, sizeof(MAGIC), 1, f);
+  fwrite(hdr, sizeof(hdr), 1, f);
+};
+
+Pulse_Archive_Writer::~Pulse_Archive_Writer() {
+  // an archive not close()d is left incomplete
+  if (f)
+    fclose(f);
+};
+
+void
+Pulse_Archive_Writer::put(const SG_Record & r) {
+  if (r.type == SG_Record::PULSE && r.port >= INT8_MIN && r.port <= INT8_MAX) {
+    long long ticks = llround(r.ts * TICKS_PER_SECOND);
+    // only whole numbers of ticks are stored exactly; dividing is
+    // correctly rounded, so this gives the same double as parsing
+    // the timestamp's text
+    if (ticks / TICKS_PER_SECOND == r.ts) {
+      unsigned long long zz = (unsigned long long) (ticks - prevTicks) << 1 ^ (unsigned long long) ((ticks - prevTicks) >> 63);
+      while (zz >= 0x80) {
+        ts.push_back((char) (zz | 0x80));
+        zz >>= 7;
+      }
+      ts.push_back((char) zz);
+      prevTicks = ticks;
+      dfreq.push_back(r.v.dfreq);
+      sig.push_back(r.v.sig);
+      noise.push_back(r.v.noise);
+      port.push_back(r.port);
+      if (port.size() == BLOCK_PULSES)
+        write_block();
+      return;
+    }
+  }
+  uint32_t before = port.size();
+  char buf[sizeof(before) + SG_Record::MAX_PACKED];
+  memcpy(buf, & before, sizeof(before));
+  others.append(buf, sizeof(before) + r.pack(buf + sizeof(before)));
+  ++ nOthers;
+  if (others.size() >= BLOCK_PULSES * 16)
+    write_block();
+};
+
+unsigned long long
+Pulse_Archive_Writer::put_all(Data_Source * src) {
+  unsigned long long n = 0;
+  SG_Record r;
+  if (src->has_records()) {
+    while (src->next_record(r)) {
+      put(r);
+      ++ n;
+    }
+    return n;
+  }
+  const char * line;
+  int len;
+  while (src->next_line(& line, & len)) {
+    r.from_chars(line, line + std::min(len, (int) MAX_LINE_SIZE));
+    if (r.type == SG_Record::BAD)
+      continue;
+    put(r);
+    ++ n;
+  }
+  return n;
+};
+
+void
+Pulse_Archive_Writer::write_block() {
+  uint32_t hdr[4] = {(uint32_t) port.size(), nOthers, (uint32_t) ts.size(), (uint32_t) others.size()};
+  size_t n = port.size();
+  if (n || nOthers) {
+    fwrite(hdr, sizeof(hdr), 1, f);
+    fwrite(ts.data(), ts.size(), 1, f);
+    fwrite(dfreq.data(), sizeof(float), n, f);
+    fwrite(sig.data(), sizeof(float), n, f);
+    fwrite(noise.data(), sizeof(float), n, f);
+    fwrite(port.data(), sizeof(int8_t), n, f);
+    fwrite(others.data(), others.size(), 1, f);
+  }
+  if (ferror(f))
+    throw std::runtime_error("Unable to write pulse archive " + path);
+  ts.clear();
+  prevTicks = 0;
+  dfreq.clear();
+  sig.clear();
+  noise.clear();
+  port.clear();
+  others.clear();
+  nOthers = 0;
+};
+
+void
+Pulse_Archive_Writer::close() {
+  write_block();
+  if (fclose(f))
+    throw std::runtime_error("Unable to write pulse archive " + path);
+  f = 0;
+};
+
+const char
+Pulse_Archive_Writer::MAGIC[8] = {'S', 'G', 'P', 'U', 'L', 'S', 'E', 'S'};
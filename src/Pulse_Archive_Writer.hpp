@@ -0,0 +1,70 @@
+#ifndef PULSE_ARCHIVE_WRITER_HPP
+#define PULSE_ARCHIVE_WRITER_HPP
+
+//!< Pulse_Archive_Writer - write SG records to a pulse archive.
+//
+// A pulse archive holds the parsed records from a receiver's raw
+// files, before clock repair, so that they can be processed again
+// (e.g. with different tag finding parameters) without decompressing
+// and parsing text; see Pulse_Archive_Data_Source.
+//
+// ## Format (version 1; all values in native byte order)
+//
+//   header:  char[8] MAGIC, uint32 VERSION, uint32 0
+//
+//   then blocks, each holding up to BLOCK_PULSES pulse records:
+//
+//     uint32 nPulses, uint32 nOthers, uint32 tsBytes, uint32 othersBytes
+//     ts:     tsBytes bytes; for each pulse, the difference between its
+//             timestamp in ticks of 0.1 ms and that of the previous
+//             pulse (or 0, for the first in the block), as a zigzag varint
+//     dfreq:  float[nPulses]
+//     sig:    float[nPulses]
+//     noise:  float[nPulses]
+//     port:   int8[nPulses]
+//     others: othersBytes bytes; for each record other than these pulses,
+//             in order, uint32 index of the pulse it precedes (nPulses
+//             if none), then the record as written by SG_Record::pack()
+//
+// Records which aren't pulses (GPS fixes, parameter settings, file
+// timestamps, etc.) are rare, and so are kept aside as "others".  So
+// are the few pulses whose timestamp isn't a whole number of ticks, or
+// whose port doesn't fit in the port column.
+
+#include "find_tags_common.hpp"
+#include "SG_Record.hpp"
+#include "Data_Source.hpp"
+
+#include <stdio.h>
+
+class Pulse_Archive_Writer {
+
+public:
+  Pulse_Archive_Writer(std::string path); //!< create an archive, replacing any existing file
+  ~Pulse_Archive_Writer();
+
+  void put(const SG_Record & r); //!< add a record
+
+  unsigned long long put_all(Data_Source * src); //!< add all remaining records from a data source, skipping malformed lines; returns the number added
+
+  void close(); //!< write any buffered records and close the archive; until this is called, the archive is incomplete
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const uint32_t BLOCK_PULSES = 65536;
+  static constexpr double TICKS_PER_SECOND = 1e4;
+
+protected:
+  FILE * f;
+  std::string path;
+  std::string ts;      //!< ts column of the block being built
+  long long prevTicks; //!< timestamp of the previous pulse in the block, in ticks
+  std::vector < float > dfreq, sig, noise;
+  std::vector < int8_t > port;
+  std::string others;  //!< others column of the block being built
+  uint32_t nOthers;
+
+  void write_block();  //!< write the block being built, and start another
+};
+
+#endif // PULSE_ARCHIVE_WRITER_HPP
@@ -0,0 +1,91 @@
+#include "Pulses_SQLite_Data_Source.hpp"
+
+#include <string.h>
+
+Pulses_SQLite_Data_Source::Pulses_SQLite_Data_Source(DB_Filer * db, int monoBN) :
+  db(db),
+  monoBN(monoBN),
+  pending(false),
+  antFreq(),
+  lastTS(0),
+  lastRowid(0),
+  originTS(0),
+  originRowid(0)
+{
+  db->start_pulses_reader(monoBN);
+};
+
+Pulses_SQLite_Data_Source::~Pulses_SQLite_Data_Source() {
+  db->end_pulses_reader();
+};
+
+bool
+Pulses_SQLite_Data_Source::next_line(const char ** line, int * len) {
+  return false;
+};
+
+bool
+Pulses_SQLite_Data_Source::next_record(SG_Record & r) {
+  if (! pending) {
+    if (! db->get_pulses_record(pr))
+      return false;
+    pending = true;
+    auto f = antFreq.find(pr.ant);
+    if (f == antFreq.end() || f->second != pr.antFreq) {
+      // the port's frequency has changed, so say so first, as the
+      // receiver would have
+      antFreq[pr.ant] = pr.antFreq;
+      r.type = SG_Record::PARAM;
+      r.ts = pr.ts;
+      r.port = pr.ant;
+      strcpy(r.v.param_flag, "-m");
+      r.v.param_value = pr.antFreq;
+      r.v.return_code = 0;
+      r.v.error[0] = '\0';
+      return true;
+    }
+  }
+  pending = false;
+  r.type = SG_Record::PULSE;
+  r.ts = pr.ts;
+  r.port = pr.ant;
+  r.v.dfreq = pr.dfreq;
+  r.v.sig = pr.sig;
+  r.v.noise = pr.noise;
+  lastTS = pr.ts;
+  lastRowid = pr.rowid;
+  return true;
+};
+
+void
+Pulses_SQLite_Data_Source::rewind() {
+  db->start_pulses_reader(monoBN, originTS, originRowid);
+  pending = false;
+  antFreq.clear();
+};
+
+// ugly macro because I couldn't figure out how to make this work
+// properly with templates.
+
+#define SERIALIZE_FUN_BODY                      \
+   ar & BOOST_SERIALIZATION_NVP( lastTS );      \
+   ar & BOOST_SERIALIZATION_NVP( lastRowid );   \
+   ar & BOOST_SERIALIZATION_NVP( antFreq );
+
+void
+Pulses_SQLite_Data_Source::serialize(boost::archive::binary_iarchive & ar, const unsigned int version) {
+
+  SERIALIZE_FUN_BODY;
+
+  // continue after the last pulse returned before the pause
+  originTS    = lastTS;
+  originRowid = lastRowid;
+  db->start_pulses_reader(monoBN, lastTS, lastRowid);
+};
+
+void
+Pulses_SQLite_Data_Source::serialize(boost::archive::binary_oarchive & ar, const unsigned int version) {
+
+  SERIALIZE_FUN_BODY;
+
+};
@@ -0,0 +1,43 @@
+#ifndef PULSES_SQLITE_DATA_SOURCE_HPP
+#define PULSES_SQLITE_DATA_SOURCE_HPP
+
+//!< Source for pulses recorded in the `pulses` table of a motus-format
+//!< .sqlite database by an earlier run with --pulses_only.  These have
+//!< already been clock-repaired and screened by offset frequency, so
+//!< tag finding can be re-run on them (e.g. with different parameters)
+//!< without reading raw files.  A frequency setting record is generated
+//!< whenever a pulse's antenna frequency differs from the previous one
+//!< on its port.
+
+#include "find_tags_common.hpp"
+#include "Data_Source.hpp"
+#include "DB_Filer.hpp"
+#include "SG_Record.hpp"
+#include <boost/serialization/map.hpp>
+
+class Pulses_SQLite_Data_Source : public Data_Source {
+
+public:
+  Pulses_SQLite_Data_Source(DB_Filer * db, int monoBN);
+  ~Pulses_SQLite_Data_Source();
+  bool next_line(const char ** line, int * len); //!< always false: pulses come as records
+  bool has_records() { return true; };
+  bool next_record(SG_Record & r);
+  void rewind();
+
+protected:
+  DB_Filer * db;
+  int monoBN;                                   //!< boot session whose pulses are read
+  DB_Filer::Pulse_Record pr;                    //!< pulse read from the database
+  bool pending;                                 //!< true if pr has yet to be returned, after the frequency setting generated for it
+  std::map < Port_Num, Frequency_MHz > antFreq; //!< most recent antenna frequency on each port, in MHz
+  Timestamp lastTS;                             //!< timestamp of last pulse returned
+  long long lastRowid;                          //!< rowid of last pulse returned; pulses are read after this one on resume
+  Timestamp originTS;                           //!< timestamp of pulse after which to restart on rewind()
+  long long originRowid;                        //!< rowid of pulse after which to restart on rewind()
+
+  void serialize(boost::archive::binary_iarchive & ar, const unsigned int version);
+  void serialize(boost::archive::binary_oarchive & ar, const unsigned int version);
+};
+
+#endif // PULSES_SQLITE_DATA_SOURCE
@@ -0,0 +1,66 @@
+#include "Record_Pipe.hpp"
+
+Record_Pipe::Record_Pipe(int fd, bool writing) :
+  f(fdopen(fd, writing ? "w" : "r"))
+{
+  if (! f)
+    throw std::runtime_error("Unable to open record pipe");
+};
+
+Record_Pipe::~Record_Pipe() {
+  close();
+};
+
+void
+Record_Pipe::close() {
+  if (f)
+    fclose(f);
+  f = 0;
+};
+
+bool
+Record_Pipe::getline(char * buf, int maxLen) {
+  return false;
+};
+
+bool
+Record_Pipe::put(const SG_Record & r) {
+  char buf[SG_Record::MAX_PACKED];
+  fwrite(buf, r.pack(buf), 1, f);
+  return ! ferror(f);
+};
+
+bool
+Record_Pipe::put_time_fix(Timestamp tsLow, Timestamp tsHigh, Timestamp by, Timestamp error, char fixType) {
+  Timestamp fix[4] = {tsLow, tsHigh, by, error};
+  putc(TIME_FIX, f);
+  fwrite(fix, sizeof(fix), 1, f);
+  putc(fixType, f);
+  return ! ferror(f);
+};
+
+bool
+Record_Pipe::get(SG_Record & r, DB_Filer * filer) {
+  for (;;) {
+    int c = getc(f);
+    if (c == EOF)
+      return false;
+    if (c == TIME_FIX) {
+      Timestamp fix[4];
+      if (fread(fix, sizeof(fix), 1, f) != 1)
+        break;
+      int fixType = getc(f);
+      if (fixType == EOF)
+        break;
+      filer->add_time_fix(fix[0], fix[1], fix[2], fix[3], fixType);
+      continue;
+    }
+    char buf[SG_Record::MAX_PACKED];
+    buf[0] = c;
+    if (fread(buf + 1, SG_Record::packed_size((SG_Record::Type) c) - 1, 1, f) != 1)
+      break;
+    r.unpack(buf);
+    return true;
+  }
+  throw std::runtime_error("Truncated record from record pipe");
+};
@@ -0,0 +1,44 @@
+#ifndef RECORD_PIPE_HPP
+#define RECORD_PIPE_HPP
+
+//!< Record_Pipe - a pipe carrying clock-repaired SG records between processes.
+//
+// In a parameter sweep, one process reads and clock-repairs the input
+// and writes every record it processes to a Record_Pipe for each
+// configuration being swept.  Each configuration runs in its own
+// process, whose Tag_Foray uses the reading end of a Record_Pipe as
+// its Data_Source; Clock_Repair passes records from it through
+// unchanged, since they have already been repaired.
+//
+// The time fix found by the writer's Clock_Repair is sent ahead of
+// the records, so that it is recorded in each output database.
+
+#include "find_tags_common.hpp"
+#include "Data_Source.hpp"
+#include "SG_Record.hpp"
+
+#include <stdio.h>
+
+class Record_Pipe : public Data_Source {
+
+public:
+  Record_Pipe(int fd, bool writing); //!< wrap one end of a pipe; takes ownership of fd
+  ~Record_Pipe();
+
+  bool getline(char * buf, int maxLen); //!< always false: records, not lines, come through the pipe
+
+  bool put(const SG_Record & r); //!< write a record; false if the pipe is broken
+
+  bool put_time_fix(Timestamp tsLow, Timestamp tsHigh, Timestamp by, Timestamp error, char fixType); //!< write a time fix; false if the pipe is broken
+
+  bool get(SG_Record & r, DB_Filer * filer); //!< read the next record, recording any time fixes preceding it with filer; false at end of input
+
+  void close(); //!< close the pipe, so that the reader sees the end of input
+
+protected:
+  FILE * f;
+
+  static const int TIME_FIX = 'T'; //!< marks a time fix; distinct from SG_Record::Type values
+};
+
+#endif // RECORD_PIPE_HPP
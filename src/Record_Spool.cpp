@@ -0,0 +1,74 @@
+#include "Record_Spool.hpp"
+
+#include <string.h>
+
+Record_Spool::Record_Spool(size_t max_mem) :
+  max_mem(max_mem),
+  mem(),
+  pos(0),
+  spill(0)
+{
+};
+
+Record_Spool::~Record_Spool() {
+  clear();
+};
+
+void
+Record_Spool::put(const SG_Record & r) {
+  char buf[SG_Record::MAX_PACKED];
+  size_t n = r.pack(buf);
+
+  if (! spill && mem.size() + n <= max_mem) {
+    mem.append(buf, n);
+    return;
+  }
+  if (! spill) {
+    spill = tmpfile();
+    if (! spill)
+      throw std::runtime_error("Unable to create temporary file for records awaiting clock repair");
+  }
+  if (fwrite(buf, n, 1, spill) != 1)
+    throw std::runtime_error("Unable to write temporary file for records awaiting clock repair");
+};
+
+void
+Record_Spool::start_replay() {
+  pos = 0;
+  if (spill) {
+    if (fflush(spill))
+      throw std::runtime_error("Unable to write temporary file for records awaiting clock repair");
+    ::rewind(spill);
+  }
+};
+
+bool
+Record_Spool::get(SG_Record & r) {
+  if (pos < mem.size()) {
+    pos += r.unpack(mem.data() + pos);
+    return true;
+  }
+  if (spill) {
+    char buf[SG_Record::MAX_PACKED];
+    int c = getc(spill);
+    if (c != EOF) {
+      buf[0] = c;
+      size_t n = SG_Record::packed_size((SG_Record::Type) c) - 1;
+      if (fread(buf + 1, n, 1, spill) != 1)
+        throw std::runtime_error("Truncated temporary file of records awaiting clock repair");
+      r.unpack(buf);
+      return true;
+    }
+  }
+  clear();
+  return false;
+};
+
+void
+Record_Spool::clear() {
+  std::string().swap(mem);
+  pos = 0;
+  if (spill)
+    fclose(spill);
+  spill = 0;
+};
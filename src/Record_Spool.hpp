@@ -0,0 +1,46 @@
+#ifndef RECORD_SPOOL_HPP
+#define RECORD_SPOOL_HPP
+
+//!< Record_Spool - a first-in, first-out store of parsed SG records.
+//
+// Clock_Repair reads records until it can estimate the correction to
+// their timestamps, then has to process those same records again.
+// Rather than rewinding the data source, which decompresses and
+// parses the input a second time (and which isn't possible for input
+// from a pipe), it keeps the records in a Record_Spool and replays
+// them.
+//
+// Records are stored in the compact binary form of SG_Record::pack(),
+// in memory up to a limit, and beyond that in an anonymous temporary
+// file, so that the spool can hold many hours of records if the clock
+// can't be fixed until late in a boot session.
+
+#include "find_tags_common.hpp"
+#include "SG_Record.hpp"
+
+#include <stdio.h>
+
+class Record_Spool {
+
+public:
+  Record_Spool(size_t max_mem = DEFAULT_MAX_MEM); //!< ctor, with the number of bytes of records to hold in memory before spilling to a file
+  ~Record_Spool();
+
+  void put(const SG_Record & r); //!< add a record
+
+  void start_replay(); //!< after all records have been added, prepare to get() them
+
+  bool get(SG_Record & r); //!< get the next record, in the order added; false (and the spool is cleared) once all have been returned
+
+  void clear(); //!< drop all records and release their storage
+
+  static const size_t DEFAULT_MAX_MEM = 256 * 1024 * 1024;
+
+protected:
+  size_t max_mem;
+  std::string mem;   //!< the first records added, encoded
+  size_t pos;        //!< offset in mem of next record to get()
+  FILE * spill;      //!< temporary file holding the records which didn't fit in mem, or 0
+};
+
+#endif // RECORD_SPOOL_HPP
@@ -0,0 +1,64 @@
+#include "SG_Mmap_Data_Source.hpp"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+SG_Mmap_Data_Source::SG_Mmap_Data_Source(std::string path) :
+  data(0),
+  size(0),
+  pos(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Unable to open input file " + path);
+  struct stat st;
+  if (fstat(fd, & st) < 0) {
+    close(fd);
+    throw std::runtime_error("Unable to get size of input file " + path);
+  }
+  size = st.st_size;
+  if (size > 0) {
+    void * p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Unable to map input file " + path);
+    }
+    // the file is read once from start to end (apart from rewinds), so
+    // the kernel can read ahead aggressively and drop pages behind us
+    madvise(p, size, MADV_SEQUENTIAL);
+    data = reinterpret_cast < const char * > (p);
+  }
+  // the mapping keeps the file open
+  close(fd);
+};
+
+SG_Mmap_Data_Source::~SG_Mmap_Data_Source() {
+  if (data)
+    munmap(const_cast < char * > (data), size);
+};
+
+bool
+SG_Mmap_Data_Source::next_line(const char ** line, int * len) {
+  // skip empty lines, as SG_File_Data_Source does
+  while (pos < size) {
+    const char * start = data + pos;
+    // memchr scans a word or vector at a time
+    const char * eol = reinterpret_cast < const char * > (memchr(start, '\n', size - pos));
+    size_t lineLen = eol ? eol - start : size - pos;
+    pos += lineLen + 1;
+    if (lineLen == 0)
+      continue;
+    * line = start;
+    * len = std::min(lineLen, (size_t) MAX_LINE_SIZE);
+    return true;
+  }
+  return false;
+};
+
+void
+SG_Mmap_Data_Source::rewind() {
+  pos = 0;
+};
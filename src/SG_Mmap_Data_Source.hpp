@@ -0,0 +1,25 @@
+#ifndef SG_MMAP_DATA_SOURCE_HPP
+#define SG_MMAP_DATA_SOURCE_HPP
+
+//!< Source for SG-format input data from a regular file, which is
+//!< memory-mapped rather than read through a stream, so that lines are
+//!< handed out without copying, and the source can be rewound.
+
+#include "find_tags_common.hpp"
+#include "Data_Source.hpp"
+
+class SG_Mmap_Data_Source : public Data_Source {
+
+public:
+  SG_Mmap_Data_Source(std::string path);
+  ~SG_Mmap_Data_Source();
+  bool next_line(const char ** line, int * len);
+  void rewind();
+
+protected:
+  const char * data; //!< start of the mapped file; 0 if the file is empty
+  size_t size;       //!< size of the file
+  size_t pos;        //!< offset of next byte to use
+};
+
+#endif // SG_MMAP_DATA_SOURCE
@@ -1,6 +1,8 @@
 #include "SG_Record.hpp"
 
 #include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <sstream>
 
 SG_Record::SG_Record() :
@@ -8,8 +10,245 @@ SG_Record::SG_Record() :
 {
 };
 
+// Field parsers for from_chars().  Each parses a number at p, stopping
+// at end, as sscanf would for the corresponding conversion, and returns
+// a pointer just past it; if p is 0 or there is no number, they return
+// 0, so that calls can be chained.  Plain decimals short enough to be
+// converted with a single correctly-rounded division (e.g. timestamps,
+// signal strengths, frequency offsets) are handled directly; anything
+// else (exponents, hex, inf/nan, leading space, long digit strings) is
+// left to strtod, strtof or strtol, so results are bit-identical to
+// those from sscanf.
+
+static const double exact_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const float exact_pow10f[] = {
+  1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+//!< scan a plain decimal like -123.456 into sign, digits and number
+// of fractional digits; return 0 if it isn't one, or has more than 19
+// digits
+static const char *
+scan_decimal(const char * p, const char * end, bool & neg, uint64_t & m, int & frac) {
+  neg = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = *p++ == '-';
+  m = 0;
+  frac = 0;
+  int digits = 0;
+  for (; p < end && (unsigned) (*p - '0') < 10; ++p, ++digits)
+    m = 10 * m + (*p - '0');
+  if (p < end && *p == '.')
+    for (++p; p < end && (unsigned) (*p - '0') < 10; ++p, ++digits, ++frac)
+      m = 10 * m + (*p - '0');
+  if (digits == 0 || digits > 19 || (p < end && (*p == 'e' || *p == 'E' || *p == 'x' || *p == 'X')))
+    return 0;
+  return p;
+};
+
+//!< copy [p, end) to a 0-terminated buffer, for the strto* functions
+static size_t
+terminate(const char * p, const char * end, char * buf) {
+  size_t n = std::min((size_t) (end - p), (size_t) MAX_LINE_SIZE);
+  memcpy(buf, p, n);
+  buf[n] = '\0';
+  return n;
+};
+
+static const char *
+parse_double(const char * p, const char * end, double & x) {
+  if (! p)
+    return 0;
+  bool neg;
+  uint64_t m;
+  int frac;
+  const char * q = scan_decimal(p, end, neg, m, frac);
+  if (q && m <= (1ULL << 53) && frac <= 22) {
+    x = (double) m / exact_pow10[frac];
+    if (neg)
+      x = -x;
+    return q;
+  }
+  char buf[MAX_LINE_SIZE + 1];
+  char * e;
+  terminate(p, end, buf);
+  x = strtod(buf, & e);
+  return e == buf ? 0 : p + (e - buf);
+};
+
+static const char *
+parse_float(const char * p, const char * end, float & x) {
+  if (! p)
+    return 0;
+  bool neg;
+  uint64_t m;
+  int frac;
+  const char * q = scan_decimal(p, end, neg, m, frac);
+  if (q && m <= (1ULL << 24) && frac <= 10) {
+    x = (float) m / exact_pow10f[frac];
+    if (neg)
+      x = -x;
+    return q;
+  }
+  char buf[MAX_LINE_SIZE + 1];
+  char * e;
+  terminate(p, end, buf);
+  x = strtof(buf, & e);
+  return e == buf ? 0 : p + (e - buf);
+};
+
+static const char *
+parse_int(const char * p, const char * end, long & x) {
+  if (! p)
+    return 0;
+  const char * q = p;
+  bool neg = false;
+  if (q < end && (*q == '-' || *q == '+'))
+    neg = *q++ == '-';
+  long n = 0;
+  int digits = 0;
+  for (; q < end && (unsigned) (*q - '0') < 10; ++q, ++digits)
+    n = 10 * n + (*q - '0');
+  if (digits > 0 && digits <= 9) {
+    x = neg ? -n : n;
+    return q;
+  }
+  char buf[MAX_LINE_SIZE + 1];
+  char * e;
+  terminate(p, end, buf);
+  x = strtol(buf, & e, 10);
+  return e == buf ? 0 : p + (e - buf);
+};
+
+//!< skip the comma expected at p; 0 if there isn't one
+static const char *
+comma(const char * p, const char * end) {
+  return (p && p < end && *p == ',') ? p + 1 : 0;
+};
+
 void
 SG_Record::from_buf(char * buf) {
+  from_chars(buf, buf + strlen(buf));
+};
+
+void
+SG_Record::from_chars(const char * buf, const char * end) {
+  // assume invalid record
+  type = BAD;
+  if (buf == end)
+    return;
+
+  // as for from_buf_sscanf(), all but pulse records begin with a
+  // letter and a character which is ignored
+  const char * p = end - buf > 1 ? buf + 2 : 0;
+  long n, m;
+
+  switch (buf[0]) {
+  case 'p':
+    // p1,14332651182.1235,3.234,-55.44,-77.33
+    p = parse_int(buf + 1, end, n);
+    p = parse_double(comma(p, end), end, ts);
+    p = parse_float(comma(p, end), end, v.dfreq);
+    p = parse_float(comma(p, end), end, v.sig);
+    p = parse_float(comma(p, end), end, v.noise);
+    if (p) {
+      port = n;
+      type = PULSE;
+    }
+    break;
+
+  case 'G':
+    // G,1458001712,44.34021,-66.118733333,21.6
+    p = parse_double(p, end, ts);
+    p = parse_double(comma(p, end), end, v.lat);
+    p = parse_double(comma(p, end), end, v.lon);
+    p = parse_double(comma(p, end), end, v.alt);
+    if (p)
+      type = GPS;
+    break;
+
+  case 'C':
+    // C,1466715518.311,6,0.00000196
+    p = parse_double(p, end, ts);
+    p = parse_int(comma(p, end), end, m);
+    p = parse_double(comma(p, end), end, v.clock_remaining);
+    if (p) {
+      v.clock_level = m;
+      type = CLOCK;
+    }
+    break;
+
+  case 'F':
+    // F,1466715518.311
+    if (parse_double(p, end, ts))
+      type = SG_Record::FILE;
+    break;
+
+  case 'S':
+    {
+      // parameter settings are rare and have several formats, so
+      // leave them to sscanf
+      char line[MAX_LINE_SIZE + 1];
+      terminate(buf, end, line);
+      from_buf_sscanf(line);
+    }
+    break;
+
+  default:
+    break;
+  };
+};
+
+size_t
+SG_Record::pack(char * buf) const {
+  // the type, timestamp, and port, followed by only as much of the
+  // value union as the type uses
+  char * p = buf;
+  * p++ = type;
+  memcpy(p, & ts, sizeof(ts));
+  p += sizeof(ts);
+  memcpy(p, & port, sizeof(port));
+  p += sizeof(port);
+  size_t n = type == PARAM ? sizeof(v) : SHORT_PAYLOAD;
+  memcpy(p, & v, n);
+  return p + n - buf;
+};
+
+size_t
+SG_Record::unpack(const char * buf) {
+  const char * p = buf;
+  type = (Type) * p++;
+  memcpy(& ts, p, sizeof(ts));
+  p += sizeof(ts);
+  memcpy(& port, p, sizeof(port));
+  p += sizeof(port);
+  size_t n = type == PARAM ? sizeof(v) : SHORT_PAYLOAD;
+  memcpy(& v, p, n);
+  return p + n - buf;
+};
+
+size_t
+SG_Record::from_blob(const char * buf, size_t len, std::vector < SG_Record > & recs) {
+  const char * end = buf + len;
+  size_t n = 0;
+  while (buf < end) {
+    const char * eol = reinterpret_cast < const char * > (memchr(buf, '\n', end - buf));
+    if (! eol)
+      eol = end;
+    recs.push_back(SG_Record());
+    recs.back().from_chars(buf, eol);
+    buf = eol + 1;
+    ++n;
+  }
+  return n;
+};
+
+void
+SG_Record::from_buf_sscanf(char * buf) {
   // assume invalid record
   type = BAD;
   switch (buf[0]) {
@@ -7,17 +7,21 @@
 // handled as a tagged union
 
 struct SG_Record {
-  typedef enum {BAD, PULSE, GPS, PARAM, CLOCK, EXTENSION, FILE} Type;
+  typedef enum {BAD, PULSE, GPS, PARAM, CLOCK, EXTENSION, FILE, DETECTION} Type;
   Type type;  //!< type of record represented
 
   Timestamp ts;  //!< timestamp from file line; common to all record types
   Port_Num port; //!< port from file line; common to most record types
   union record_union {
     struct {
-      // Pulse record
+      // Pulse record; also a Detection record, which is a burst
+      // already decoded by the receiver (e.g. a Lotek receiver), and
+      // so carries the tag ID it reported
       Frequency_Offset_kHz dfreq;
       SignaldB             sig;
       SignaldB             noise;
+      short                codeSet;  //!< Detection only: codeset of the ID
+      short                mfgID;    //!< Detection only: manufacturer's tag ID
     };
 
     struct {
@@ -49,6 +53,22 @@ struct SG_Record {
 
   void from_buf(char * buf);        //!< construct from buffer
 
+  void from_chars(const char * buf, const char * end); //!< construct from the line [buf, end), which needn't be 0-terminated
+
+  void from_buf_sscanf(char * buf); //!< construct from buffer using sscanf; the reference for from_chars(), used by benchParse
+
+  static size_t from_blob(const char * buf, size_t len, std::vector < SG_Record > & recs); //!< append a record for each line in [buf, buf + len), including BAD ones; returns number of lines
+
+  size_t pack(char * buf) const; //!< write a compact binary form of the record to buf, which must hold MAX_PACKED bytes; returns the number of bytes written
+
+  size_t unpack(const char * buf); //!< read a record written by pack(); returns the number of bytes read
+
+  static size_t packed_size(Type type) { return 1 + sizeof(Timestamp) + sizeof(Port_Num) + (type == PARAM ? sizeof(record_union) : SHORT_PAYLOAD); }; //!< bytes written by pack() for a record of the given type
+
+  static const size_t SHORT_PAYLOAD = 3 * sizeof(double); //!< bytes of v used by records other than PARAM
+
+  static const size_t MAX_PACKED = 1 + sizeof(Timestamp) + sizeof(Port_Num) + sizeof(record_union); //!< largest packed record
+
   template<class Archive>
   void serialize(Archive & ar, const unsigned int version)
   {
@@ -62,6 +82,14 @@ struct SG_Record {
       ar & BOOST_SERIALIZATION_NVP( v.noise );
       break;
 
+    case DETECTION:
+      ar & BOOST_SERIALIZATION_NVP( v.dfreq );
+      ar & BOOST_SERIALIZATION_NVP( v.sig );
+      ar & BOOST_SERIALIZATION_NVP( v.noise );
+      ar & BOOST_SERIALIZATION_NVP( v.codeSet );
+      ar & BOOST_SERIALIZATION_NVP( v.mfgID );
+      break;
+
     case GPS:
       ar & BOOST_SERIALIZATION_NVP( v.lat );
       ar & BOOST_SERIALIZATION_NVP( v.lon );
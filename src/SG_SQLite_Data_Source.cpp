@@ -3,10 +3,10 @@
 SG_SQLite_Data_Source::SG_SQLite_Data_Source(DB_Filer * db, unsigned int monoBN) :
   db(db),
   bytesLeft(0),
+  blobOffset(0),
   offset(0),
   originTS(0),
   originOffset(0),
-  originBytesLeft(0),
   emptyBlob()
 {
   blob = &emptyBlob[0];
@@ -14,42 +14,41 @@ SG_SQLite_Data_Source::SG_SQLite_Data_Source(DB_Filer * db, unsigned int monoBN)
 };
 
 bool
-SG_SQLite_Data_Source::getline(char * buf, int maxLen) {
+SG_SQLite_Data_Source::next_line(const char ** line, int * len) {
 
   // bytesLeft will be -1 if we read an unterminated line on previous call
 
   while (bytesLeft <= 0) {
     // Ensure we have some blob data to read.
-    // It is guaranteed that lines are not split across blobs.
+    // It is guaranteed that lines are not split across blobs, nor
+    // across the pieces in which large blobs are read.
     // repeat until a non-empty blob is found, or none remain
 
-    if (! db->get_blob(& blob, & bytesLeft, & blobTS))
+    if (! db->get_blob(& blob, & bytesLeft, & blobTS, & blobOffset))
       return false;
+    offset = blobOffset;
+    if (blobOffset > 0)
+      continue; // a later piece of the same blob
     // Note: get_blob() can return an empty blob, either because the
     // file was truly empty, or because it was a corrupt compressed file
     // and zlib wasn't able to extract anything from it.  That will
     // leave bytesLeft = 0, so the loop will continue.
     // We still want to record the timestamp.
-    offset = 0;
     // generate a synthetic "File Timestamp" line like this:
     // F,1432456345.2345
-    std::ostringstream ft_rec;
-    ft_rec << "F," << std::setprecision(14) << blobTS;
-    strcpy(buf, ft_rec.str().c_str());
+    * len = snprintf(fileLine, sizeof(fileLine), "F,%.14g", blobTS);
+    * line = fileLine;
     return true;
   }
-  const char * start = blob + offset;
+  const char * start = blob + (offset - blobOffset);
   const char * eol = reinterpret_cast < const char * > (memchr(start, '\n', bytesLeft));
 
   // if no eol found, line goes to end of blob
   int lineLen = eol ? eol - start : bytesLeft;
 
-  // truncate to max permitted line size; we silently discard the remainder
-  int useLineLen = std::min(lineLen, maxLen);
-
-  // copy to output
-  memcpy(buf, start, useLineLen); // NB: we know these regions don't overlap; else we'd use memmove
-  buf[useLineLen] = '\0';        // terminating 0
+  // point into the blob; the caller copies the line if it needs to
+  * line = start;
+  * len = lineLen;
   bytesLeft -= lineLen + 1;      // NB: include the '\n' char in the calculation; will get -1 for unterminated line
   offset += lineLen + 1;
   return true;
@@ -57,13 +56,18 @@ SG_SQLite_Data_Source::getline(char * buf, int maxLen) {
 
 void
 SG_SQLite_Data_Source::rewind() {
-  db->rewind_blob_reader(originTS);
-  db->get_blob(& blob, & bytesLeft, & blobTS);
+  db->rewind_blob_reader(originTS, originOffset);
+  db->get_blob(& blob, & bytesLeft, & blobTS, & blobOffset);
+  offset = blobOffset;
+};
+
+void
+SG_SQLite_Data_Source::seek_file(Timestamp ts) {
+  // the next call to getline() fetches the first blob at or after ts
+  db->rewind_blob_reader(ts);
+  bytesLeft = 0;
+  blobOffset = 0;
   offset = 0;
-  if (originTS > 0) {
-    offset    = originOffset;
-    bytesLeft = originBytesLeft;
-  }
 };
 
 SG_SQLite_Data_Source::~SG_SQLite_Data_Source() {
@@ -82,13 +86,14 @@ SG_SQLite_Data_Source::serialize(boost::archive::binary_iarchive & ar, const uns
 
   SERIALIZE_FUN_BODY;
 
-  db->seek_blob(blobTS);
-  db->get_blob(& blob, & bytesLeft, & blobTS);
-  bytesLeft -= offset;
+  // resume part way into the blob; if it is large, only the piece
+  // from there on is read
+  db->seek_blob(blobTS, offset);
+  db->get_blob(& blob, & bytesLeft, & blobTS, & blobOffset);
+  offset = blobOffset;
 
   // set up rewind location:
   originTS        = blobTS;
-  originBytesLeft = bytesLeft;
   originOffset    = offset;
 };
 
@@ -13,19 +13,21 @@ class SG_SQLite_Data_Source : public Data_Source {
 public:
   SG_SQLite_Data_Source(DB_Filer * db, unsigned int monoBN);
   ~SG_SQLite_Data_Source();
-  bool getline(char * buf, int maxLen);
+  bool next_line(const char ** line, int * len);
   void rewind();
+  void seek_file(Timestamp ts);
 
 protected:
   DB_Filer * db;
   int bytesLeft; //!< bytes left to use in blob buffer
-  const char * blob; //!< pointer to next char to use in blob buffer
-  int offset; //!< offset from blob of next byte to use
+  const char * blob; //!< pointer to blob buffer, which holds the whole blob or, for a large one, the piece of it being read
+  int blobOffset; //!< offset into the blob of the start of the blob buffer
+  int offset; //!< offset into the blob of next byte to use
   Timestamp blobTS; //!< timestamp of start of current blob; used in resume().
   Timestamp originTS; //!< timestamp of start of blob to which we rewind, after resume()
   int originOffset; //!< offset from first blob to which we rewind, after resume()
-  int originBytesLeft; //!< bytes left in blob after rewind, after resume()
   char emptyBlob[1]; //!< empty buffer for initial blob
+  char fileLine[32]; //!< synthetic "F,TS" line giving the timestamp of a blob
 
   void serialize(boost::archive::binary_iarchive & ar, const unsigned int version);
   void serialize(boost::archive::binary_oarchive & ar, const unsigned int version);
@@ -0,0 +1,58 @@
+#include "SQLite_Sink.hpp"
+
+SQLite_Sink::SQLite_Sink(DB_Filer * filer) :
+  filer(filer)
+{
+};
+
+void
+SQLite_Sink::begin_run(DB_Filer::Run_ID rid, DB_Filer::Batch_ID bid, Motus_Tag_ID mid, int ant, Timestamp ts) {
+  DB_Filer::Write_Record w = {DB_Filer::W_BEGIN_RUN, {rid, mid, ant}, {ts}};
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::end_run(DB_Filer::Run_ID rid, int n, Timestamp ts, bool countOnly) {
+  DB_Filer::Write_Record w = {DB_Filer::W_END_RUN, {rid, n, countOnly}, {ts}};
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) {
+  DB_Filer::Write_Record w = {DB_Filer::W_HIT, {rid}, {ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop}};
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt) {
+  DB_Filer::Write_Record w = {DB_Filer::W_GPS_FIX, {0}, {ts, lat, lon, alt}};
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count) {
+  DB_Filer::Write_Record w = {DB_Filer::W_PULSE_COUNT, {ant, count}, {hourBin}};
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra) {
+  DB_Filer::Write_Record w = {DB_Filer::W_RECV_PARAM, {ant, error, (int) filer->fill.text.size()}, {ts, val}};
+  filer->fill.text.push_back(param);
+  filer->fill.text.push_back(extra);
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p) {
+  DB_Filer::Write_Record w = {DB_Filer::W_PULSE, {ant}, {p.ts, p.ant_freq, p.dfreq, p.sig, p.noise}};
+  filer->queue(w);
+};
+
+void
+SQLite_Sink::close() {
+};
+
+void
+SQLite_Sink::add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done) {
+};
@@ -0,0 +1,50 @@
+#ifndef SQLITE_SINK_HPP
+#define SQLITE_SINK_HPP
+
+//!< SQLite_Sink - write output to the receiver database.
+//
+// This is the sink a DB_Filer starts with, and goes back to when
+// set_sink(0) is called.  Runs, hits, GPS fixes, pulse counts,
+// receiver parameters and pulses go to the `runs`, `hits` (or
+// `hitsCompact`), `gps`, `pulseCounts`, `params` and `pulses` tables.
+//
+// Each record is handed to the filer's write queue, and written by
+// DB_Filer::write_block(), rather than written here.  The queue also
+// carries the time fixes and batch files which the filer records in
+// the database whatever the sink, and the filer's batch and parameter
+// writes share its connection and transactions, so they must all be
+// written by the filer, in the order reported.  A run is inserted
+// when it begins and updated when it ends, unless the filer is in
+// bulk load mode; see DB_Filer.
+
+#include "Output_Sink.hpp"
+
+class SQLite_Sink : public Output_Sink {
+
+public:
+  SQLite_Sink(DB_Filer * filer);
+
+  void begin_run(DB_Filer::Run_ID rid, DB_Filer::Batch_ID bid, Motus_Tag_ID mid, int ant, Timestamp ts);
+
+  void end_run(DB_Filer::Run_ID rid, int n, Timestamp ts, bool countOnly);
+
+  void add_hit(DB_Filer::Batch_ID bid, DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop);
+
+  void add_GPS_fix(DB_Filer::Batch_ID bid, double ts, double lat, double lon, double alt);
+
+  void add_pulse_count(DB_Filer::Batch_ID bid, double hourBin, int ant, int count);
+
+  void add_recv_param(DB_Filer::Batch_ID bid, Timestamp ts, int ant, const char *param, double val, int error, const char *extra);
+
+  void add_pulse(DB_Filer::Batch_ID bid, int ant, const Pulse &p);
+
+  void close(); //!< nothing to do: the filer writes what it has queued when flushed or destroyed
+
+protected:
+
+  DB_Filer * filer; //!< whose queue records go to; records are for its current batch, so bid is not used
+
+  void add_run(DB_Filer::Run_ID rid, const Run_Begin & rb, int len, Timestamp tsEnd, int done); //!< not used, as begin_run() and end_run() are replaced
+};
+
+#endif // SQLITE_SINK_HPP
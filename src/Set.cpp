@@ -49,8 +49,11 @@ Set::augment(TagPhase p) {
     if (e.first->second == p.second)
       throw std::runtime_error("Adding existing tagphase to tagphaseset");
   }
-  s.insert(p);
-  hash ^= hashT(p.first);
+  // hash is only a function of the set's tags, so that equal sets
+  // have equal hashes however they were built; a tag already in the
+  // set keeps its phase
+  if (s.insert(p).second)
+    hash ^= hashT(p.first);
   return this;
 };
 
@@ -60,8 +63,9 @@ Set::reduce(Tag * t) {
   // reduction leads to that
   if(this == _empty)
     throw std::runtime_error("Reducing empty set");
+  if (count(t))
+    hash ^= hashT(t);
   erase(t);
-  hash ^= hashT(t);
   if (s.size() == 0) {
     delete this;
     return _empty;
@@ -103,8 +107,7 @@ Set::cloneAugment(TagPhase p) {
   }
   Set * ns = new Set();
   ns->s = s;
-  ns->s.insert(p);
-  ns->hash = hash ^ hashT(p.first);
+  ns->hash = ns->s.insert(p).second ? hash ^ hashT(p.first) : hash;
   return ns;
 };
 
@@ -15,6 +15,7 @@ class Set {
   friend class hashSet;
   friend class SetEqual;
   friend class Tag_Foray;
+  friend class Candidate_Archive;
 
 protected:
   TagPhaseSet s;
@@ -66,15 +67,6 @@ public:
 
 private:
   static TagPhaseSetHash hashT (Tag * t);
-
-public:
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version) {
-    ar & BOOST_SERIALIZATION_NVP( s );
-    ar & BOOST_SERIALIZATION_NVP( _label );
-    ar & BOOST_SERIALIZATION_NVP( hash );
-  };
-
 };
 
 struct hashSet {
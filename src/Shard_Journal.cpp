@@ -0,0 +1,157 @@
+#include "Shard_Journal.hpp"
+
+#include <string.h>
+
+Shard_Journal::Shard_Journal() :
+  param(),
+  extra(),
+  f(tmpfile()),
+  owned(true),
+  next_rid(1)
+{
+  if (! f)
+    throw std::runtime_error("Unable to create temporary file for time shard journal");
+};
+
+Shard_Journal::~Shard_Journal() {
+  if (f)
+    fclose(f);
+};
+
+void
+Shard_Journal::set_owned(bool owned) {
+  this->owned = owned;
+};
+
+void
+Shard_Journal::put(Entry & e) {
+  e.owned = owned;
+  if (1 != fwrite(& e, sizeof(Entry), 1, f))
+    throw std::runtime_error("Unable to write to time shard journal");
+};
+
+DB_Filer::Run_ID
+Shard_Journal::begin_run(Motus_Tag_ID mid, int ant, Timestamp ts) {
+  Entry e = Entry();
+  e.type = BEGIN_RUN;
+  e.id = next_rid;
+  e.n = mid;
+  e.ant = ant;
+  e.ts = ts;
+  if (mid < 0) {
+    // proxy IDs are allocated independently by each shard, so record
+    // the set of real tag IDs the proxy stands for
+    auto i = Ambiguity::ids.right.find(mid);
+    if (i != Ambiguity::ids.right.end()) {
+      int k = 0;
+      for (auto j = i->second.begin(); j != i->second.end() && k < 7; ++j)
+        e.v[k++] = *j;
+    }
+  }
+  put(e);
+  return next_rid++;
+};
+
+void
+Shard_Journal::end_run(DB_Filer::Run_ID rid, int n, Timestamp ts, bool countOnly) {
+  Entry e = Entry();
+  e.type = END_RUN;
+  e.id = rid;
+  e.n = n;
+  e.ts = ts;
+  e.v[0] = countOnly;
+  put(e);
+};
+
+void
+Shard_Journal::add_hit(DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop) {
+  Entry e = Entry();
+  e.type = HIT;
+  e.id = rid;
+  e.ts = ts;
+  e.v[0] = sig;
+  e.v[1] = sigSD;
+  e.v[2] = noise;
+  e.v[3] = freq;
+  e.v[4] = freqSD;
+  e.v[5] = slop;
+  e.v[6] = burstSlop;
+  put(e);
+};
+
+void
+Shard_Journal::add_GPS_fix(double ts, double lat, double lon, double alt) {
+  Entry e = Entry();
+  e.type = GPS_FIX;
+  e.ts = ts;
+  e.v[0] = lat;
+  e.v[1] = lon;
+  e.v[2] = alt;
+  put(e);
+};
+
+void
+Shard_Journal::add_pulse_count(double hourBin, int ant, int count) {
+  Entry e = Entry();
+  e.type = PULSE_COUNT;
+  e.ts = hourBin;
+  e.ant = ant;
+  e.n = count;
+  put(e);
+};
+
+void
+Shard_Journal::add_recv_param(Timestamp ts, int ant, char *param, double val, int error, char *extra) {
+  Entry e = Entry();
+  e.type = RECV_PARAM;
+  e.ts = ts;
+  e.ant = ant;
+  e.v[0] = val;
+  e.n = error;
+  put(e);
+  // the two strings follow the entry, in fixed-size fields
+  char pbuf[sizeof(this->param)] = {0};
+  char ebuf[sizeof(this->extra)] = {0};
+  strncpy(pbuf, param, sizeof(pbuf) - 1);
+  strncpy(ebuf, extra, sizeof(ebuf) - 1);
+  if (1 != fwrite(pbuf, sizeof(pbuf), 1, f) || 1 != fwrite(ebuf, sizeof(ebuf), 1, f))
+    throw std::runtime_error("Unable to write to time shard journal");
+};
+
+void
+Shard_Journal::add_batch_file(int fileID) {
+  Entry e = Entry();
+  e.type = BATCH_FILE;
+  e.id = fileID;
+  put(e);
+};
+
+void
+Shard_Journal::add_max_num_cands(long long n, Timestamp ts) {
+  Entry e = Entry();
+  e.type = MAX_NUM_CANDS;
+  e.ts = ts;
+  e.v[0] = n;
+  put(e);
+};
+
+void
+Shard_Journal::finish() {
+  if (fflush(f))
+    throw std::runtime_error("Unable to flush time shard journal");
+};
+
+void
+Shard_Journal::rewind() {
+  fseek(f, 0, SEEK_SET);
+};
+
+bool
+Shard_Journal::get(Entry & e) {
+  if (1 != fread(& e, sizeof(Entry), 1, f))
+    return false;
+  if (e.type == RECV_PARAM
+      && (1 != fread(param, sizeof(param), 1, f) || 1 != fread(extra, sizeof(extra), 1, f)))
+    throw std::runtime_error("Truncated time shard journal");
+  return true;
+};
@@ -0,0 +1,89 @@
+#ifndef SHARD_JOURNAL_HPP
+#define SHARD_JOURNAL_HPP
+
+#include "find_tags_common.hpp"
+#include "DB_Filer.hpp"
+#include "Ambiguity.hpp"
+
+#include <stdio.h>
+
+/*
+  Shard_Journal - a temporary file recording the output generated
+  while processing one time shard of a boot session (see Shard_Runner).
+
+  Shards are processed by forked workers, which must not touch the
+  receiver database, so DB_Filer diverts its output calls here.  Each
+  entry notes whether it was generated while the shard was warming up
+  (i.e. re-processing the overlap with the previous shard) or after
+  that, when the shard owns its output.  Run IDs in the journal are
+  local to the shard; they are replaced by real run IDs when the
+  parent stitches shards together.
+*/
+
+class Shard_Journal {
+
+public:
+
+  typedef enum {
+    BEGIN_RUN   = 'B',
+    HIT         = 'H',
+    END_RUN     = 'E',
+    GPS_FIX     = 'G',
+    PULSE_COUNT = 'C',
+    RECV_PARAM  = 'S',
+    BATCH_FILE  = 'F',
+    MAX_NUM_CANDS = 'M'
+  } Entry_Type;
+
+  struct Entry {
+    char type;           //!< one of Entry_Type
+    bool owned;          //!< true if generated after the shard's warm-up period
+    short ant;           //!< antenna (BEGIN_RUN, PULSE_COUNT, RECV_PARAM)
+    int id;              //!< local run ID (BEGIN_RUN, HIT, END_RUN) or fileID (BATCH_FILE)
+    int n;               //!< motusTagID (BEGIN_RUN), hit count (END_RUN), pulse count (PULSE_COUNT), or error code (RECV_PARAM)
+    Timestamp ts;        //!< timestamp; hour bin for PULSE_COUNT
+    double v[7];         //!< hit parameters (HIT), lat, lon, alt (GPS_FIX), value (RECV_PARAM), countOnly (END_RUN), count (MAX_NUM_CANDS),
+                         //!< or IDs of tags represented by a proxy (BEGIN_RUN with negative motusTagID; 0 = unused)
+  };
+
+  Shard_Journal(); //!< create a journal in an anonymous temporary file
+
+  ~Shard_Journal();
+
+  void set_owned(bool owned); //!< mark subsequent entries as owned (or not) by this shard
+
+  DB_Filer::Run_ID begin_run(Motus_Tag_ID mid, int ant, Timestamp ts); //!< begin a run; returns a run ID local to this journal
+
+  void end_run(DB_Filer::Run_ID rid, int n, Timestamp ts, bool countOnly);
+
+  void add_hit(DB_Filer::Run_ID rid, double ts, float sig, float sigSD, float noise, float freq, float freqSD, float slop, float burstSlop);
+
+  void add_GPS_fix(double ts, double lat, double lon, double alt);
+
+  void add_pulse_count(double hourBin, int ant, int count);
+
+  void add_recv_param(Timestamp ts, int ant, char *param, double val, int error, char *extra);
+
+  void add_batch_file(int fileID);
+
+  void add_max_num_cands(long long n, Timestamp ts); //!< record the shard's maximum number of candidates, and when it was reached
+
+  void finish(); //!< flush all entries to the file; a worker must call this before exiting
+
+  void rewind(); //!< prepare to read entries from the start of the journal
+
+  bool get(Entry & e); //!< read the next entry; returns false when none remain
+
+  char param[16];  //!< parameter flag of the most recent RECV_PARAM entry read by get()
+  char extra[256]; //!< error text of the most recent RECV_PARAM entry read by get()
+
+protected:
+
+  FILE * f; //!< temporary file holding entries
+  bool owned; //!< value of `owned` for new entries
+  DB_Filer::Run_ID next_rid; //!< next local run ID
+
+  void put(Entry & e); //!< write an entry
+};
+
+#endif // SHARD_JOURNAL_HPP
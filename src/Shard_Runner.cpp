@@ -0,0 +1,349 @@
+#include "Shard_Runner.hpp"
+#include "SG_Record.hpp"
+
+#include <algorithm>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+Shard_Runner::Shard_Runner(Tag_Foray * foray, DB_Filer * dbf, int monoBN, unsigned int num_shards, Gap margin) :
+  foray(foray),
+  dbf(dbf),
+  monoBN(monoBN),
+  num_shards(num_shards),
+  margin(margin > 0 ? margin : foray->shard_margin())
+{
+};
+
+void
+Shard_Runner::plan() {
+  unsigned int n = files.size();
+  for (unsigned int k = 0; k < num_shards; ++k) {
+    Shard s;
+    s.owned = (unsigned long long) k * n / num_shards;
+    s.end = (unsigned long long) (k + 1) * n / num_shards;
+    // start warm-up at the last file beginning at least `margin` seconds
+    // before the shard's first file
+    s.first = s.owned;
+    while (s.first > 0 && files[s.first] > files[s.owned] - margin)
+      -- s.first;
+    s.journal = new Shard_Journal();
+    s.pid = 0;
+    shards.push_back(s);
+  }
+};
+
+void
+Shard_Runner::scan_freq_settings() {
+  // only lines beginning with 'S' can set a frequency, so the rest
+  // aren't parsed; files are counted as by Tag_Foray::run()
+  std::map < Port_Num, Frequency_MHz > freqs;
+  unsigned int file = 0;
+  unsigned int k = 0;
+  const char * line;
+  int len;
+  foray->data->seek_file(files[0]);
+  while (k < shards.size() && foray->data->next_line(& line, & len)) {
+    if (len > 0 && line[0] == 'F') {
+      for (; k < shards.size() && shards[k].first == file; ++k)
+        shards[k].freqs = freqs;
+      ++ file;
+      continue;
+    }
+    if (len < 2 || line[0] != 'S')
+      continue;
+    SG_Record r;
+    r.from_chars(line, line + len);
+    if (r.type == SG_Record::PARAM && ! strcmp("-m", r.v.param_flag) && ! r.v.return_code && ! isnan(r.v.param_value))
+      freqs[r.port] = r.v.param_value;
+  }
+};
+
+void
+Shard_Runner::process(Shard & s, bool last) {
+  foray->num_files = 0;
+  foray->warmup_files = s.owned - s.first;
+  foray->stop_file = last ? 0 : s.end - s.first + 1;
+  foray->owned = s.owned == s.first;
+  foray->journal = s.journal;
+  s.journal->set_owned(foray->owned);
+  dbf->set_journal(s.journal);
+
+  if (! foray->force_default_freq) {
+    for (auto i = s.freqs.begin(); i != s.freqs.end(); ++i)
+      foray->port_freq[i->first] = Freq_Setting(i->second);
+    std::fill(foray->dispatch.begin(), foray->dispatch.end(), Tag_Foray::Port_Dispatch());
+  }
+
+  foray->cr->seek_file(files[s.first]);
+  SG_Record r;
+  if (foray->cr->get(r))
+    foray->run(r);
+
+  // the parent's own count is already in place
+  if (! last)
+    s.journal->add_max_num_cands(Tag_Candidate::max_num_cands, Tag_Candidate::max_cand_time);
+  s.journal->finish();
+  dbf->set_journal(0);
+  foray->journal = 0;
+  foray->owned = true;
+  foray->stop_file = 0;
+};
+
+bool
+Shard_Runner::run() {
+  dbf->get_file_timestamps(monoBN, files);
+  if (num_shards > files.size())
+    num_shards = files.size();
+  if (num_shards < 2)
+    return false;
+
+  SG_Record r;
+  if (! foray->setup(r))
+    return true; // no records, so nothing to do
+
+  // tsBegin is that of the first record in the boot session, not of
+  // the first record seen by a shard
+  foray->tsBegin = r.ts;
+
+  plan();
+  scan_freq_settings();
+
+  // fork workers for all but the last shard; they must not inherit
+  // records queued for the parent's writer thread
+
+  dbf->flush();
+  std::cout.flush();
+  std::cerr.flush();
+  for (unsigned int k = 0; k + 1 < num_shards; ++k) {
+    pid_t pid = fork();
+    if (pid < 0)
+      throw std::runtime_error("Unable to fork worker for time shard");
+    if (pid == 0) {
+      // worker: never touch the parent's database connection, and exit
+      // without running destructors, which would end runs
+      int rv = 0;
+      try {
+        dbf->restart_blob_reader();
+        process(shards[k], false);
+      } catch (std::exception & e) {
+        std::cerr << "find_tags_motus: time shard " << k << " failed: " << e.what() << std::endl;
+        rv = 2;
+      }
+      _exit(rv);
+    }
+    shards[k].pid = pid;
+  }
+
+  process(shards.back(), true);
+
+  for (unsigned int k = 0; k + 1 < num_shards; ++k) {
+    int status;
+    if (waitpid(shards[k].pid, & status, 0) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      throw std::runtime_error("Worker for time shard failed");
+  }
+
+  // detection counts only matter for whether an ambiguity proxy has
+  // been detected, but keep them consistent with a serial run
+
+  auto fs = foray->tags->get_nominal_freqs();
+  for (auto f = fs.begin(); f != fs.end(); ++f) {
+    TagSet * ts = foray->tags->get_tags_at_freq(*f);
+    for (auto t = ts->begin(); t != ts->end(); ++t)
+      tags_by_id[(*t)->motusID] = *t;
+  }
+  for (auto i = Ambiguity::abm.right.begin(); i != Ambiguity::abm.right.end(); ++i)
+    tags_by_id[i->first->motusID] = i->first;
+
+  for (unsigned int k = 0; k < num_shards; ++k) {
+    replay(shards[k], k + 1 == num_shards);
+    delete shards[k].journal;
+  }
+
+  // pulse counts for each hour bin are summed over shards; the foray
+  // keeps the count for its current hour bin, as after a serial run
+
+  for (auto i = pulse_counts.begin(); i != pulse_counts.end(); ++i) {
+    dbf->add_pulse_count(i->first.first, i->first.second, i->second);
+    if (i->first.first == foray->prevHourBin)
+      foray->pulse_count[i->first.second + NUM_SPECIAL_PORTS] = i->second;
+  }
+  return true;
+};
+
+Motus_Tag_ID
+Shard_Runner::real_mid(const Shard_Journal::Entry & e) {
+  if (e.n >= 0)
+    return e.n;
+  Ambiguity::AmbigIDs ids;
+  for (int i = 0; i < 7; ++i)
+    if (e.v[i])
+      ids.insert((Motus_Tag_ID) e.v[i]);
+  auto i = Ambiguity::ids.left.find(ids);
+  if (i != Ambiguity::ids.left.end())
+    return i->second;
+  Motus_Tag_ID proxyID = Ambiguity::nextID--;
+  Ambiguity::ids.insert(Ambiguity::AmbigIDSetProxy(ids, proxyID));
+  return proxyID;
+};
+
+void
+Shard_Runner::note_hit(Open_Run & o, Timestamp ts) {
+  ++ o.len;
+  o.last_ts = o.ts_end = ts;
+  o.hits.push_back(ts);
+  while (o.hits.front() < ts - margin)
+    o.hits.pop_front();
+};
+
+bool
+Shard_Runner::adopt(Local_Run & lr, Open_Runs & open) {
+  for (auto c = carried.begin(); c != carried.end(); ++c) {
+    if (c->second.mid != lr.mid || c->second.ant != lr.ant)
+      continue;
+    for (auto w = lr.warm.begin(); w != lr.warm.end(); ++w) {
+      auto h = std::lower_bound(c->second.hits.begin(), c->second.hits.end(), *w - 1e-6);
+      if (h != c->second.hits.end() && *h <= *w + 1e-6) {
+        lr.real = c->first;
+        lr.offset = c->second.len - lr.warm.size();
+        open[c->first] = c->second;
+        carried.erase(c);
+        return true;
+      }
+    }
+  }
+  return false;
+};
+
+void
+Shard_Runner::resolve(Local_Run & lr, Timestamp ts, Open_Runs & open) {
+  if (adopt(lr, open))
+    return;
+  lr.real = dbf->begin_run(lr.mid, lr.ant, ts);
+  lr.offset = - (int) lr.warm.size();
+  Open_Run o = {lr.mid, lr.ant, 0, ts, ts};
+  open[lr.real] = o;
+};
+
+void
+Shard_Runner::replay(Shard & s, bool last) {
+  std::map < DB_Filer::Run_ID, Local_Run > local;
+  Open_Runs open;
+  Shard_Journal::Entry e;
+
+  s.journal->rewind();
+  while (s.journal->get(e)) {
+    switch (e.type) {
+    case Shard_Journal::BEGIN_RUN:
+      {
+        Local_Run lr = {real_mid(e), e.ant, e.ts, 0, 0, 0};
+        if (e.owned) {
+          lr.real = dbf->begin_run(lr.mid, lr.ant, e.ts);
+          Open_Run o = {lr.mid, lr.ant, 0, e.ts, e.ts};
+          open[lr.real] = o;
+        }
+        local[e.id] = lr;
+      }
+      break;
+
+    case Shard_Journal::HIT:
+      {
+        Local_Run & lr = local[e.id];
+        ++ lr.n;
+        if (! e.owned) {
+          lr.warm.push_back(e.ts);
+          break;
+        }
+        if (! lr.real)
+          resolve(lr, e.ts, open);
+        dbf->add_hit(lr.real, e.ts, e.v[0], e.v[1], e.v[2], e.v[3], e.v[4], e.v[5], e.v[6]);
+        note_hit(open[lr.real], e.ts);
+        if (! last) {
+          // the last shard ran in this process, so its tags are already counted
+          auto t = tags_by_id.find(lr.mid);
+          if (t != tags_by_id.end())
+            ++ t->second->count;
+        }
+      }
+      break;
+
+    case Shard_Journal::END_RUN:
+      {
+        auto i = local.find(e.id);
+        if (i == local.end())
+          break;
+        Local_Run & lr = i->second;
+        if (e.v[0] != 0) {
+          // run still open where a worker's shard stopped (see
+          // Tag_Foray::record_open_runs); it might continue a carried
+          // run without having hits of its own
+          if (lr.real || adopt(lr, open))
+            open[lr.real].ts_end = e.ts;
+          break;
+        }
+        // a run ending during warm-up ended in the previous shard too;
+        // a run with no hits of its own ends a carried run, if any
+        if (e.owned && (lr.real || adopt(lr, open))) {
+          dbf->end_run(lr.real, e.n + lr.offset, e.ts);
+          open.erase(lr.real);
+        }
+        local.erase(i);
+      }
+      break;
+
+    case Shard_Journal::GPS_FIX:
+      if (e.owned)
+        dbf->add_GPS_fix(e.ts, e.v[0], e.v[1], e.v[2]);
+      break;
+
+    case Shard_Journal::PULSE_COUNT:
+      pulse_counts[std::make_pair(e.ts, e.ant)] += e.n;
+      break;
+
+    case Shard_Journal::RECV_PARAM:
+      if (e.owned)
+        dbf->add_recv_param(e.ts, e.ant, s.journal->param, e.v[0], e.n, s.journal->extra);
+      break;
+
+    case Shard_Journal::BATCH_FILE:
+      dbf->add_batch_file(e.id);
+      break;
+
+    case Shard_Journal::MAX_NUM_CANDS:
+      // shards ran concurrently, so take the largest of their counts
+      if (e.v[0] > Tag_Candidate::max_num_cands) {
+        Tag_Candidate::max_num_cands = e.v[0];
+        Tag_Candidate::max_cand_time = e.ts;
+      }
+      break;
+
+    default:
+      throw std::runtime_error("Corrupt time shard journal");
+    }
+  }
+
+  if (last) {
+    // candidates in the foray hold local run IDs for runs still open;
+    // give them real ones
+
+    std::map < DB_Filer::Run_ID, std::pair < DB_Filer::Run_ID, int > > remap;
+    for (auto i = local.begin(); i != local.end(); ++i) {
+      Local_Run & lr = i->second;
+      if (! lr.real && ! adopt(lr, open)) {
+        lr.real = dbf->begin_run(lr.mid, lr.ant, lr.ts_begin);
+        lr.offset = - (int) lr.warm.size();
+      }
+      remap[i->first] = std::make_pair(lr.real, lr.offset);
+    }
+    foray->remap_run_ids(remap);
+  }
+
+  // carried runs not continued by this shard have ended
+
+  for (auto c = carried.begin(); c != carried.end(); ++c)
+    dbf->end_run(c->first, c->second.len, c->second.ts_end);
+
+  carried.swap(open);
+  if (last)
+    carried.clear();
+};
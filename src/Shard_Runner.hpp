@@ -0,0 +1,112 @@
+#ifndef SHARD_RUNNER_HPP
+#define SHARD_RUNNER_HPP
+
+#include "find_tags_common.hpp"
+
+#include "Tag_Foray.hpp"
+#include "Shard_Journal.hpp"
+
+#include <deque>
+#include <sys/types.h>
+
+/*
+  Shard_Runner - process a boot session as several time shards in
+  parallel, then stitch their output together.
+
+  The files of the boot session are split into `num_shards`
+  consecutive groups.  Each shard but the last is processed by a
+  forked copy of the Tag_Foray, which begins reading files `margin`
+  seconds before its first file, so that the candidates alive at the
+  shard boundary can be rebuilt (the "warm-up"); output generated
+  during warm-up is not kept.  The last shard is processed by this
+  process, so that the Tag_Foray is left in the same state as after a
+  serial run, ready for pause().
+
+  A shard also begins with the frequency setting each port had before
+  its first file, as found by scan_freq_settings(); these are usually
+  made only at the start of a boot session, long before warm-up.
+
+  Output from each shard goes to a Shard_Journal, and the journals
+  are replayed in order into the DB_Filer.  A run still open at the
+  end of one shard is continued by the run in the next shard whose
+  warm-up hits match its last hits; other runs begun in warm-up are
+  treated as new.  A carried run not continued by any run in the next
+  shard is ended there.
+*/
+
+class Shard_Runner {
+
+public:
+
+  Shard_Runner(Tag_Foray * foray, DB_Filer * dbf, int monoBN, unsigned int num_shards, Gap margin = 0); //!< margin = 0 means use Tag_Foray::shard_margin()
+
+  bool run(); //!< run all shards; returns false, without reading any input, if the boot session has too few files to be sharded
+
+protected:
+
+  Tag_Foray * foray;
+  DB_Filer * dbf;
+  int monoBN;
+  unsigned int num_shards;
+  Gap margin;
+
+  std::vector < Timestamp > files; //!< timestamps of files in the boot session
+
+  struct Shard {
+    unsigned int first;   //!< index of first file read, including warm-up
+    unsigned int owned;   //!< index of first file whose output belongs to this shard
+    unsigned int end;     //!< index of first file of next shard; files.size() for the last shard
+    Shard_Journal * journal;
+    pid_t pid;            //!< process ID of worker; 0 for the last shard
+    std::map < Port_Num, Frequency_MHz > freqs; //!< last frequency set on each port before file `first`
+  };
+
+  std::vector < Shard > shards;
+
+  // stitching state
+
+  struct Open_Run {
+    Motus_Tag_ID mid;
+    short ant;
+    int len;                        //!< hits recorded so far
+    Timestamp last_ts;              //!< timestamp of last hit
+    Timestamp ts_end;               //!< timestamp of last pulse in last hit, if known; else last_ts
+    std::deque < Timestamp > hits;  //!< timestamps of hits within `margin` of the last hit
+  };
+
+  typedef std::map < DB_Filer::Run_ID, Open_Run > Open_Runs;
+
+  Open_Runs carried; //!< real runs left open at the end of the previous shard
+
+  struct Local_Run {
+    Motus_Tag_ID mid;
+    short ant;
+    Timestamp ts_begin;
+    DB_Filer::Run_ID real;         //!< real run ID; 0 until resolved
+    int offset;                    //!< add to the shard's hit count to get the real run's length
+    int n;                         //!< hits seen in the shard, including warm-up
+    std::vector < Timestamp > warm; //!< timestamps of hits seen during warm-up
+  };
+
+  std::map < std::pair < Timestamp, short >, int > pulse_counts; //!< total pulses by (hour bin, antenna), over all shards
+
+  std::unordered_map < Motus_Tag_ID, Tag * > tags_by_id; //!< for bumping detection counts of tags detected by workers
+
+  void plan(); //!< divide files among shards
+
+  void scan_freq_settings(); //!< read the parameter lines of files before each shard, to fill in its freqs
+
+  void process(Shard & s, bool last); //!< process the shard's files in this process, with output to its journal; the last shard runs to the end of input
+
+  void replay(Shard & s, bool last); //!< replay a shard's journal into the DB_Filer; if last, remap run IDs held by candidates
+
+  Motus_Tag_ID real_mid(const Shard_Journal::Entry & e); //!< motusTagID for a BEGIN_RUN entry, mapping a worker's proxy ID to ours
+
+  bool adopt(Local_Run & lr, Open_Runs & open); //!< try continue a carried run with a local run, based on warm-up hits; true on success
+
+  void resolve(Local_Run & lr, Timestamp ts, Open_Runs & open); //!< find or begin the real run for a local run
+
+  void note_hit(Open_Run & o, Timestamp ts); //!< record a hit on an open real run
+};
+
+#endif // SHARD_RUNNER_HPP
@@ -103,6 +103,16 @@ Tag_Candidate::expired(Timestamp ts) {
   return rv;
 };
 
+bool
+Tag_Candidate::expires_by(Timestamp ts) {
+  return ! state || ! state->valid() || ts - last_ts > state->get_max_age();
+};
+
+Frequency_Offset_kHz
+Tag_Candidate::get_dfreq() {
+  return freq_range.get_centre();
+};
+
 Timestamp
 Tag_Candidate::min_next_pulse_ts() {
   return last_ts + state->get_min_age();
@@ -243,6 +253,11 @@ void Tag_Candidate::clear_pulses() {
 
 void
 Tag_Candidate::calculate_burst_params(Pulse_Iter & p) {
+  calculate_burst_params(p, tag, num_pulses, last_dumped_ts, hit_count);
+};
+
+void
+Tag_Candidate::calculate_burst_params(Pulse_Iter & p, Tag * tag, unsigned int n, Timestamp & last_dumped_ts, unsigned int hit_count) {
   // calculate these burst parameters:
   // - mean signal and noise strengths
   // - relative standard deviation (among pulses) of signal strength
@@ -261,8 +276,6 @@ Tag_Candidate::calculate_burst_params(Pulse_Iter & p) {
   float slop   	= 0.0;
   double pts		= 0.0;
 
-  unsigned int n = num_pulses;
-
   if (last_dumped_ts != BOGUS_TIMESTAMP) {
     Gap g = p->ts - last_dumped_ts;
     burst_par.burst_slop = fmodf(g, tag->period) - tag->gaps[n-1];
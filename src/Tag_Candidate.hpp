@@ -27,6 +27,7 @@ class Tag_Candidate {
      and looking for the first valid burst */
   friend class Tag_Foray;
   friend class Lotek_Data_Source; // to give access to the filer FIXME: kludge!
+  friend class Lotek_Run_Finder;  // likewise, and to parameters for reporting runs
 
 public:
 
@@ -68,6 +69,8 @@ protected:
 
   friend class Tag_Finder;
   friend class Ambiguity;
+  friend class Candidate_Archive;
+  friend class Shard_Runner; // to merge max_num_cands from time shards
 
   static long long num_cands;
 
@@ -93,6 +96,10 @@ public:
 
   bool expired(Timestamp ts); //!< has tag candidate expired, either due to a long time lag or a tag event which has deleted its state?
 
+  bool expires_by(Timestamp ts); //!< would expired(ts) return true?  Unlike expired(), this has no side-effects, so can be used from worker threads.
+
+  Frequency_Offset_kHz get_dfreq(); //!< centre of range of accepted frequency offsets
+
   Timestamp min_next_pulse_ts(); //!< return minimum timestamp of next pulse this candidate would accept
 
   Node * advance_by_pulse(const Pulse &p);
@@ -115,6 +122,8 @@ public:
 
   void calculate_burst_params(Pulse_Iter &p);
 
+  static void calculate_burst_params(Pulse_Iter &p, Tag * tag, unsigned int n, Timestamp & last_dumped_ts, unsigned int hit_count); //!< as above, for a burst of n pulses of tag
+
   void dump_bursts(short prefix);
 
   static void set_freq_slop_kHz(float slop);
@@ -136,22 +145,6 @@ public:
   static void set_max_unconfirmed_bursts(int m);
 
   void renTag(Tag * t1, Tag * t2); //!< if this candidate is for tag t1, make it finish any run and start a new one pointing at t2.
-
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int version) {
-    ar & BOOST_SERIALIZATION_NVP( owner );
-    ar & BOOST_SERIALIZATION_NVP( state );
-    ar & BOOST_SERIALIZATION_NVP( pulses );
-    ar & BOOST_SERIALIZATION_NVP( last_ts );
-    ar & BOOST_SERIALIZATION_NVP( last_dumped_ts );
-    ar & BOOST_SERIALIZATION_NVP( tag );
-    ar & BOOST_SERIALIZATION_NVP( tag_id_level );
-    ar & BOOST_SERIALIZATION_NVP( run_id );
-    ar & BOOST_SERIALIZATION_NVP( hit_count );
-    ar & BOOST_SERIALIZATION_NVP( num_pulses );
-    ar & BOOST_SERIALIZATION_NVP( freq_range );
-    ar & BOOST_SERIALIZATION_NVP( sig_range );
-  }
 };
 
 #endif // TAG_CANDIDATE_HPP
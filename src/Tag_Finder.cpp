@@ -47,6 +47,14 @@ Tag_Finder::process(Pulse &p) {
 
   bool confirmed_acceptance = false; // has pulse been accepted by a confirmed candidate?
 
+  // if there are many candidates, find in parallel those which have
+  // expired or can accept this pulse; `next_screened` tracks our
+  // position in the results, which are in the same order as the loop
+  // below visits candidates
+
+  bool use_screen = pool && screen(p);
+  auto next_screened = screened.begin();
+
 #ifdef DEBUG2
   std::cerr << std::setprecision(14);
   std::cerr << "Pulse " << p.ts << std::endl;
@@ -70,8 +78,22 @@ Tag_Finder::process(Pulse &p) {
 #ifdef DEBUG2
       dbg && std::cerr << "Examining " << (void * ) (ci->second) << " last_ts " << (ci->second->last_ts) << std::endl;
 #endif
-      // check whether candidate has expired
-      if (ci->second->expired(p.ts)) {
+      Screening * s = 0;
+      if (use_screen) {
+        // skip results for candidates already deleted; a candidate
+        // re-indexed within this list has no result the second time
+        auto j = next_screened;
+        while (j != screened.end() && j->tc != ci->second)
+          ++ j;
+        if (j != screened.end()) {
+          s = & * j;
+          next_screened = j + 1;
+        }
+      }
+
+      // check whether candidate has expired; if screened, expired()
+      // is only called for its side-effects
+      if ((! s || s->expired) && ci->second->expired(p.ts)) {
         auto tc = ci->second;
         cs.erase(ci);
 #ifdef DEBUG2
@@ -82,7 +104,7 @@ Tag_Finder::process(Pulse &p) {
       }
 
       // check whether candidate can accept this pulse
-      Node * next_state = (ci->second)->advance_by_pulse(p);
+      Node * next_state = s ? s->next_state : (ci->second)->advance_by_pulse(p);
 
       if (! next_state)
         continue;
@@ -148,6 +170,70 @@ Tag_Finder::process(Pulse &p) {
 };
 
 
+bool
+Tag_Finder::screen(const Pulse &p) {
+  // gather candidates the loop in process() might visit
+  screened.clear();
+  for (int i = 0; i < NUM_CAND_LISTS; ++i)
+    for (Cand_List::iterator ci = cands[i].begin(); ci != cands[i].end() && p.ts >= ci->first; ++ci)
+      screened.push_back(Screening{ci->second, false, 0});
+
+  if (screened.size() < min_screen_cands)
+    return false;
+
+  int n = pool->size();
+  if (band_width > 0) {
+    // thread k screens candidates whose frequency offset is in band k;
+    // offsets outside all bands go to the nearest one.
+    pool->run([&p, n](unsigned int k) {
+        for (auto s = screened.begin(); s != screened.end(); ++s) {
+          int band = floor((s->tc->get_dfreq() - band_lo) / band_width);
+          if (std::min(std::max(band, 0), n - 1) == (int) k)
+            screen_one(*s, p);
+        }
+      });
+  } else {
+    // thread k screens the k'th of n equal chunks; in a noise storm,
+    // candidates crowd into a few bands, so this balances better
+    size_t chunk = (screened.size() + n - 1) / n;
+    pool->run([&p, chunk](unsigned int k) {
+        auto end = screened.begin() + std::min(screened.size(), (k + 1) * chunk);
+        for (auto s = screened.begin() + std::min(screened.size(), k * chunk); s != end; ++s)
+          screen_one(*s, p);
+      });
+  }
+  return true;
+};
+
+void
+Tag_Finder::screen_one(Screening & s, const Pulse &p) {
+  s.expired = s.tc->expires_by(p.ts);
+  if (! s.expired)
+    s.next_state = s.tc->advance_by_pulse(p);
+};
+
+void
+Tag_Finder::set_dfreq_bands(unsigned int n, Frequency_Offset_kHz lo, Frequency_Offset_kHz hi, size_t min_cands) {
+  // funcubes sample at 48 kHz, so frequency offsets lie within +/- 24 kHz
+  if (! std::isfinite(lo))
+    lo = -24;
+  if (! std::isfinite(hi))
+    hi = 24;
+  delete pool;
+  pool = n > 1 ? new Worker_Pool(n) : 0;
+  band_lo = lo;
+  band_width = (hi - lo) / std::max(n, 1U);
+  min_screen_cands = min_cands;
+};
+
+void
+Tag_Finder::set_screen_threads(unsigned int n, size_t min_cands) {
+  delete pool;
+  pool = n > 1 ? new Worker_Pool(n) : 0;
+  band_width = 0;
+  min_screen_cands = min_cands;
+};
+
 Tag_Finder::~Tag_Finder() {
   // dump any confirmed candidates which have bursts
   // delete them even if not
@@ -288,3 +374,9 @@ Tag_Finder::dump(Timestamp latest) {
     }
   }
 }
+
+std::vector < Tag_Finder::Screening > Tag_Finder::screened;
+Worker_Pool * Tag_Finder::pool = 0;
+Frequency_Offset_kHz Tag_Finder::band_lo = -24;
+Frequency_Offset_kHz Tag_Finder::band_width = 48;
+size_t Tag_Finder::min_screen_cands = 1000;
@@ -9,6 +9,7 @@
 #include "Event.hpp"
 #include "History.hpp"
 #include "Ticker.hpp"
+#include "Worker_Pool.hpp"
 #include <boost/serialization/list.hpp>
 
 class Tag_Foray;
@@ -95,17 +96,47 @@ public:
 
   void delete_competitors(Cand_List::iterator ci, Cand_List::iterator &nextci); //!< delete any candidates for the same tag or sharing any pulses with * ci
 
+  static void set_dfreq_bands(unsigned int n, Frequency_Offset_kHz lo, Frequency_Offset_kHz hi, size_t min_cands = 1000); //!< screen candidates in n threads, each handling
+  // candidates whose frequency offset lies in one of n equal bands spanning [lo, hi], whenever a pulse must be checked against at least min_cands candidates
+
+  static void set_screen_threads(unsigned int n, size_t min_cands); //!< screen candidates in n threads, each handling an equal
+  // share of them, whenever a pulse must be checked against at least min_cands candidates; overrides set_dfreq_bands()
+
+protected:
+
+  // Screening: when a Tag_Finder has many candidates, the read-only
+  // part of process() - checking each candidate for expiry, and
+  // whether it can accept the pulse - is done in parallel before the
+  // candidates are updated, serially and in the usual order.
+
+  struct Screening {
+    Tag_Candidate * tc;   //!< candidate
+    bool expired;         //!< tc->expires_by(p.ts)
+    Node * next_state;    //!< tc->advance_by_pulse(p), if not expired
+  };
+
+  static std::vector < Screening > screened; //!< results of screening, in the order process() visits candidates
+
+  static Worker_Pool * pool;             //!< threads for screening; 0 if screening is not used
+  static Frequency_Offset_kHz band_lo;   //!< low end of lowest frequency offset band
+  static Frequency_Offset_kHz band_width; //!< width of each band; 0 means split candidates into equal chunks instead of bands
+  static size_t min_screen_cands;        //!< only screen in parallel when a pulse must be checked against at least this many candidates
+
+  bool screen(const Pulse &p); //!< screen candidates for pulse p, if worthwhile; returns true if screened is valid
+
+  static void screen_one(Screening & s, const Pulse &p); //!< screen one candidate; called from worker threads
+
 public:
 
-  // public serialize function.
+  // public serialize function.  The graph is not serialized; on
+  // resume, Tag_Foray rebuilds it and points graph at it.  Nor are
+  // the candidates; Tag_Foray saves them with a Candidate_Archive.
 
   template<class Archive>
   void serialize(Archive & ar, const unsigned int version)
   {
     ar & BOOST_SERIALIZATION_NVP( owner );
     ar & BOOST_SERIALIZATION_NVP( last_reap );
-    ar & BOOST_SERIALIZATION_NVP( graph );
-    ar & BOOST_SERIALIZATION_NVP( cands );
     ar & BOOST_SERIALIZATION_NVP( prefix );
 
     sscanf(prefix.c_str(), "%hd", &ant);
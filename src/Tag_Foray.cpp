@@ -1,5 +1,7 @@
 #include "Tag_Foray.hpp"
 #include "SG_Record.hpp"
+#include "Zlib_Streambuf.hpp"
+#include "Candidate_Archive.hpp"
 
 #include <string.h>
 #include <sstream>
@@ -7,14 +9,22 @@
 #include <cmath>
 
 Tag_Foray::Tag_Foray () :  // default ctor for deserializing into
+  lotek_direct(false),
+  lotek_runs(0),
   line_no(0),   // line numbers reset even when resuming
   pulse_count(MAX_PORT_NUM + 1 + NUM_SPECIAL_PORTS),
+  dispatch(MAX_PORT_NUM + 1 + NUM_SPECIAL_PORTS),
   hist(0),      // we recreate history on resume
   tsBegin(0),
-  prevHourBin(0)
+  prevHourBin(0),
+  num_files(0),
+  warmup_files(0),
+  stop_file(0),
+  journal(0),
+  owned(true)
 {};
 
-Tag_Foray::Tag_Foray (Tag_Database * tags, Data_Source *data, Frequency_MHz default_freq, bool force_default_freq, float min_dfreq, float max_dfreq, float max_pulse_rate, Gap pulse_rate_window, Gap min_bogus_spacing, bool unsigned_dfreq, bool pulses_only) :
+Tag_Foray::Tag_Foray (Tag_Database * tags, Data_Source *data, Frequency_MHz default_freq, bool force_default_freq, float min_dfreq, float max_dfreq, float max_pulse_rate, Gap pulse_rate_window, Gap min_bogus_spacing, bool unsigned_dfreq, bool pulses_only, bool lotek_direct) :
   tags(tags),
   data(data),
   default_freq(default_freq),
@@ -26,8 +36,11 @@ Tag_Foray::Tag_Foray (Tag_Database * tags, Data_Source *data, Frequency_MHz defa
   min_bogus_spacing(min_bogus_spacing),
   unsigned_dfreq(unsigned_dfreq),
   pulses_only(pulses_only),
+  lotek_direct(lotek_direct),
+  lotek_runs(0),
   line_no(0),
   pulse_count(MAX_PORT_NUM + 1 + NUM_SPECIAL_PORTS),
+  dispatch(MAX_PORT_NUM + 1 + NUM_SPECIAL_PORTS),
   ts(0),
   pulse_slop(default_pulse_slop),
   burst_slop(default_burst_slop),
@@ -36,7 +49,12 @@ Tag_Foray::Tag_Foray (Tag_Database * tags, Data_Source *data, Frequency_MHz defa
   hist(tags->get_history()),
   cron(hist->getTicker()),
   tsBegin(0),
-  prevHourBin(0)
+  prevHourBin(0),
+  num_files(0),
+  warmup_files(0),
+  stop_file(0),
+  journal(0),
+  owned(true)
 {
   // create one empty graph for each nominal frequency
   auto fs = tags->get_nominal_freqs();
@@ -52,6 +70,7 @@ Tag_Foray::Tag_Foray (Tag_Database * tags, Data_Source *data, Frequency_MHz defa
 Tag_Foray::~Tag_Foray () {
   for (auto tfi = tag_finders.begin(); tfi != tag_finders.end(); ++tfi)
     delete (tfi->second);
+  delete lotek_runs;
 };
 
 void
@@ -81,13 +100,22 @@ Tag_Foray::set_timestamp_wonkiness(unsigned int w) {
 
 void
 Tag_Foray::start() {
+  SG_Record r;
+  if (setup(r))
+    run(r);
+};
+
+bool
+Tag_Foray::setup(SG_Record & r) {
   Tag_Candidate::ending_batch = false;
 
   cr = new Clock_Repair(data, &line_no, Tag_Candidate::filer);
-  SG_Record r;
+
+  if (lotek_direct && ! lotek_runs)
+    lotek_runs = new Lotek_Run_Finder(tags, pulse_slop, burst_slop / 4.0, (1 + max_skipped_bursts) * 4.0);
 
   if (! cr->get(r))
-    return;  // no records, so nothing to do
+    return false;  // no records, so nothing to do
 
   // the record returned by cr has a valid timestamp (the whole point of Clock_Repair)
   // so we can prune events corresponding to a tag having been activated and then died
@@ -96,9 +124,27 @@ Tag_Foray::start() {
 
   // get the event iterator
   cron = hist->getTicker();
+  return true;
+};
 
+void
+Tag_Foray::run(SG_Record & r) {
   bool have_record = true;
   for( ; have_record; have_record = cr->get(r)) {
+    if (r.type == SG_Record::FILE) {
+      // time shards begin owning their output, and end, at file boundaries
+      ++ num_files;
+      if (num_files == stop_file) {
+        record_open_runs();
+        break;
+      }
+      if (num_files == warmup_files + 1 && ! owned) {
+        owned = true;
+        if (journal)
+          journal->set_owned(true);
+      }
+    }
+
     // get begin time, allowing for small time reversals (10 seconds)
     if (! tsBegin || (r.ts < tsBegin && r.ts >= tsBegin - 10.0)) {
       tsBegin = r.ts;
@@ -121,21 +167,26 @@ Tag_Foray::start() {
     case SG_Record::GPS:
       // GPS is not stuck, or Clock_Repair would have dropped the record
       // but only add it if r.v.lat and r.v.lon are actual numbers; r.v.alt might not be reported
-      if (! (isnan(r.v.lat) || isnan(r.v.lon)))
+      if (owned && ! (isnan(r.v.lat) || isnan(r.v.lon)))
         Tag_Candidate::filer->add_GPS_fix( r.ts, r.v.lat, r.v.lon, r.v.alt );
       break;
 
     case SG_Record::PARAM:
 
-      Tag_Candidate::filer->add_recv_param( r.ts, r.port, r.v.param_flag, r.v.param_value, r.v.return_code, r.v.error);
+      if (owned)
+        Tag_Candidate::filer->add_recv_param( r.ts, r.port, r.v.param_flag, r.v.param_value, r.v.return_code, r.v.error);
 
       if (strcmp("-m", r.v.param_flag) || r.v.return_code || isnan(r.v.param_value)) {
         // ignore non-frequency parameter setting, or failed frequency setting
         continue;
       }
 
-      if (! force_default_freq)
+      if (! force_default_freq) {
         port_freq[r.port] = Freq_Setting(r.v.param_value);
+        // the port's Tag_Finder depends on its frequency
+        if (r.port >= - NUM_SPECIAL_PORTS && r.port <= MAX_PORT_NUM)
+          dispatch[r.port + NUM_SPECIAL_PORTS].tf = 0;
+      }
       continue;
       break;
 
@@ -143,61 +194,34 @@ Tag_Foray::start() {
       {
         // bump up the pulse count for the current hour bin
 
-        double hourBin = round(r.ts / 3600);
-        if (hourBin != prevHourBin) {
-          if (prevHourBin > 0) {
-            for (int i = 0; i < pulse_count.size(); ++i) {
-              if (pulse_count[i] > 0) {
-                Tag_Candidate::filer->add_pulse_count(prevHourBin, i - NUM_SPECIAL_PORTS, pulse_count[i]);
-                pulse_count[i] = 0;
-              }
-            }
-          }
-          prevHourBin = hourBin;
-        }
+        count_pulses(r.ts, r.port, 1);
 
-        if (r.port >= - NUM_SPECIAL_PORTS && r.port <= MAX_PORT_NUM)
-          ++pulse_count[r.port + NUM_SPECIAL_PORTS];
-
-        // skip this record if its offset frequency is out of bounds
-        if (r.v.dfreq > max_dfreq || r.v.dfreq < min_dfreq)
+        // skip this record if its offset frequency is out of bounds,
+        // or if it only marks activity by an unknown Lotek tag
+        if (r.v.dfreq > max_dfreq || r.v.dfreq < min_dfreq || lotek_runs)
           continue;
 
-        Tag_Finder_Key key;
+        // look up the port's frequency setting and Tag_Finder in the
+        // dispatch table; ports outside its range use a temporary entry
 
-        if (! pulses_only) {
-          // NB: cast r.port to work around optimization of passing reference
-          // to packed struct
+        Port_Dispatch other = {0, 0};
+        Port_Dispatch & d = (r.port >= - NUM_SPECIAL_PORTS && r.port <= MAX_PORT_NUM) ? dispatch[r.port + NUM_SPECIAL_PORTS] : other;
 
-          // which tag finder should this pulse be passed to?  There is at
-          // least a tag finder on each port, and possibly more than one if
-          // the listening frequency is changing.
+        if (! d.fs)
+          d.fs = & port_freq[r.port];
 
-          key = Tag_Finder_Key((short int) r.port, port_freq[r.port].f_kHz);
+        // which tag finder should this pulse be passed to?  There is at
+        // least a tag finder on each port, and possibly more than one if
+        // the listening frequency is changing.
 
-          // if there isn't already an appropriate Tag_Finder, create it
-          if (! tag_finders.count(key)) {
-            Tag_Finder *newtf;
-            std::ostringstream prefix;
-            prefix << r.port << ",";
-            if (max_pulse_rate > 0)
-              newtf = new Rate_Limiting_Tag_Finder(this, key.second, tags->get_tags_at_freq(key.second), graphs[key.second], pulse_rate_window, max_pulse_rate, min_bogus_spacing, prefix.str());
-            else
-              newtf = new Tag_Finder(this, key.second, tags->get_tags_at_freq(key.second), graphs[key.second], prefix.str());
-            tag_finders[key] = newtf;
-#ifdef DEBUG3
-            std::cerr << "Interval Tree for " << prefix.str() << std::endl;
-            newtf->graph.get_root()->dump(std::cerr);
-            std::cerr << "Burst slop expansion is " << Tag_Finder::default_burst_slop_expansion << std::endl;
-#endif
-          };
-        }
+        if (! pulses_only && ! d.tf)
+          d.tf = get_tag_finder(r.port, d.fs->f_kHz);
 
         if (r.v.dfreq < 0 && unsigned_dfreq)
           r.v.dfreq = - r.v.dfreq;
 
         // create a pulse object from this record
-        Pulse p = Pulse::make(r.ts, r.v.dfreq, r.v.sig, r.v.noise, port_freq[r.port].f_MHz);
+        Pulse p = Pulse::make(r.ts, r.v.dfreq, r.v.sig, r.v.noise, d.fs->f_MHz);
 
         // process any tag events up to this point in time
 
@@ -217,15 +241,42 @@ Tag_Foray::start() {
           Tag_Candidate::filer->add_pulse(r.port, p);
         } else {
 #ifdef DEBUG2
-          std::cerr << p.ts << ": Key: " << r.port << ", " << port_freq[r.port].f_kHz << std::endl;
+          std::cerr << p.ts << ": Key: " << r.port << ", " << d.fs->f_kHz << std::endl;
 #endif
-          tag_finders[key]->process(p);
+          d.tf->process(p);
 #ifdef DEBUG3
-          tag_finders[key]->dump(r.ts);
+          d.tf->dump(r.ts);
 #endif
         }
       }
       break;
+    case SG_Record::DETECTION:
+      {
+        if (! lotek_runs)
+          break;
+
+        // pulses are counted, and skipped if their offset frequency is
+        // out of bounds, as for the PULSE records they stand for
+
+        count_pulses(r.ts, r.port, lotek_runs->num_pulses(r));
+
+        if (r.v.dfreq > max_dfreq || r.v.dfreq < min_dfreq)
+          continue;
+
+        // the port's frequency setting is looked up as for a pulse
+
+        Port_Dispatch other = {0, 0};
+        Port_Dispatch & d = (r.port >= - NUM_SPECIAL_PORTS && r.port <= MAX_PORT_NUM) ? dispatch[r.port + NUM_SPECIAL_PORTS] : other;
+
+        if (! d.fs)
+          d.fs = & port_freq[r.port];
+
+        while (cron.ts() <= r.ts)
+          process_event(cron.get());
+
+        lotek_runs->process(r, d.fs->f_kHz);
+      }
+      break;
     case SG_Record::EXTENSION:
       {
         // for future extension: in-band commands
@@ -242,8 +293,32 @@ Tag_Foray::start() {
       Tag_Candidate::filer->add_pulse_count(prevHourBin, i - NUM_SPECIAL_PORTS, pulse_count[i]);
 };
 
+void
+Tag_Foray::count_pulses(Timestamp ts, Port_Num port, int n) {
+  double hourBin = round(ts / 3600);
+  if (hourBin != prevHourBin) {
+    if (prevHourBin > 0) {
+      for (int i = 0; i < pulse_count.size(); ++i) {
+        if (pulse_count[i] > 0) {
+          Tag_Candidate::filer->add_pulse_count(prevHourBin, i - NUM_SPECIAL_PORTS, pulse_count[i]);
+          pulse_count[i] = 0;
+        }
+      }
+    }
+    prevHourBin = hourBin;
+  }
+
+  if (owned && port >= - NUM_SPECIAL_PORTS && port <= MAX_PORT_NUM)
+    pulse_count[port + NUM_SPECIAL_PORTS] += n;
+};
+
 void
 Tag_Foray::process_event(Event e) {
+  if (lotek_runs) {
+    // no graphs are needed
+    lotek_runs->process_event(e);
+    return;
+  }
   auto t = e.tag;
   auto fs = Freq_Setting::as_Nominal_Frequency_kHz(t->freq);
   Graph * g = graphs[fs];
@@ -263,9 +338,9 @@ Tag_Foray::process_event(Event e) {
       // later (the assert in Graph::find() fails)
       rv.second && (rv.second->active = true);
 
-      for (auto i = tag_finders.begin(); i != tag_finders.end(); ++i)
-        if (i->first.second == fs)
-          i->second->tag_added(rv);
+      auto & tfs = finders_at_freq[fs];
+      for (auto i = tfs.begin(); i != tfs.end(); ++i)
+        (*i)->tag_added(rv);
       t->active = true;
 #ifdef DEBUG2
       std::cerr << "Activating " << t->motusID << "=" << (void *) t << std::endl;
@@ -286,9 +361,9 @@ Tag_Foray::process_event(Event e) {
       rv.first && (rv.first->active = false);
       rv.second && (rv.second->active = true);
 
-      for (auto i = tag_finders.begin(); i != tag_finders.end(); ++i)
-        if (i->first.second == fs)
-          i->second->tag_removed(rv);
+      auto & tfs = finders_at_freq[fs];
+      for (auto i = tfs.begin(); i != tfs.end(); ++i)
+        (*i)->tag_removed(rv);
       t->active = false;
 #ifdef DEBUG2
       std::cerr << "Deactivating " << t->motusID << "=" << (void *) t << std::endl;
@@ -300,6 +375,42 @@ Tag_Foray::process_event(Event e) {
   };
 }
 
+Tag_Finder *
+Tag_Foray::get_tag_finder(Port_Num port, Nominal_Frequency_kHz f) {
+  Tag_Finder_Key key(port, f);
+  auto i = tag_finders.find(key);
+  if (i != tag_finders.end())
+    return i->second;
+
+  // there isn't already an appropriate Tag_Finder, so create it
+  Tag_Finder *newtf;
+  std::ostringstream prefix;
+  prefix << port << ",";
+  if (max_pulse_rate > 0)
+    newtf = new Rate_Limiting_Tag_Finder(this, key.second, tags->get_tags_at_freq(key.second), graphs[key.second], pulse_rate_window, max_pulse_rate, min_bogus_spacing, prefix.str());
+  else
+    newtf = new Tag_Finder(this, key.second, tags->get_tags_at_freq(key.second), graphs[key.second], prefix.str());
+  tag_finders[key] = newtf;
+  index_tag_finder(key, newtf);
+#ifdef DEBUG3
+  std::cerr << "Interval Tree for " << prefix.str() << std::endl;
+  newtf->graph.get_root()->dump(std::cerr);
+  std::cerr << "Burst slop expansion is " << Tag_Finder::default_burst_slop_expansion << std::endl;
+#endif
+  return newtf;
+};
+
+void
+Tag_Foray::index_tag_finder(Tag_Finder_Key key, Tag_Finder * tf) {
+  // keep finders at each frequency in port order, which is the order
+  // process_event() used when it searched all of tag_finders
+  auto & tfs = finders_at_freq[key.second];
+  auto i = tfs.begin();
+  while (i != tfs.end() && (*i)->ant < key.first)
+    ++i;
+  tfs.insert(i, tf);
+};
+
 void
 Tag_Foray::test() {
   // try build tag finders for each nominal frequency
@@ -355,7 +466,7 @@ double Tag_Foray::next_active_tag_dump_time = 0; // real (data) time of next act
 #endif // ACTIVE_TAG_DIAGNOSTICS
 
 void
-Tag_Foray::pause() {
+Tag_Foray::pause(bool resumable) {
   // serialize and save state of the tag finder
   // this is the top-level of the serializer,
   // so we dump class static members from here.
@@ -365,6 +476,8 @@ Tag_Foray::pause() {
   // pulses have been received for an antenna in a long time)
   for (auto tfi = tag_finders.begin(); tfi != tag_finders.end(); ++tfi)
     tfi->second->reap(ts);
+  if (lotek_runs)
+    lotek_runs->reap(ts);
 
   // Now when destructors are called for remaining (non-expired)
   // tag candidates, we do *not* want to actually end the run,
@@ -372,12 +485,26 @@ Tag_Foray::pause() {
   // this.
 
   Tag_Candidate::ending_batch = true;
-  std::ostringstream ofs;
+
+  if (! resumable) {
+    Tag_Candidate::filer->end_batch(tsBegin, ts);
+    Tag_Candidate::filer->save_findtags_state(ts, time_now(), std::string(), SERIALIZATION_VERSION);
+    return;
+  }
+
+  // the state is compressed as it is serialized, so that only the
+  // compressed state is ever held in memory
+  std::string state;
+  Deflate_Streambuf ofs(state);
 
   Tag_Candidate::filer->end_batch(tsBegin, ts);
 
   Ambiguity::record_ids();
 
+  // Tag_Candidates are written within the archive, as flat records;
+  // only the tags they refer to go in the archive, after them
+  Candidate_Archive cands(tag_finders);
+
   {
     // block to ensure oa dtor is called
     boost::archive::binary_oarchive oa(ofs);
@@ -400,17 +527,6 @@ Tag_Foray::pause() {
     // Pulse
     oa << make_nvp("count", Pulse::count);
 
-    // Node
-    oa << make_nvp("_numNodes", Node::_numNodes);
-    oa << make_nvp("_numLinks", Node::_numLinks);
-    oa << make_nvp("maxLabel", Node::maxLabel);
-    oa << make_nvp("_empty", Node::_empty);
-
-    // Set
-    oa << make_nvp("_numSets", Set::_numSets);
-    oa << make_nvp("maxLabel", Set::maxLabel);
-    oa << make_nvp("_empty", Set::_empty);
-
     // Tag_Candidate
     oa << make_nvp("freq_slop_kHz", Tag_Candidate::freq_slop_kHz);
     oa << make_nvp("sig_slop_dB", Tag_Candidate::sig_slop_dB);
@@ -418,18 +534,26 @@ Tag_Foray::pause() {
     oa << make_nvp("num_cands", Tag_Candidate::num_cands);
 
     // dynamic members of all classes
+    for (auto i = graphs.begin(); i != graphs.end(); ++i)
+      graph_tags[i->first] = i->second->getTags();
     serialize(oa, SERIALIZATION_VERSION);
+    graph_tags.clear();
 
     // data source
     data->serialize(oa, SERIALIZATION_VERSION);
 
+    // the binary archive writes straight to ofs, so the candidates can
+    // go between its items
+    cands.write(ofs);
+    oa << make_nvp("cand_tags", cands.tags);
   }
+  ofs.finish();
   // record this state
 
   Tag_Candidate::filer->
     save_findtags_state( ts,                   // last timestamp parsed from input
                          time_now(),           // time now
-                         ofs.str(),            // serialized state
+                         state,                // serialized, compressed state
                          SERIALIZATION_VERSION // version
                          );
 
@@ -447,13 +571,17 @@ Tag_Foray::resume(Tag_Foray &tf, Data_Source *data, long long bootnum) {
       load_findtags_state( bootnum,
                            paused,
                            lastLineTS,
-                           blob,                      // serialized state
+                           blob,                      // serialized, compressed state
                            SERIALIZATION_VERSION,
                            ser_ver
                            ))
     return false;
 
-  std::istringstream ifs (blob);
+  if (blob.empty())
+    throw std::runtime_error("The saved state for this boot session can't be resumed; it was saved by a --sweep configuration, or with --csv_output, --columnar_output or --binary_output");
+
+  // decompress the state as it is deserialized
+  Inflate_Streambuf ifs(blob.data(), blob.size());
   boost::archive::binary_iarchive ia(ifs);
 
   // Ambiguity (serialized structures)
@@ -474,17 +602,6 @@ Tag_Foray::resume(Tag_Foray &tf, Data_Source *data, long long bootnum) {
   // Pulse
   ia >> make_nvp("count", Pulse::count);
 
-  // Node
-  ia >> make_nvp("_numNodes", Node::_numNodes);
-  ia >> make_nvp("_numLinks", Node::_numLinks);
-  ia >> make_nvp("maxLabel", Node::maxLabel);
-  ia >> make_nvp("_empty", Node::_empty);
-
-  // Set
-  ia >> make_nvp("_numSets", Set::_numSets);
-  ia >> make_nvp("maxLabel", Set::maxLabel);
-  ia >> make_nvp("_empty", Set::_empty);
-
   // Tag_Candidate
   ia >> make_nvp("freq_slop_kHz", Tag_Candidate::freq_slop_kHz);
   ia >> make_nvp("sig_slop_dB", Tag_Candidate::sig_slop_dB);
@@ -494,15 +611,91 @@ Tag_Foray::resume(Tag_Foray &tf, Data_Source *data, long long bootnum) {
   // dynamic members of all classes
   tf.serialize(ia, ser_ver);
 
+  // neither are the graphs, nor the frequency index
+  tf.rebuild_graphs();
+  for (auto i = tf.tag_finders.begin(); i != tf.tag_finders.end(); ++i)
+    tf.index_tag_finder(i->first, i->second);
+
   // data source deserialization happens into the
   // new data source
   tf.data = data;
 
   data->serialize(ia, ser_ver);
 
+  // the candidates follow, then the tags they refer to
+  Candidate_Archive cands(tf.tag_finders);
+  cands.read(ifs);
+  ia >> make_nvp("cand_tags", cands.tags);
+  cands.restore();
+
   return true;
 };
 
+void
+Tag_Foray::rebuild_graphs() {
+  for (auto i = graph_tags.begin(); i != graph_tags.end(); ++i) {
+    Graph * g = new Graph();
+    for (auto t = i->second.begin(); t != i->second.end(); ++t)
+      g->restoreTag(*t, pulse_slop, burst_slop / 4.0, (1 + max_skipped_bursts) * 4.0, timestamp_wonkiness);
+    graphs[i->first] = g;
+  }
+  graph_tags.clear();
+  for (auto tfi = tag_finders.begin(); tfi != tag_finders.end(); ++tfi)
+    tfi->second->graph = graphs[tfi->first.second];
+};
+
+Gap
+Tag_Foray::shard_margin() {
+  // A candidate waits at most max_gap between consecutive pulses
+  // (the back edges added by process_event() stop at (1 +
+  // max_skipped_bursts) * 4 seconds, but there is always at least one
+  // per tag period).  Allow enough such gaps to accumulate the pulses
+  // needed to confirm a tag, plus two more bursts for ambiguous
+  // candidates.
+
+  Gap max_gap = (1 + max_skipped_bursts) * 4.0;
+  auto fs = tags->get_nominal_freqs();
+  for (auto f = fs.begin(); f != fs.end(); ++f) {
+    TagSet * ts = tags->get_tags_at_freq(*f);
+    for (auto t = ts->begin(); t != ts->end(); ++t)
+      max_gap = std::max(max_gap, (*t)->period);
+  }
+  return (max_gap + pulse_slop) * (Tag_Candidate::pulses_to_confirm_id + 2 * PULSES_PER_BURST);
+};
+
+void
+Tag_Foray::record_open_runs() {
+  // a run whose candidate is still alive is "ended" with countOnly = true,
+  // as at the end of a batch, but the candidate is left alone
+  for (auto tfi = tag_finders.begin(); tfi != tag_finders.end(); ++tfi)
+    for (auto cl = tfi->second->cands.begin(); cl != tfi->second->cands.end(); ++cl)
+      for (auto ci = cl->begin(); ci != cl->end(); ++ci)
+        if (ci->second->run_id)
+          Tag_Candidate::filer->end_run(ci->second->run_id, ci->second->hit_count, ci->second->last_dumped_ts, true);
+};
+
+void
+Tag_Foray::remap_run_ids(const std::map < DB_Filer::Run_ID, std::pair < DB_Filer::Run_ID, int > > & m) {
+  for (auto tfi = tag_finders.begin(); tfi != tag_finders.end(); ++tfi) {
+    for (auto cl = tfi->second->cands.begin(); cl != tfi->second->cands.end(); ++cl) {
+      for (auto ci = cl->begin(); ci != cl->end(); ++ci) {
+        Tag_Candidate * tc = ci->second;
+        auto i = m.find(tc->run_id);
+        if (tc->run_id == 0 || i == m.end())
+          continue;
+        tc->run_id = i->second.first;
+        tc->hit_count += i->second.second;
+      }
+    }
+  }
+  Run_Cand_Counter remapped;
+  for (auto i = num_cands_with_run_id_.begin(); i != num_cands_with_run_id_.end(); ++i) {
+    auto j = m.find(i->first);
+    remapped[j == m.end() ? i->first : j->second.first] += i->second;
+  }
+  num_cands_with_run_id_.swap(remapped);
+};
+
 int
 Tag_Foray::num_cands_with_run_id (DB_Filer::Run_ID rid, int delta) {
   if (rid == 0)
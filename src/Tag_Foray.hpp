@@ -10,6 +10,8 @@
 #include "Data_Source.hpp"
 #include "DB_Filer.hpp"
 #include "Clock_Repair.hpp"
+#include "Shard_Journal.hpp"
+#include "Lotek_Run_Finder.hpp"
 
 #include <sqlite3.h>
 #include <boost/serialization/deque.hpp>
@@ -35,11 +37,13 @@ using boost::serialization::make_nvp;
 
 class Tag_Foray {
 
+  friend class Shard_Runner;
+
 public:
 
   Tag_Foray (); //!< default ctor to give object into which resume() deserializes
   ~Tag_Foray (); //!< dtor which deletes Tag_Finders and their confirmed candidates, so runs are correctly ended
-  Tag_Foray (Tag_Database * tags, Data_Source * data, Frequency_MHz default_freq, bool force_default_freq, float min_dfreq, float max_dfreq,  float max_pulse_rate, Gap pulse_rate_window, Gap min_bogus_spacing, bool unsigned_dfreq=false, bool pulses_only=false);
+  Tag_Foray (Tag_Database * tags, Data_Source * data, Frequency_MHz default_freq, bool force_default_freq, float min_dfreq, float max_dfreq,  float max_pulse_rate, Gap pulse_rate_window, Gap min_bogus_spacing, bool unsigned_dfreq=false, bool pulses_only=false, bool lotek_direct=false);
 
   void start();                 // begin searching for tags
 
@@ -48,7 +52,8 @@ public:
   void test();                       // throws an exception if there are indistinguishable tags
   void graph();                      // graph the DFA for each nominal frequency
 
-  void pause(); //!< serialize foray to output database
+  void pause(bool resumable = true); //!< serialize foray to output database; if not resumable, only end the batch, and
+  // save an empty state, so that a later --resume fails rather than continuing from the wrong place
 
   static bool resume(Tag_Foray &tf, Data_Source *data, long long bootnum); //!< resume foray from state saved in output database
   // returns true if successful
@@ -67,6 +72,11 @@ public:
   // if delta is 0. Otherwise, adjust the count by delta, and return the new count.
 
 
+  Gap shard_margin(); //!< minimum overlap between consecutive time shards, so a shard can rebuild the candidates alive at its start
+
+  void remap_run_ids(const std::map < DB_Filer::Run_ID, std::pair < DB_Filer::Run_ID, int > > & m); //!< replace run IDs local to a time shard with real ones,
+  // adding the given offset to the hit counts of candidates
+
   Tag_Database * tags;               // registered tags on all known nominal frequencies
 
   Timestamp last_seen() {return ts;}; // return last timestamp seen on input
@@ -98,8 +108,13 @@ public:
   //  The serialization version will be (major << 16) | minor
 
   // VERSION 2.0: gzip-compressed
+  // VERSION 2.1: Lotek_Data_Source buffers SG_Records rather than lines
+  // VERSION 3.0: compressed by Tag_Foray while serializing (zlib stream), rather than by gzcompress() in SQL
+  // VERSION 4.0: graphs rebuilt from the tags in them, rather than serialized
+  // VERSION 5.0: Tag_Candidates saved as flat records by Candidate_Archive, after the archive
+  // VERSION 6.0: Candidate_Archive written in one pass, within the archive, before the tags it refers to
 
-  static constexpr int SERIALIZATION_MAJOR_VERSION = 2;
+  static constexpr int SERIALIZATION_MAJOR_VERSION = 6;
   static constexpr int SERIALIZATION_MINOR_VERSION = 0;
   static constexpr int SERIALIZATION_VERSION = (SERIALIZATION_MAJOR_VERSION << 16) | SERIALIZATION_MINOR_VERSION;
 
@@ -124,6 +139,10 @@ protected:
 
   bool pulses_only;                  // if true, only output pulses, don't run Tag_Finders
 
+  bool lotek_direct;                 // if true, input has DETECTION records, from which a Lotek_Run_Finder builds runs, rather than
+                                     // Tag_Finders; created by setup(), so not serialized
+  Lotek_Run_Finder * lotek_runs;
+
   // runtime storage
 
   unsigned long long line_no;                    // count lines of input seen
@@ -140,10 +159,36 @@ protected:
 
   Tag_Finder_Map tag_finders;
 
+  // Per-port dispatch table, so that a pulse finds its port's
+  // frequency setting and Tag_Finder without map lookups.  Entries
+  // point into port_freq and tag_finders; they are filled in as pulses
+  // arrive, so they are not serialized, and must only be filled in
+  // after any copy of the Tag_Foray has been made.
+
+  struct Port_Dispatch {
+    Freq_Setting * fs;  // the port's entry in port_freq; 0 if not yet looked up
+    Tag_Finder * tf;    // Tag_Finder for the port at that frequency; 0 if not yet looked up
+  };
+
+  std::vector < Port_Dispatch > dispatch; // indexed by port + NUM_SPECIAL_PORTS
+
+  std::map < Nominal_Frequency_kHz, std::vector < Tag_Finder * > > finders_at_freq; // Tag_Finders on each nominal frequency, in port order
+
+  Tag_Finder * get_tag_finder(Port_Num port, Nominal_Frequency_kHz f); // return the Tag_Finder for a port and frequency, creating it if necessary
+
+  void index_tag_finder(Tag_Finder_Key key, Tag_Finder * tf); // add a Tag_Finder to finders_at_freq
+
   double ts; // for retaining last timestamp
 
   std::map < Nominal_Frequency_kHz, Graph * > graphs;
 
+  // Graphs are not serialized, since each is determined by the tags
+  // in it and the slop parameters.  pause() records the tags in each
+  // graph here, and resume() rebuilds the graphs from them.
+  std::map < Nominal_Frequency_kHz, std::vector < Tag * > > graph_tags;
+
+  void rebuild_graphs(); // rebuild graphs from graph_tags, and point Tag_Finders to them
+
   Gap pulse_slop;	// (seconds) allowed slop in timing between
 			// burst pulses,
   // in seconds for each pair of
@@ -176,6 +221,20 @@ protected:
   double tsBegin; // first timestamp parsed from input file
   double prevHourBin; // previous hourly bin, for counting pulses
 
+  // time-shard bookkeeping (see Shard_Runner); not serialized
+
+  unsigned int num_files;     // number of input files begun so far
+  unsigned int warmup_files;  // number of input files processed before this foray owns its output
+  unsigned int stop_file;     // if non-zero, stop when this (1-based) input file begins
+  Shard_Journal * journal;    // if non-zero, journal to notify when warm-up ends
+  bool owned;                 // false while warming up a time shard; GPS fixes, receiver parameters
+                              // and pulse counts are only recorded when true
+
+  bool setup(SG_Record & r);  // prepare to search, returning the first record in r; false if there are no records
+  void run(SG_Record & r);    // process records, beginning with r, until input ends or stop_file begins
+  void record_open_runs();    // record the state of runs still open when a time shard stops
+  void count_pulses(Timestamp ts, Port_Num port, int n); // add n pulses at time ts on port to the hourly counts
+
   static Gap default_pulse_slop;
   static Gap default_burst_slop;
   static Gap default_burst_slop_expansion;
@@ -222,7 +281,7 @@ public:
     ar & BOOST_SERIALIZATION_NVP( pulse_count );
     ar & BOOST_SERIALIZATION_NVP( tag_finders );
     ar & BOOST_SERIALIZATION_NVP( ts );
-    ar & BOOST_SERIALIZATION_NVP( graphs );
+    ar & BOOST_SERIALIZATION_NVP( graph_tags );
     ar & BOOST_SERIALIZATION_NVP( pulse_slop );
     ar & BOOST_SERIALIZATION_NVP( burst_slop );
     ar & BOOST_SERIALIZATION_NVP( burst_slop_expansion );
@@ -0,0 +1,84 @@
+#include "Worker_Pool.hpp"
+
+#include <unistd.h>
+
+Worker_Pool::Worker_Pool(unsigned int n) :
+  n(std::max(n, 1U)),
+  pid(0),
+  sh(0)
+{
+  start();
+};
+
+Worker_Pool::~Worker_Pool() {
+  if (pid != getpid())
+    return; // threads belong to another process
+  {
+    std::unique_lock < std::mutex > lock(sh->m);
+    sh->stopping = true;
+  }
+  sh->go.notify_all();
+  for (auto t = sh->threads.begin(); t != sh->threads.end(); ++t)
+    t->join();
+  delete sh;
+};
+
+void
+Worker_Pool::start() {
+  // After fork(), the shared state refers to threads which don't
+  // exist in this process, and its mutex and condition variables
+  // might be in any state; abandon it.
+  sh = new Shared();
+  sh->job = 0;
+  sh->generation = 0;
+  sh->busy = 0;
+  sh->stopping = false;
+  pid = getpid();
+  for (unsigned int k = 1; k < n; ++k)
+    sh->threads.push_back(std::thread(& Worker_Pool::work, sh, k));
+};
+
+void
+Worker_Pool::run(const Job & job) {
+  if (n == 1) {
+    job(0);
+    return;
+  }
+  if (pid != getpid())
+    start();
+  {
+    std::unique_lock < std::mutex > lock(sh->m);
+    sh->job = & job;
+    sh->busy = n - 1;
+    ++ sh->generation;
+  }
+  sh->go.notify_all();
+
+  job(0);
+
+  std::unique_lock < std::mutex > lock(sh->m);
+  sh->done.wait(lock, [this] {return sh->busy == 0;});
+  sh->job = 0;
+};
+
+void
+Worker_Pool::work(Shared * sh, unsigned int k) {
+  unsigned long long seen = 0;
+  for (;;) {
+    const Job * job;
+    {
+      std::unique_lock < std::mutex > lock(sh->m);
+      sh->go.wait(lock, [sh, seen] {return sh->stopping || sh->generation != seen;});
+      if (sh->stopping)
+        return;
+      seen = sh->generation;
+      job = sh->job;
+    }
+    (*job)(k);
+    {
+      std::unique_lock < std::mutex > lock(sh->m);
+      if (-- sh->busy == 0)
+        sh->done.notify_one();
+    }
+  }
+};
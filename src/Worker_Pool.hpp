@@ -0,0 +1,60 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include "find_tags_common.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <sys/types.h>
+
+/*
+  Worker_Pool - a fixed set of threads for fork-join work.
+
+  run(job) calls job(k) for k = 0 ... size() - 1, each on a different
+  thread (k = 0 on the caller's), and returns when all calls have
+  returned.  Jobs must not throw.
+
+  Threads do not survive fork(), so a pool used in a process other
+  than the one which created it (e.g. a time-shard worker) restarts
+  its threads first.
+*/
+
+class Worker_Pool {
+
+public:
+
+  typedef std::function < void (unsigned int) > Job;
+
+  Worker_Pool(unsigned int n); //!< create a pool which runs jobs on n threads, including the caller's
+
+  ~Worker_Pool();
+
+  void run(const Job & job); //!< run job(0), ..., job(n - 1) in parallel, and wait for them to finish
+
+  unsigned int size() { return n; };
+
+protected:
+
+  unsigned int n;                  //!< number of threads, including caller's
+  pid_t pid;                       //!< process in which threads were started
+
+  struct Shared {                  //!< state shared with worker threads
+    std::vector < std::thread > threads;
+    std::mutex m;
+    std::condition_variable go;    //!< signalled when a new job is posted, or on shutdown
+    std::condition_variable done;  //!< signalled when the last worker finishes a job
+    const Job * job;               //!< current job
+    unsigned long long generation; //!< incremented for each job posted
+    unsigned int busy;             //!< workers still running the current job
+    bool stopping;
+  };
+
+  Shared * sh;
+
+  void start();                    //!< start worker threads
+  static void work(Shared * sh, unsigned int k); //!< loop run by worker thread k
+};
+
+#endif // WORKER_POOL_HPP
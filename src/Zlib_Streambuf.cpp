@@ -0,0 +1,102 @@
+#include "Zlib_Streambuf.hpp"
+
+#include <string.h>
+
+Deflate_Streambuf::Deflate_Streambuf(std::string & out, int level) :
+  out(out)
+{
+  memset(& z, 0, sizeof(z));
+  if (Z_OK != deflateInit(& z, level))
+    throw std::runtime_error("Unable to start compressing stream");
+  setp(in, in + CHUNK);
+};
+
+Deflate_Streambuf::~Deflate_Streambuf() {
+  deflateEnd(& z);
+};
+
+void
+Deflate_Streambuf::deflate_input(int flush) {
+  z.next_in = (Bytef *) pbase();
+  z.avail_in = pptr() - pbase();
+  int rv;
+  do {
+    // grow out by at least the bound for what's left, so that
+    // deflate() never runs out of room in the middle of its input
+    size_t used = out.size();
+    size_t room = deflateBound(& z, z.avail_in) + 64;
+    out.resize(used + room);
+    z.next_out = (Bytef *) & out[used];
+    z.avail_out = room;
+    rv = deflate(& z, flush);
+    out.resize(used + room - z.avail_out);
+    if (rv == Z_STREAM_ERROR)
+      throw std::runtime_error("Unable to compress stream");
+  } while (z.avail_in > 0 || (flush == Z_FINISH && rv != Z_STREAM_END));
+  setp(in, in + CHUNK);
+};
+
+Deflate_Streambuf::int_type
+Deflate_Streambuf::overflow(int_type c) {
+  deflate_input(Z_NO_FLUSH);
+  if (! traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+};
+
+std::streamsize
+Deflate_Streambuf::xsputn(const char * s, std::streamsize n) {
+  std::streamsize left = n;
+  while (left > 0) {
+    std::streamsize k = std::min(left, (std::streamsize) (epptr() - pptr()));
+    memcpy(pptr(), s, k);
+    pbump(k);
+    s += k;
+    left -= k;
+    if (pptr() == epptr())
+      deflate_input(Z_NO_FLUSH);
+  }
+  return n;
+};
+
+void
+Deflate_Streambuf::finish() {
+  deflate_input(Z_FINISH);
+  setp(0, 0);
+};
+
+Inflate_Streambuf::Inflate_Streambuf(const char * data, size_t len) :
+  done(false)
+{
+  memset(& z, 0, sizeof(z));
+  z.next_in = (Bytef *) data;
+  z.avail_in = len;
+  if (Z_OK != inflateInit(& z))
+    throw std::runtime_error("Unable to start decompressing stream");
+  setg(out, out, out);
+};
+
+Inflate_Streambuf::~Inflate_Streambuf() {
+  inflateEnd(& z);
+};
+
+Inflate_Streambuf::int_type
+Inflate_Streambuf::underflow() {
+  while (! done) {
+    z.next_out = (Bytef *) out;
+    z.avail_out = CHUNK;
+    int rv = inflate(& z, Z_NO_FLUSH);
+    if (rv == Z_STREAM_END)
+      done = true;
+    else if (rv != Z_OK)
+      throw std::runtime_error("Unable to decompress stream: it is corrupt or incomplete");
+    size_t n = CHUNK - z.avail_out;
+    if (n) {
+      setg(out, out, out + n);
+      return traits_type::to_int_type(*gptr());
+    }
+  }
+  return traits_type::eof();
+};
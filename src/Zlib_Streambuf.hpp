@@ -0,0 +1,56 @@
+#ifndef ZLIB_STREAMBUF_HPP
+#define ZLIB_STREAMBUF_HPP
+
+//!< Zlib_Streambuf - compress or decompress a stream as it is written or read.
+//
+// Tag_Foray::pause() serializes the foray through a Deflate_Streambuf,
+// so that only the compressed state is ever held in memory, rather
+// than the whole serialized state and then its compressed copy.
+// Tag_Foray::resume() likewise deserializes through an
+// Inflate_Streambuf reading the compressed state, a piece at a time.
+//
+// The compressed data is a zlib stream (RFC 1950).
+
+#include "find_tags_common.hpp"
+
+#include <streambuf>
+#include <zlib.h>
+
+class Deflate_Streambuf : public std::streambuf {
+
+public:
+  Deflate_Streambuf(std::string & out, int level = Z_BEST_SPEED); //!< append compressed data to out
+  ~Deflate_Streambuf();
+
+  void finish(); //!< compress anything buffered and end the zlib stream; nothing can be written after this
+
+  static const size_t CHUNK = 64 * 1024; //!< bytes buffered before compressing
+
+protected:
+  std::string & out;
+  z_stream z;
+  char in[CHUNK];
+
+  void deflate_input(int flush); //!< compress the buffered bytes into out
+
+  int_type overflow(int_type c);
+  std::streamsize xsputn(const char * s, std::streamsize n);
+};
+
+class Inflate_Streambuf : public std::streambuf {
+
+public:
+  Inflate_Streambuf(const char * data, size_t len); //!< read the decompressed contents of a zlib stream; data must outlast this object
+  ~Inflate_Streambuf();
+
+  static const size_t CHUNK = 64 * 1024; //!< bytes decompressed at a time
+
+protected:
+  z_stream z;
+  bool done;
+  char out[CHUNK];
+
+  int_type underflow();
+};
+
+#endif // ZLIB_STREAMBUF_HPP
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <time.h>
+
+#include "find_tags_common.hpp"
+#include "Tag.hpp"
+#include "Graph.hpp"
+#include "Tag_Candidate.hpp"
+#include "Tag_Finder.hpp"
+#include "Candidate_Archive.hpp"
+
+static double
+now () {
+  struct timespec tsp;
+  clock_gettime(CLOCK_MONOTONIC, & tsp);
+  return tsp.tv_sec + 1e-9 * tsp.tv_nsec;
+};
+
+// a streambuf which discards what is written, so that timing writes
+// doesn't include growing a buffer to hold them all
+
+class Discard_Buf : public std::streambuf {
+public:
+  size_t n;
+  Discard_Buf() : n(0) {};
+protected:
+  std::streamsize xsputn(const char * s, std::streamsize k) { n += k; return k; };
+  int_type overflow(int_type c) { ++n; return traits_type::not_eof(c); };
+};
+
+static const int NUM_TAGS = 100;
+static const int PULSES_PER_CAND = 6;
+
+int main (int argc, char * argv[] ) {
+  if (argc > 1 && std::string(argv[1]) == "-h") {
+    std::cout << "\
+Usage:\n\
+    benchCandidates [N] [REPS]\n\
+\n\
+Times saving and restoring N Tag_Candidates (default: 1000000) with\n\
+Candidate_Archive, as Tag_Foray::pause() and resume() do, but to and\n\
+from memory, so without compression.  The candidates belong to one\n\
+Tag_Finder with a graph of 100 tags, and each has followed a tag for\n\
+6 pulses: a whole burst and the start of the next one.  Each is run\n\
+REPS times (default: 3), and the restored candidates are checked to\n\
+save to the same records as the originals.\n\
+Exit code is 0 if they do, 1 otherwise.\n\
+";
+    return 0;
+  }
+  size_t n = argc > 1 ? atol(argv[1]) : 1000000;
+  int reps = argc > 2 ? atoi(argv[2]) : 3;
+
+  Node::init();
+  Tag_Candidate::set_freq_slop_kHz(0.5);
+  Tag_Candidate::set_sig_slop_dB(10);
+  Tag_Candidate::set_pulses_to_confirm_id(8);
+
+  Graph * g = new Graph();
+  std::vector < Tag * > tags;
+  for (int i = 0; i < NUM_TAGS; ++i) {
+    std::vector < Gap > gaps = {0.0244 + i * 0.004, 0.0293, 0.0317, 10.0 + i * 0.05};
+    tags.push_back(new Tag(1000 + i, 166.38, 4, 0, 0, gaps));
+    tags.back()->active = true;
+    g->addTag(tags.back(), 0.0015, 0.001, 84, 0);
+  }
+
+  // each candidate follows the pulses of one tag through the graph, as
+  // Tag_Finder::process would
+
+  Tag_Finder * tf = new Tag_Finder(0, 166380, 0, g, "1,");
+
+  // keep the root node in use, as the candidates Tag_Finder::process
+  // starts at each pulse do; otherwise it's dropped when the first
+  // candidate leaves it
+
+  Tag_Candidate root_user(tf, g->root(), Pulse::make(1.5e9, 4.0, -40, -60, 166.376));
+
+  for (size_t k = 0; k < n; ++k) {
+    Tag * t = tags[k % NUM_TAGS];
+    Timestamp ts = 1.5e9 + k * 0.01;
+    Tag_Candidate * tc = new Tag_Candidate(tf, g->root(), Pulse::make(ts, 4.0, -40, -60, 166.376));
+    for (int j = 1; j < PULSES_PER_CAND; ++j) {
+      ts += t->gaps[(j - 1) % t->gaps.size()];
+      Pulse p = Pulse::make(ts, 4.0, -40 + j, -60, 166.376);
+      Node * ns = tc->advance_by_pulse(p);
+      if (! ns) {
+        std::cerr << "Candidate " << k << " can't follow its tag" << std::endl;
+        return 1;
+      }
+      tc->add_pulse(p, ns);
+    }
+    tf->cands[k % Tag_Finder::NUM_CAND_LISTS].insert(std::make_pair(tc->min_next_pulse_ts(), tc));
+  }
+  Candidate_Archive::Finder_Map saved;
+  saved[Candidate_Archive::Finder_Key(1, 166380)] = tf;
+
+  double t_write = 0;
+  for (int i = 0; i < reps; ++i) {
+    Discard_Buf db;
+    double t0 = now();
+    Candidate_Archive ca(saved);
+    ca.write(db);
+    t_write += now() - t0;
+  }
+  t_write /= reps;
+
+  std::stringbuf sb;
+  Candidate_Archive ca(saved);
+  ca.write(sb);
+  std::string blob = sb.str();
+  std::vector < Tag * > arch_tags = ca.tags;
+
+  Tag_Finder * tf2 = 0;
+  double t_read = 0;
+  for (int i = 0; i < reps; ++i) {
+    if (tf2) {
+      for (auto cl = tf2->cands.begin(); cl != tf2->cands.end(); ++cl) {
+        for (auto ci = cl->begin(); ci != cl->end(); ++ci)
+          delete ci->second;
+        cl->clear();
+      }
+      delete tf2;
+    }
+    tf2 = new Tag_Finder();
+    tf2->graph = g;
+    Candidate_Archive::Finder_Map restored;
+    restored[Candidate_Archive::Finder_Key(1, 166380)] = tf2;
+    std::stringbuf sb(blob);
+    double t0 = now();
+    Candidate_Archive ca(restored);
+    ca.read(sb);
+    ca.tags = arch_tags;
+    ca.restore();
+    t_read += now() - t0;
+  }
+  t_read /= reps;
+
+  // saving the restored candidates must give the same records
+
+  std::stringbuf sb2;
+  Candidate_Archive::Finder_Map restored;
+  restored[Candidate_Archive::Finder_Key(1, 166380)] = tf2;
+  Candidate_Archive ca2(restored);
+  ca2.write(sb2);
+  bool bad = sb2.str() != blob || ca2.tags != arch_tags;
+
+  std::cout << n << " candidates, " << arch_tags.size() << " tags, " << blob.size() << " bytes; ms per pass: write: " << std::setprecision(4)
+            << t_write * 1000 << "; read: " << t_read * 1000 << "; restored candidates "
+            << (bad ? "differ" : "match") << std::endl;
+  return bad > 0;
+}
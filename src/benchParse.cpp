@@ -0,0 +1,121 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <time.h>
+
+#include "find_tags_common.hpp"
+#include "SG_Record.hpp"
+
+// compare the fields of two records which are set for their type
+
+static bool
+same (const SG_Record & a, const SG_Record & b) {
+  if (a.type != b.type)
+    return false;
+  switch (a.type) {
+  case SG_Record::PULSE:
+    return a.port == b.port && ! memcmp(& a.ts, & b.ts, sizeof(a.ts))
+      && ! memcmp(& a.v.dfreq, & b.v.dfreq, sizeof(a.v.dfreq))
+      && ! memcmp(& a.v.sig, & b.v.sig, sizeof(a.v.sig))
+      && ! memcmp(& a.v.noise, & b.v.noise, sizeof(a.v.noise));
+  case SG_Record::GPS:
+    return ! memcmp(& a.ts, & b.ts, sizeof(a.ts))
+      && ! memcmp(& a.v.lat, & b.v.lat, 3 * sizeof(double));
+  case SG_Record::PARAM:
+    return a.port == b.port && ! memcmp(& a.ts, & b.ts, sizeof(a.ts))
+      && ! strcmp(a.v.param_flag, b.v.param_flag)
+      && ! memcmp(& a.v.param_value, & b.v.param_value, sizeof(a.v.param_value))
+      && a.v.return_code == b.v.return_code;
+  case SG_Record::CLOCK:
+    return ! memcmp(& a.ts, & b.ts, sizeof(a.ts)) && a.v.clock_level == b.v.clock_level
+      && ! memcmp(& a.v.clock_remaining, & b.v.clock_remaining, sizeof(a.v.clock_remaining));
+  case SG_Record::FILE:
+    return ! memcmp(& a.ts, & b.ts, sizeof(a.ts));
+  default:
+    return true;
+  }
+};
+
+static double
+now () {
+  struct timespec tsp;
+  clock_gettime(CLOCK_MONOTONIC, & tsp);
+  return tsp.tv_sec + 1e-9 * tsp.tv_nsec;
+};
+
+int main (int argc, char * argv[] ) {
+  if (argc < 2 || std::string(argv[1]) == "-h") {
+    std::cout << "\
+Usage:\n\
+    benchParse FILE [REPS]\n\
+\n\
+Compares parsing of raw SG records line by line with\n\
+SG_Record::from_buf_sscanf(), which was the parser used by\n\
+find_tags_motus before from_chars(), with parsing line by line with\n\
+SG_Record::from_buf(), and with parsing the whole file at once with\n\
+SG_Record::from_blob().  FILE is an uncompressed raw SG data file.\n\
+Each is run REPS times (default: 10), and the records from from_blob()\n\
+are checked to be identical to those from sscanf.\n\
+Exit code is 0 if they are, 1 otherwise.\n\
+";
+    return argc < 2;
+  }
+  int reps = argc > 2 ? atoi(argv[2]) : 10;
+
+  std::ifstream in(argv[1]);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string blob = ss.str();
+
+  // line by line, copying each line to a buffer as Clock_Repair does
+
+  auto by_line = [&] (std::vector < SG_Record > & recs, bool use_sscanf) {
+    double t0 = now();
+    for (int i = 0; i < reps; ++i) {
+      recs.clear();
+      std::istringstream lines(blob);
+      std::string line;
+      char buf[MAX_LINE_SIZE + 1];
+      while (std::getline(lines, line)) {
+        strncpy(buf, line.c_str(), MAX_LINE_SIZE);
+        buf[MAX_LINE_SIZE] = '\0';
+        recs.push_back(SG_Record());
+        if (use_sscanf)
+          recs.back().from_buf_sscanf(buf);
+        else
+          recs.back().from_buf(buf);
+      }
+    }
+    return (now() - t0) / reps;
+  };
+
+  std::vector < SG_Record > ref, lines;
+  double t_ref = by_line(ref, true);
+  double t_lines = by_line(lines, false);
+
+  // whole blob at once
+
+  std::vector < SG_Record > fast;
+  double t0 = now();
+  for (int i = 0; i < reps; ++i) {
+    fast.clear();
+    SG_Record::from_blob(blob.data(), blob.size(), fast);
+  }
+  double t_fast = (now() - t0) / reps;
+
+  size_t bad = ref.size() == fast.size() ? 0 : 1;
+  for (size_t i = 0; i < ref.size() && i < fast.size(); ++i) {
+    if (! same(ref[i], fast[i])) {
+      if (++bad <= 5)
+        std::cerr << "Mismatch at line " << i + 1 << std::endl;
+    }
+  }
+  std::cout << fast.size() << " lines; ms per pass: sscanf: " << std::setprecision(4) << t_ref * 1000
+            << "; from_buf: " << t_lines * 1000 << "; from_blob: " << t_fast * 1000
+            << "; mismatches: " << bad << std::endl;
+  return bad > 0;
+}
@@ -194,6 +194,9 @@ All output from a run of this program forms a new batch.
 #include <set>
 #include <vector>
 #include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <boost/program_options.hpp>
 #include <boost/any.hpp>
 #include "find_tags_common.hpp"
@@ -205,6 +208,11 @@ All output from a run of this program forms a new batch.
 #include "Rate_Limiting_Tag_Finder.hpp"
 #include "Tag_Foray.hpp"
 #include "Data_Source.hpp"
+#include "Shard_Runner.hpp"
+#include "Clock_Repair.hpp"
+#include "Pulse_Archive_Writer.hpp"
+#include "Output_Sink.hpp"
+#include "Record_Pipe.hpp"
 
 #ifdef DEBUG
 // force debugging methods to be emitted
@@ -215,6 +223,24 @@ void * tabfun[] = { (void *) &Tag_Database::getTagForMotusID };
 
 namespace po = boost::program_options;
 
+// read a parameter sweep file: one configuration per line, given as
+// options; blank lines and lines beginning with '#' are ignored
+
+std::vector < std::vector < std::string > >
+read_sweep_file (const std::string & path) {
+  std::ifstream in(path);
+  if (! in)
+    throw std::runtime_error("Unable to open --sweep file");
+  std::vector < std::vector < std::string > > configs;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto args = po::split_unix(line);
+    if (args.size() && args[0][0] != '#')
+      configs.push_back(args);
+  }
+  return configs;
+};
+
 int
 main (int argc, char **argv) {
 
@@ -237,8 +263,11 @@ main (int argc, char **argv) {
   // input-related params
 
   std::string input_file;
+  std::string write_archive;
   bool src_sqlite;
+  bool src_pulses;
   bool lotek;
+  bool lotek_direct;
   std::string tag_database;
   bool use_events;
   int bootnum;
@@ -251,7 +280,11 @@ main (int argc, char **argv) {
   bool test_only;
   bool graph_only;
   bool pulses_only;
+  bool skip_pulses;
   double gps_min_dt;
+  std::string csv_output;
+  std::string columnar_output;
+  std::string binary_output;
 
   // rate-limiting buffer params
 
@@ -264,6 +297,22 @@ main (int argc, char **argv) {
   float sig_slop_dB;
   int max_skipped_bursts;
 
+  // parallelism params
+  int time_shards;
+  Gap shard_margin;
+  int dfreq_bands;
+  int screen_threads;
+  int screen_min_cands;
+  std::string sweep_file;
+  int prefetch_files;
+  int write_queue;
+  bool bulk_load;
+  bool compact_hits;
+  double db_cache_mb;
+  double db_mmap_mb;
+  double max_file_mb;
+  double clock_buffer_mb;
+
   // additional params
   std::vector < std::string > external_param;
 
@@ -336,13 +385,26 @@ main (int argc, char **argv) {
      "if `src_sqlite` is specified, this is a `.sqlite` database which contains "
      "table `files` (for sensorgnomes) or table `DTAtags` (for Lotek receivers).  "
      "Otherwise, it is a .csv file, defaulting to `stdin` if not specified.  "
-     "Raw receiver records are read from the specified file."
+     "Raw receiver records are read from the specified file, which can also be "
+     "a pulse archive written with `--write_archive`."
+     )
+    ("write_archive", po::value< std::string >(&write_archive)->default_value(""),
+     "instead of finding tags, write the input's records to a pulse archive in file "
+     "WRITE_ARCHIVE, then exit.  Records are stored as parsed from the raw files, "
+     "before their timestamps are repaired, in a compact binary form which can be "
+     "read back much faster than raw files, by giving the archive as `input_file`."
      )
     ("src_sqlite,Q", po::value<bool>(& src_sqlite)->implicit_value(true)->default_value(false),
      "Treat `input_file` as an sqlite database and fetch paths to compressed data files "
      "from the `files` table if a sensorgnome, or from the `DTAtags` table if a Lotek "
      "receiver."
      )
+    ("src_pulses", po::value<bool>(& src_pulses)->implicit_value(true)->default_value(false),
+     "instead of raw receiver records, read the pulses recorded for boot session "
+     "`bootnum` in the `pulses` table of OUTPUT_DB by an earlier run with `--pulses_only`.  "
+     "These have already had their timestamps repaired, and been limited to the "
+     "`--min_dfreq`, `--max_dfreq` range of that run."
+     )
     ("lotek,L", po::value<bool>(& lotek)->implicit_value(true)->default_value(false),
      "Indicates that input data come from a lotek receiver.  In this case, input lines "
      "have a different format: TS,ID,ANT,SIG,ANTFREQ,GAIN,CODESET with:\n"
@@ -355,6 +417,15 @@ main (int argc, char **argv) {
      "Each input record is used to generate a sequence of pulse records in SG format,"
      "and the program re-finds tags from these."
      )
+    ("lotek_direct", po::value<bool>(& lotek_direct)->implicit_value(true)->default_value(false),
+     "With --lotek, build runs directly from the tag IDs reported by the receiver, "
+     "following a detection at a time rather than re-finding tags from the pulses of each "
+     "detection.  This is much faster, and gives the same runs and hits, except where "
+     "detections on the same antenna overlap in time, so that their pulses would have "
+     "been interleaved, and except that a tag activated by --use_events isn't considered "
+     "for detections already being followed as a run, only for later ones.  Clock jumps "
+     "aren't followed, so this can't be used with --timestamp_wonkiness."
+     )
     ("tag_database", po::value< std::string > (&tag_database),
      ".sqlite file which contains the `tags` (and possibly `events`) tables that "
      "define the tags to be sought (and possibly their activation history)"
@@ -418,12 +489,35 @@ main (int argc, char **argv) {
      "   - noise relative noise strength (dB max)\n"
      "With this option, the program ignores the tag database (although it must still be "
      "specified) and only uses these options:\n"
-     "--default_freq, --force_default_freq, --min_dfreq, --max_dfreq"
+     "--default_freq, --force_default_freq, --min_dfreq, --max_dfreq\n"
+     "Pulses are held in a temporary table until the end of the batch, and then "
+     "added to `pulses` in order by timestamp, which is faster than updating its "
+     "indexes for each pulse."
+     )
+    ("skip_pulses", po::value<bool>(& skip_pulses)->implicit_value(true)->default_value(false),
+     "With --pulses_only, don't record pulses; only repair timestamps and record pulse "
+     "counts, GPS fixes and receiver parameters."
      )
     ("gps_min_dt,G", po::value<double>(&gps_min_dt)->default_value(3600),
      "Minimum time step, in seconds, between GPS fixes to be recorded from receiver "
      "data. A negative value means do not record any GPS timestamps to the output "
      "database.")
+    ("csv_output", po::value< std::string >(&csv_output)->default_value(""),
+     "write runs, hits, GPS fixes, pulse counts, receiver parameters and pulses to CSV "
+     "files called PREFIX_runs.csv, PREFIX_hits.csv, etc., instead of to the output "
+     "database, whose tables they match.  The batch, program parameters, and files "
+     "processed are still recorded in the output database.  Can't be used with `--resume`."
+     )
+    ("columnar_output", po::value< std::string >(&columnar_output)->default_value(""),
+     "like `--csv_output`, but write to a single file FILE, in blocks of compressed "
+     "binary columns; see Columnar_Sink.hpp for the format."
+     )
+    ("binary_output", po::value< std::string >(&binary_output)->default_value(""),
+     "like `--csv_output`, but write to a single file FILE, as a stream of uncompressed "
+     "binary records; see Binary_Sink.hpp for the format.  If FILE is `-`, write to "
+     "standard output, as each run ends, and at most a quarter second after each "
+     "record while more are being added."
+     )
 
     ("max_pulse_rate,R", po::value<float>(&max_pulse_rate)->default_value(0),
      "maximum pulse rate (pulses per second) during pulse rate time window."
@@ -466,6 +560,94 @@ main (int argc, char **argv) {
      "bursts between them."
      )
 
+    // parallelism params
+
+    ("time_shards,T", po::value<int>(&time_shards)->default_value(1),
+     "split the boot session's files into this many consecutive time shards, and "
+     "process them in parallel, each in its own process.  Runs which span shard "
+     "boundaries are stitched together.  Only used with `--src_sqlite` on a new "
+     "(not resumed) SG boot session; otherwise, input is processed serially."
+     )
+    ("shard_margin", po::value<Gap>(&shard_margin)->default_value(0),
+     "overlap, in seconds, between consecutive time shards.  Each shard re-processes "
+     "this much data before its first file, to rebuild tag candidates alive at its "
+     "start.  The default (0) means use a margin long enough to confirm a tag after "
+     "the longest allowed gaps between its bursts."
+     )
+
+    ("dfreq_bands", po::value<int>(&dfreq_bands)->default_value(1),
+     "when a tag finder has many candidates, check them against each pulse using this "
+     "many threads.  Each thread handles candidates whose frequency offset lies in one "
+     "of this many equal bands spanning [--min_dfreq, --max_dfreq] (or [-24, 24] kHz "
+     "where these are not given).  Results are the same as with the default (1), "
+     "which uses no extra threads."
+     )
+    ("screen_threads", po::value<int>(&screen_threads)->default_value(1),
+     "when a tag finder has many candidates (e.g. during a burst of noise), check them "
+     "against each pulse using this many threads, each taking an equal share of the "
+     "candidates.  Results are the same as with the default (1), which uses no extra "
+     "threads.  If greater than 1, this overrides `--dfreq_bands`."
+     )
+    ("screen_min_cands", po::value<int>(&screen_min_cands)->default_value(1000),
+     "only use threads from `--screen_threads` or `--dfreq_bands` when a pulse must "
+     "be checked against at least this many candidates.  With fewer, the cost of "
+     "starting and waiting for threads outweighs the work they share."
+     )
+    ("prefetch_files", po::value<int>(&prefetch_files)->default_value(2),
+     "with `--src_sqlite`, read and decompress this many raw files ahead of the one "
+     "being processed, each on its own thread.  0 means read each file only when it "
+     "is needed."
+     )
+    ("write_queue", po::value<int>(&write_queue)->default_value(65536),
+     "write runs, hits, pulses and other output records to the output database on "
+     "a separate thread, with up to about this many of them waiting to be written.  "
+     "0 means write each record as it is found."
+     )
+    ("bulk_load", po::value<bool>(&bulk_load)->implicit_value(true)->default_value(false),
+     "write output for reprocessing large amounts of data: each run is written once, when "
+     "it ends, rather than when it begins and again when it ends, hits are written many "
+     "at a time, and the receiver database is not synced to disk during the batch, so "
+     "that a crash or power failure can leave it corrupt."
+     )
+    ("compact_hits", po::value<bool>(&compact_hits)->implicit_value(true)->default_value(false),
+     "store hits in the receiver database in a compact form, in a table called "
+     "`hitsCompact`, replacing the `hits` table with a view which has the same columns.  "
+     "Timestamps are kept exactly, but other values are rounded: signal and noise to "
+     "0.01 dB, frequencies to 1 Hz, and slop to 1 microsecond.  The receiver database "
+     "must not yet have any hits.  Once its hits are stored this way, they always are, "
+     "with or without this option, and `hits` is read-only: hits can't be deleted or "
+     "changed through it."
+     )
+    ("db_cache_mb", po::value<double>(&db_cache_mb)->default_value(16),
+     "use a page cache of this many megabytes for each connection to the receiver "
+     "database.  Input is read through one connection and output written through "
+     "another, unless the database can't be put in WAL mode."
+     )
+    ("db_mmap_mb", po::value<double>(&db_mmap_mb)->default_value(0),
+     "access up to this many megabytes of the receiver database through memory-mapped "
+     "I/O, rather than read and write calls.  0 means don't."
+     )
+    ("max_file_mb", po::value<double>(&max_file_mb)->default_value(64),
+     "with `--src_sqlite`, raw files which decompress to more than this many megabytes "
+     "are not held in memory whole, but decompressed and processed in pieces of about "
+     "this size, so that memory use does not grow with file size."
+     )
+    ("clock_buffer_mb", po::value<double>(&clock_buffer_mb)->default_value(256),
+     "records read before their timestamps can be corrected are kept, to be processed "
+     "once a correction is found; hold up to this many megabytes of them in memory, "
+     "and the rest in a temporary file."
+     )
+    ("sweep", po::value< std::string >(&sweep_file)->default_value(""),
+     "run a parameter sweep.  SWEEP_FILE has one configuration per line, given as "
+     "options (e.g. `--output_db=sweep1.motus --pulse_slop=2`) which override those "
+     "on the command line.  Input is read and its timestamps repaired once, by this "
+     "process, which processes it with the command-line options; each configuration "
+     "is processed in parallel by its own process, and must have its own `--output_db`, "
+     "which must be an existing receiver database.  Options about input are ignored "
+     "on SWEEP_FILE lines.  Can't be used with `--resume`, and a configuration's "
+     "`--output_db` can't later be resumed either."
+     )
+
     // additional params
 
     ("external_param,x", po::value< std::vector< std::string > >(&external_param),
@@ -496,6 +678,52 @@ main (int argc, char **argv) {
             options(opt).positional(popt).run(), vm);
   po::notify(vm);
 
+  // parameter sweep: fork a process for each configuration, which gets
+  // clock-repaired records through a pipe from this one
+
+  std::vector < pid_t > sweep_pids;
+  int sweep_fd = -1; // in a sweep process, reading end of the pipe
+
+  if (sweep_file.size() && ! vm.count("help") && ! info_only && ! test_only && ! graph_only) {
+    if (resume)
+      throw std::runtime_error("Can't use --sweep with --resume");
+    auto configs = read_sweep_file(sweep_file);
+    for (auto c = configs.begin(); c != configs.end(); ++c) {
+      po::variables_map cvm;
+      po::store(po::command_line_parser(*c).options(opt).run(), cvm);
+      if (! cvm.count("output_db") || cvm["output_db"].as < std::string > () == output_db)
+        throw std::runtime_error("each configuration in the --sweep file must have its own --output_db");
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    signal(SIGPIPE, SIG_IGN); // a failed configuration must not stop the others
+    for (unsigned int k = 0; k < configs.size(); ++k) {
+      int fds[2];
+      if (pipe(fds))
+        throw std::runtime_error("Unable to create pipe for parameter sweep");
+      pid_t pid = fork();
+      if (pid < 0)
+        throw std::runtime_error("Unable to fork process for parameter sweep");
+      if (pid == 0) {
+        // sweep process: options on the configuration's line take
+        // precedence over those on the command line
+        close(fds[1]);
+        Clock_Repair::close_tees(); // pipes to earlier configurations
+        sweep_fd = fds[0];
+        po::variables_map cvm;
+        po::store(po::command_line_parser(configs[k]).options(opt).run(), cvm);
+        po::store(po::command_line_parser(argc, argv).options(opt).positional(popt).run(), cvm);
+        po::notify(cvm);
+        sweep_file.clear();
+        sweep_pids.clear();
+        break;
+      }
+      close(fds[0]);
+      Clock_Repair::add_tee(new Record_Pipe(fds[1], true));
+      sweep_pids.push_back(pid);
+    }
+  }
+
   std::map<std::string, std::string> external_param_map; // to store any external parameters for recording
 
   for (auto ep = external_param.begin(); ep != external_param.end(); ++ep) {
@@ -518,15 +746,38 @@ main (int argc, char **argv) {
   Tag_Candidate::set_pulses_to_confirm_id(pulses_to_confirm);
   Tag_Candidate::set_sig_slop_dB(sig_slop_dB);
   Tag_Candidate::set_freq_slop_kHz(frequency_slop);
+  if (screen_threads > 1)
+    Tag_Finder::set_screen_threads(screen_threads, screen_min_cands);
+  else
+    Tag_Finder::set_dfreq_bands(dfreq_bands, min_dfreq, max_dfreq, screen_min_cands);
 
   // sanity checks
 
   if (resume && lotek) {
     throw std::runtime_error("Can't use --resume with a Lotek receiver");
   };
+  if (lotek_direct && ! lotek) {
+    throw std::runtime_error("must specify --lotek in order to use --lotek_direct");
+  }
+  int num_sinks = !! csv_output.size() + !! columnar_output.size() + !! binary_output.size();
+  if (num_sinks > 1) {
+    throw std::runtime_error("Can only use one of --csv_output, --columnar_output and --binary_output");
+  }
+  if (resume && num_sinks) {
+    throw std::runtime_error("Can't use --resume with --csv_output, --columnar_output or --binary_output");
+  }
+  if (skip_pulses && ! pulses_only) {
+    throw std::runtime_error("must specify --pulses_only in order to use --skip_pulses");
+  }
+  if (lotek_direct && pulses_only) {
+    throw std::runtime_error("Can't use --pulses_only with --lotek_direct");
+  }
   if (timestamp_wonkiness > 0 && ! lotek) {
     throw std::runtime_error("must specify --lotek in order to use --timestamp_wonkiness=N with N > 0");
   }
+  if (timestamp_wonkiness > 0 && lotek_direct) {
+    throw std::runtime_error("Can't use --timestamp_wonkiness=N with N > 0 and --lotek_direct");
+  }
 
   // set options and parameters
 
@@ -589,6 +840,23 @@ main (int argc, char **argv) {
 
       DB_Filer dbf (output_db, program_name, program_version, program_build_ts, bootnum, gps_min_dt);
       Tag_Candidate::set_filer(& dbf);
+      dbf.set_blob_prefetch(std::max(prefetch_files, 0));
+      dbf.set_max_blob((size_t) (std::max(max_file_mb, 0.0) * 1024 * 1024));
+      dbf.set_db_memory(std::max(db_cache_mb, 0.0), std::max(db_mmap_mb, 0.0));
+      dbf.set_write_queue(std::max(write_queue, 0));
+      if (compact_hits)
+        dbf.set_compact_hits();
+      if (bulk_load)
+        dbf.set_bulk_load(true);
+      if (pulses_only)
+        dbf.set_pulse_capture(skip_pulses ? DB_Filer::PULSES_SKIPPED : DB_Filer::PULSES_STAGED);
+      if (csv_output.size())
+        dbf.set_sink(Output_Sink::make_CSV_sink(csv_output));
+      else if (columnar_output.size())
+        dbf.set_sink(Output_Sink::make_columnar_sink(columnar_output));
+      else if (binary_output.size())
+        dbf.set_sink(Output_Sink::make_binary_sink(binary_output));
+      Clock_Repair::set_spool_mem((size_t) (std::max(clock_buffer_mb, 0.0) * 1024 * 1024));
 
       Tag_Database * tag_db = 0;
 
@@ -596,18 +864,35 @@ main (int argc, char **argv) {
 
       // set up the data source
       Data_Source * pulses = 0;
-      if (lotek) {
+      if (sweep_fd >= 0) {
+        // records come from the process running the sweep
+        pulses = new Record_Pipe(sweep_fd, false);
+      } else if (lotek) {
         if (src_sqlite) {
           // create tag_db here, since it won't be created below
           tag_db = new Tag_Database (tag_database, use_events);
-          pulses = Data_Source::make_Lotek_source(& dbf, tag_db, default_freq, bootnum);
+          pulses = Data_Source::make_Lotek_source(& dbf, tag_db, default_freq, bootnum, lotek_direct);
         } else {
           throw std::runtime_error("Must specify --src_sqlite with a Lotek data source");
         }
+      } else if (src_pulses) {
+        if (pulses_only)
+          throw std::runtime_error("Can't use --pulses_only with --src_pulses");
+        pulses = Data_Source::make_pulses_source(& dbf, bootnum);
       } else if (src_sqlite) {
         pulses = Data_Source::make_SQLite_source(& dbf, bootnum);
       } else {
-        pulses = Data_Source::make_SG_source(optind < argc ? argv[optind++] : "");
+        pulses = Data_Source::make_SG_source(input_file);
+      }
+
+      if (write_archive.size()) {
+        Pulse_Archive_Writer archive(write_archive);
+        unsigned long long n = archive.put_all(pulses);
+        archive.close();
+        // converting the input isn't a batch of tag finding
+        dbf.drop_batch();
+        std::cerr << "Wrote " << n << " records to pulse archive " << write_archive << std::endl;
+        return 0;
       }
 
       Tag_Foray foray;
@@ -631,7 +916,7 @@ main (int argc, char **argv) {
         // Freq_Setting needs to know the set of nominal frequencies
         Freq_Setting::set_nominal_freqs(tag_db->get_nominal_freqs());
 
-        foray = Tag_Foray(tag_db, pulses, default_freq, force_default_freq, min_dfreq, max_dfreq, max_pulse_rate, pulse_rate_window, min_bogus_spacing, unsigned_dfreq, pulses_only);
+        foray = Tag_Foray(tag_db, pulses, default_freq, force_default_freq, min_dfreq, max_dfreq, max_pulse_rate, pulse_rate_window, min_bogus_spacing, unsigned_dfreq, pulses_only, lotek_direct);
       }
 
       // record the commit hash from the meta database as an external parameter
@@ -648,6 +933,8 @@ main (int argc, char **argv) {
       dbf.add_param("max_dfreq", max_dfreq);
       dbf.add_param("pulse_slop", pulse_slop);
       dbf.add_param("pulses_only", pulses_only);
+      dbf.add_param("skip_pulses", skip_pulses);
+      dbf.add_param("src_pulses", src_pulses);
       dbf.add_param("max_pulse_rate", max_pulse_rate );
       dbf.add_param("frequency_slop", frequency_slop);
       dbf.add_param("max_skipped_bursts", max_skipped_bursts);
@@ -656,7 +943,22 @@ main (int argc, char **argv) {
       dbf.add_param("unsigned_dfreq", unsigned_dfreq);
       dbf.add_param("resume", resume);
       dbf.add_param("lotek", lotek);
+      dbf.add_param("lotek_direct", lotek_direct);
       dbf.add_param("timestamp_wonkiness", timestamp_wonkiness);
+      dbf.add_param("time_shards", time_shards);
+      dbf.add_param("dfreq_bands", dfreq_bands);
+      dbf.add_param("screen_threads", screen_threads);
+      dbf.add_param("screen_min_cands", screen_min_cands);
+      if (sweep_file.size())
+        dbf.add_param("sweep", sweep_file);
+      if (compact_hits)
+        dbf.add_param("compact_hits", compact_hits);
+      if (csv_output.size())
+        dbf.add_param("csv_output", csv_output);
+      if (columnar_output.size())
+        dbf.add_param("columnar_output", columnar_output);
+      if (binary_output.size())
+        dbf.add_param("binary_output", binary_output);
       for (auto ii=external_param_map.begin(); ii != external_param_map.end(); ++ii)
         dbf.add_param(ii->first.c_str(), ii->second.c_str());
 
@@ -671,20 +973,50 @@ main (int argc, char **argv) {
 
       if (graph_only) {
         foray.graph();
-        exit(0);
+        return 0;
       }
       if (test_only) {
         foray.test(); // throws if there's a problem
         std::cerr << "Ok\n";
-        exit(0);
+        return 0;
+      }
+      if (time_shards > 1 && (resume || lotek || pulses_only || ! src_sqlite || sweep_pids.size() || sweep_fd >= 0)) {
+        std::cerr << "find_tags_motus: --time_shards only applies to new SG boot sessions from --src_sqlite, without --sweep; processing serially" << std::endl;
+        time_shards = 1;
       }
-      foray.start();
+      if (time_shards <= 1 || ! Shard_Runner(& foray, & dbf, bootnum, time_shards, shard_margin).run())
+        foray.start();
+
+      // let sweep processes see the end of input
+      Clock_Repair::close_tees();
+
       std::cerr << "Max num candidates: " << Tag_Candidate::get_max_num_cands() << " at " << std::setprecision(14) << Tag_Candidate::get_max_cand_time() << "; now (" << foray.last_seen() << "): " << Tag_Candidate::get_num_cands() << std::endl;
-      foray.pause();
+      // a sweep configuration's records come through a pipe, whose
+      // position can't be saved; with an output sink, the runs a
+      // resumed batch would continue aren't in this database
+      foray.pause(sweep_fd < 0 && ! num_sinks);
+
+      bool sweep_ok = true;
+      for (unsigned int k = 0; k < sweep_pids.size(); ++k) {
+        int status;
+        if (waitpid(sweep_pids[k], & status, 0) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+          std::cerr << "find_tags_motus: sweep configuration " << k + 1 << " failed" << std::endl;
+          sweep_ok = false;
+        }
+      }
+      if (! sweep_ok)
+        throw std::runtime_error("Parameter sweep incomplete");
     }
+    // returning, or catching any exception, destroys dbf, which
+    // leaves the output database in rollback-journal mode
     catch (std::runtime_error e) {
       std::cerr << e.what() << std::endl;
       exit(2);
     }
-    std::cout << "Done." << std::endl;
+    catch (std::exception & e) {
+      std::cerr << "find_tags_motus: " << e.what() << std::endl;
+      exit(2);
+    }
+    // standard output might be carrying --binary_output records
+    (binary_output == "-" ? std::cerr : std::cout) << "Done." << std::endl;
 }
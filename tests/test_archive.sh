@@ -0,0 +1,76 @@
+#!/bin/bash
+
+## This tests whether finding tags in a pulse archive written with
+## --write_archive gives the same runs and hits as finding them in
+## the raw files it was written from, and whether writing the archive
+## leaves no batch behind in the receiver database.
+
+## Relative paths assume this script is run from its directory.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--pulses_to_confirm=8 --frequency_slop=0.5 --min_dfreq=0 --max_dfreq=12 --pulse_slop=1.5 --burst_slop=4 --burst_slop_expansion=1 --use_events --max_skipped_bursts=20 --default_freq=166.376 --bootnum=176"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+cp $RCVDB test1/raw.sqlite
+cp $RCVDB test1/archive.sqlite
+
+## find tags in the raw files
+$FINDTAGS $OPTIONS --src_sqlite=1 test1/raw.sqlite test1/raw.sqlite
+
+## write the raw files' records to an archive, then find tags in that
+$FINDTAGS $OPTIONS --src_sqlite=1 --write_archive=test1/test1.ftpa test1/archive.sqlite test1/archive.sqlite
+$FINDTAGS $OPTIONS test1/archive.sqlite test1/archive.sqlite test1/test1.ftpa
+
+$SQL test1/archive.sqlite <<EOF
+attach database 'test1/raw.sqlite' as r;
+
+select "numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = 127
+       and (select count(*) from runs) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "only batch is the real run's: " ||
+   case when
+       (select count(*) from batches) = 1
+       and (select numHits from batches) = 127
+       and (select tsStart from batches) is not null
+       and (select count(*) from batchFiles where batchID not in (select batchID from batches)) = 0
+       and (select count(*) from batchProgs where batchID not in (select batchID from batches)) = 0
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "archive/raw hits equal: " ||
+   case when
+       (select count(*) from (select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from hits
+                              except select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from r.hits)) = 0
+       and (select count(*) from hits) = (select count(*) from r.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "archive/raw runs equal: " ||
+   case when
+       (select count(*) from (select tsBegin, tsEnd, len, motusTagID, ant from runs
+                              except select tsBegin, tsEnd, len, motusTagID, ant from r.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from r.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "archive/raw pulse counts equal: " ||
+   case when
+       (select count(*) from (select ant, hourBin, count from pulseCounts
+                              except select ant, hourBin, count from r.pulseCounts)) = 0
+       and (select count(*) from pulseCounts) = (select count(*) from r.pulseCounts)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
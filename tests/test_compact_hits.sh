@@ -0,0 +1,112 @@
+#!/bin/bash
+
+## This tests whether hits stored compactly (--compact_hits) read back
+## through the `hits` view as they would have been stored in the usual
+## table: timestamps exactly, and other values to the units they are
+## rounded to.  The files are processed as a pause/resume pair of
+## sessions, so that runs continue across batches; the second session
+## doesn't ask for compact hits, but gets them anyway.  Lookups of
+## hits by run and by batch must use an index.
+
+## Relative paths assume this script is run from its directory.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--pulses_to_confirm=8 --frequency_slop=0.5 --min_dfreq=0 --max_dfreq=12 --pulse_slop=1.5 --burst_slop=4 --burst_slop_expansion=1 --use_events --max_skipped_bursts=20 --default_freq=166.376 --bootnum=176 --src_sqlite=1"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+## break files into two sets; we know some runs cross between them
+$SQL $RCVDB <<EOF
+create table save_files as select * from files where fileID >= 15600;
+delete from files where fileID >= 15600;
+EOF
+
+cp $RCVDB test1/plain.sqlite
+cp $RCVDB test1/compact.sqlite
+
+$FINDTAGS $OPTIONS test1/plain.sqlite test1/plain.sqlite
+$FINDTAGS $OPTIONS --compact_hits=1 test1/compact.sqlite test1/compact.sqlite
+
+for DB in plain compact; do
+    $SQL test1/$DB.sqlite <<EOF
+insert into files select * from save_files;
+drop table save_files;
+EOF
+    $FINDTAGS $OPTIONS --resume=1 test1/$DB.sqlite test1/$DB.sqlite
+done
+
+$SQL test1/compact.sqlite <<EOF
+attach database 'test1/plain.sqlite' as p;
+
+select "numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = 127
+       and (select count(*) from runs) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "hits stored compactly: " ||
+   case when
+       (select type from sqlite_master where name = 'hits') = 'view'
+       and (select count(*) from hitsCompact) = (select count(*) from hits)
+       and (select count(distinct batchID) from hitsCompact) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "compact/plain hits equal: " ||
+   case when
+       (select count(*) from hits h join p.hits x using (hitID)
+          where h.runID = x.runID and h.batchID = x.batchID and h.ts = x.ts
+            and abs(h.sig - x.sig) <= 0.005 and abs(h.sigSD - x.sigSD) <= 0.005
+            and abs(h.noise - x.noise) <= 0.005
+            and abs(h.freq - x.freq) <= 0.0005 and abs(h.freqSD - x.freqSD) <= 0.0005
+            and abs(h.slop - x.slop) <= 0.0000005 and abs(h.burstSlop - x.burstSlop) <= 0.0000005)
+       = (select count(*) from p.hits)
+       and (select count(*) from hits) = (select count(*) from p.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "compact/plain runs equal: " ||
+   case when
+       (select count(*) from (select runID, tsBegin, tsEnd, len, motusTagID, ant from runs
+                              except select runID, tsBegin, tsEnd, len, motusTagID, ant from p.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from p.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
+
+## a lookup by run or by batch must only read that run's or batch's
+## hits, and decode them the same as reading all hits
+for COL in runID batchID; do
+    echo -n "$COL lookup uses an index: "
+    if $SQL test1/compact.sqlite "explain query plan select * from hits where $COL = 1" \
+            | grep -q "SEARCH hitsCompact USING INDEX hitsCompact_.* ($COL=?)"; then
+        echo PASS
+    else
+        echo FAIL
+    fi
+done
+
+BAD=0
+for R in $($SQL test1/compact.sqlite "select runID from runs"); do
+    BAD=$(($BAD + $($SQL test1/compact.sqlite <<EOF
+attach database 'test1/plain.sqlite' as p;
+select (select count(*) from (select hitID, ts from hits where runID = $R
+                              except select hitID, ts from p.hits where runID = $R))
+   + abs((select count(*) from hits where runID = $R) - (select count(*) from p.hits where runID = $R));
+EOF
+)))
+done
+echo -n "hits by run equal: "
+if [ $BAD -eq 0 ]; then
+    echo PASS
+else
+    echo FAIL
+fi
@@ -0,0 +1,165 @@
+#!/bin/bash
+
+## This tests whether building runs directly from Lotek detections
+## (--lotek_direct) gives the same runs and hits as re-finding tags
+## from the pulses of each detection.  The detections are made up:
+## two tags share a Lotek ID and in-burst gaps, and are only told
+## apart by their burst intervals; some bursts are missed; and there
+## are detections of tag IDs at random times, which don't overlap
+## other detections.  The same detections are then run with a clock
+## jump, and with tags activated and deactivated part-way through,
+## including one which can't be told apart from another tag.
+## --timestamp_wonkiness must be refused with --lotek_direct.
+
+## Relative paths assume this script is run from its directory.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--lotek=1 --src_sqlite=1 --bootnum=1"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+$SQL $RCVDB <<EOF
+delete from tags;
+delete from events;
+delete from DTAtags;
+delete from DTAboot;
+insert into DTAboot values (1400000000, 1, 1);
+
+create temporary table t (tagID, mfgID, period, p1, p2, p3);
+insert into t values
+  (30001, 11,  5.1, 22.0, 44.0, 33.0),
+  (30002, 11,  7.3, 22.0, 44.0, 33.0),
+  (30003, 12,  9.7, 30.0, 20.0, 50.0),
+  (30004, 13,  4.9, 40.0, 26.0, 15.0),
+  (30005, 14, 12.1, 17.0, 36.0, 47.0);
+insert into tags (tagID, projectID, mfgID, codeSet, nomFreq, offsetFreq, period, periodSD, pulseLen, param1, param2, param3, tsStart)
+  select tagID, 1, mfgID, 'Lotek4', 166.38, 0, period, 0.001, 2.5, p1, p2, p3, 1400000000 from t;
+insert into events select 1400000000, tagID, 1 from t;
+
+with recursive k(k) as (select 0 union all select k + 1 from k where k < 59)
+insert into DTAtags (fileID, dtaline, ts, id, ant, sig, lat, lon, antFreq, gain, codeSet)
+  select 1, 0, 1500000000 + t.tagID % 10 * 1.234 + k * t.period + ((k * 37) % 7 - 3) * 0.0002,
+         t.mfgID, case when k < 30 then 'A1' else 'A2' end, 80 + (k * 11) % 40, null, null, 166.38, 60, 'Lotek4'
+  from t, k where (k * 13 + t.tagID) % 5 != 0 and not k between 20 and 25;
+
+with recursive k(k) as (select 0 union all select k + 1 from k where k < 79)
+insert into DTAtags (fileID, dtaline, ts, id, ant, sig, lat, lon, antFreq, gain, codeSet)
+  select * from (select 1, 0, 1500000000 + k * 3.71 + (k * k % 17) * 0.113 as ts, 11 + k % 4,
+                 case when k < 40 then 'A1' else 'A2' end, 90, null, null, 166.38, 60, 'Lotek4' from k) n
+  where not exists (select 1 from DTAtags d where abs(d.ts - n.ts) < 0.25);
+EOF
+
+cp $RCVDB test1/pulses.sqlite
+cp $RCVDB test1/direct.sqlite
+
+$FINDTAGS $OPTIONS test1/pulses.sqlite test1/pulses.sqlite
+$FINDTAGS $OPTIONS --lotek_direct=1 test1/direct.sqlite test1/direct.sqlite
+
+$SQL test1/direct.sqlite <<EOF
+attach database 'test1/pulses.sqlite' as p;
+
+select "numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = 263
+       and (select count(*) from runs) = 92
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "direct/pulses hits equal: " ||
+   case when
+       (select count(*) from (select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from hits
+                              except select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from p.hits)) = 0
+       and (select count(*) from hits) = (select count(*) from p.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "direct/pulses runs equal: " ||
+   case when
+       (select count(*) from (select tsBegin, tsEnd, len, motusTagID, ant from runs
+                              except select tsBegin, tsEnd, len, motusTagID, ant from p.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from p.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "direct/pulses pulse counts equal: " ||
+   case when
+       (select count(*) from (select ant, hourBin, count from pulseCounts
+                              except select ant, hourBin, count from p.pulseCounts)) = 0
+       and (select count(*) from pulseCounts) = (select count(*) from p.pulseCounts)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
+
+## compare runs and hits from both paths for database test1/$1.sqlite,
+## run with extra options $2, and check there are $3 hits and $4 runs
+compare() {
+    cp test1/$1.sqlite test1/$1_pulses.sqlite
+    cp test1/$1.sqlite test1/$1_direct.sqlite
+    $FINDTAGS $OPTIONS $2 test1/$1_pulses.sqlite test1/$1_pulses.sqlite
+    $FINDTAGS $OPTIONS $2 --lotek_direct=1 test1/$1_direct.sqlite test1/$1_direct.sqlite
+
+    $SQL test1/$1_direct.sqlite <<EOF
+attach database 'test1/$1_pulses.sqlite' as p;
+
+select "$1 numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = $3
+       and (select count(*) from runs) = $4
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "$1 direct/pulses hits equal: " ||
+   case when
+       (select count(*) from (select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from hits
+                              except select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from p.hits)) = 0
+       and (select count(*) from hits) = (select count(*) from p.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "$1 direct/pulses runs equal: " ||
+   case when
+       (select count(*) from (select tsBegin, tsEnd, len, motusTagID, ant from runs
+                              except select tsBegin, tsEnd, len, motusTagID, ant from p.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from p.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
+}
+
+## the receiver clock jumps ahead by 1 s part-way through
+cp $RCVDB test1/jump.sqlite
+$SQL test1/jump.sqlite "update DTAtags set ts = ts + 1 where ts >= 1500000150"
+compare jump "" 264 94
+
+echo -n "timestamp_wonkiness refused: "
+if $FINDTAGS $OPTIONS --timestamp_wonkiness=1 --lotek_direct=1 test1/jump_direct.sqlite test1/jump_direct.sqlite 2>&1 > /dev/null \
+        | grep -q "Can't use --timestamp_wonkiness"; then
+    echo PASS
+else
+    echo FAIL
+fi
+
+## tags are activated and deactivated during runs; 30006 can't be told
+## apart from 30005, so activating it makes their detections ambiguous
+cp $RCVDB test1/events.sqlite
+$SQL test1/events.sqlite <<EOF
+insert into tags (tagID, projectID, mfgID, codeSet, nomFreq, offsetFreq, period, periodSD, pulseLen, param1, param2, param3, tsStart)
+  select 30006, projectID, mfgID, codeSet, nomFreq, offsetFreq, period, periodSD, pulseLen, param1, param2, param3, tsStart
+  from tags where tagID = 30005;
+delete from events;
+insert into events values
+  (1400000000, 30001, 1), (1400000000, 30003, 1), (1400000000, 30004, 1), (1400000000, 30005, 1),
+  (1500000100.5, 30002, 1), (1500000120.5, 30004, 0), (1500000150.5, 30006, 1),
+  (1500000200.5, 30003, 0), (1500000260.5, 30003, 1), (1500000280.5, 30005, 0), (1500000300.5, 30001, 0);
+EOF
+compare events --use_events=1 229 98
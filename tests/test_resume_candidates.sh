@@ -0,0 +1,78 @@
+#!/bin/bash
+
+## This tests whether tag candidates which are part-way through a run
+## when a session is paused carry on when it is resumed.  The graphs
+## they walk aren't saved, but rebuilt on resume, so each candidate
+## must be put back in the same state of the new graph.  The files are
+## processed one at a time, as a session and then a resumed session
+## for each further file.  Both runs in these files cross from one file
+## to the next, and their tags are ambiguous, so the graph has a proxy
+## for them.  The runs and hits must be the same as from processing
+## all the files at once, with each run continuing across the pause
+## rather than ending there and a new one starting.
+
+## Relative paths assume this script is run from its directory.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--pulses_to_confirm=8 --frequency_slop=0.5 --min_dfreq=0 --max_dfreq=12 --pulse_slop=1.5 --burst_slop=4 --burst_slop_expansion=1 --use_events --max_skipped_bursts=20 --default_freq=166.376 --bootnum=176 --src_sqlite=1"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+cp $RCVDB test1/whole.sqlite
+cp $RCVDB test1/paused.sqlite
+
+$FINDTAGS $OPTIONS test1/whole.sqlite test1/whole.sqlite > /dev/null
+
+$SQL test1/paused.sqlite <<EOF
+create table save_files as select * from files;
+delete from files;
+EOF
+
+RESUME=""
+for ID in $($SQL test1/paused.sqlite "select fileID from save_files order by ts"); do
+    $SQL test1/paused.sqlite "insert into files select * from save_files where fileID = $ID"
+    $FINDTAGS $OPTIONS $RESUME test1/paused.sqlite test1/paused.sqlite > /dev/null
+    RESUME="--resume=1"
+done
+
+$SQL test1/paused.sqlite <<EOF
+attach database 'test1/whole.sqlite' as w;
+
+select "numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = 127
+       and (select count(*) from runs) = 2
+       and (select count(*) from batches) = (select count(*) from save_files)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "runs continue across a pause: " ||
+   case when
+       (select count(*) from runs r where
+          (select count(distinct batchID) from hits h where h.runID = r.runID) > 1) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "paused/whole hits equal: " ||
+   case when
+       (select count(*) from (select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from hits
+                              except select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from w.hits)) = 0
+       and (select count(*) from hits) = (select count(*) from w.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "paused/whole runs equal: " ||
+   case when
+       (select count(*) from (select tsBegin, tsEnd, len, motusTagID, ant from runs
+                              except select tsBegin, tsEnd, len, motusTagID, ant from w.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from w.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
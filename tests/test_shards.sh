@@ -0,0 +1,73 @@
+#!/bin/bash
+
+## This tests whether processing a boot session as parallel time
+## shards (--time_shards) gives the same results as processing it
+## serially.  Frequencies are only set (by "-m" parameter lines) in
+## the first file, and the default frequency is on another nominal
+## frequency with registered tags, so later shards only find tags if
+## they begin with the frequency settings made before them.
+
+## Relative paths assume this script is run from its directory.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--pulses_to_confirm=8 --frequency_slop=0.5 --min_dfreq=0 --max_dfreq=12 --pulse_slop=1.5 --burst_slop=4 --burst_slop_expansion=1 --use_events --max_skipped_bursts=20 --default_freq=150.1 --bootnum=176 --src_sqlite=1"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+## set the listening frequency at the start of the first file only
+FIRST=test1/repo/2017-09-01/kingsburg-4001BBBK2600-000176-2017-09-01T16-08-51.2850T-all.txt.gz
+( echo "S,1504282130.0,1,-m,166.376,0,"; echo "S,1504282130.0,2,-m,166.376,0,"; zcat $FIRST ) | gzip > test1/first.gz
+mv test1/first.gz $FIRST
+
+## register a copy of a tag on the default frequency
+$SQL $RCVDB <<EOF
+create temporary table t as select * from tags where tagID=10695;
+update t set tagID=99999, nomFreq=150.1;
+insert into tags select * from t;
+EOF
+
+cp $RCVDB test1/serial.sqlite
+cp $RCVDB test1/sharded.sqlite
+
+$FINDTAGS $OPTIONS test1/serial.sqlite test1/serial.sqlite 2> test1/serial.txt
+$FINDTAGS --time_shards=3 $OPTIONS test1/sharded.sqlite test1/sharded.sqlite 2> test1/sharded.txt
+
+$SQL test1/sharded.sqlite <<EOF
+attach database 'test1/serial.sqlite' as s;
+
+select "numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = 127
+       and (select count(*) from runs) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "serial/sharded hits equal: " ||
+   case when
+       (select count(*) from (select ts, sig, freq from hits except select ts, sig, freq from s.hits)) = 0
+       and (select count(*) from hits) = (select count(*) from s.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "serial/sharded runs equal: " ||
+   case when
+       (select count(*) from (select tsBegin, len, motusTagID, ant from runs except select tsBegin, len, motusTagID, ant from s.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from s.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
+
+## the largest number of candidates is reported over all shards
+MAXCANDS=$(grep 'Max num' test1/serial.txt | cut -d';' -f1)
+echo -n "max num candidates equal: "
+if [ -n "$MAXCANDS" ] && [ "$MAXCANDS" = "$(grep 'Max num' test1/sharded.txt | cut -d';' -f1)" ]; then
+    echo PASS
+else
+    echo FAIL
+fi
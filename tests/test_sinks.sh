@@ -0,0 +1,152 @@
+#!/bin/bash
+
+## This tests whether the output sinks (--csv_output, --columnar_output,
+## --binary_output, to a file and to standard output) get the same runs
+## and hits as the output database would have, and whether a batch
+## written to a sink is refused by --resume, since the runs it would
+## continue aren't in the database.
+
+## Relative paths assume this script is run from its directory.
+## Columnar and binary output are decoded with python3.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--pulses_to_confirm=8 --frequency_slop=0.5 --min_dfreq=0 --max_dfreq=12 --pulse_slop=1.5 --burst_slop=4 --burst_slop_expansion=1 --use_events --max_skipped_bursts=20 --default_freq=166.376 --bootnum=176 --src_sqlite=1"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+cp $RCVDB test1/db.sqlite
+cp $RCVDB test1/csv.sqlite
+cp $RCVDB test1/col.sqlite
+cp $RCVDB test1/bin.sqlite
+cp $RCVDB test1/pipe.sqlite
+
+$FINDTAGS $OPTIONS test1/db.sqlite test1/db.sqlite
+$FINDTAGS $OPTIONS --csv_output=test1/out test1/csv.sqlite test1/csv.sqlite
+$FINDTAGS $OPTIONS --columnar_output=test1/out.ftc test1/col.sqlite test1/col.sqlite
+$FINDTAGS $OPTIONS --binary_output=test1/out.ftr test1/bin.sqlite test1/bin.sqlite
+$FINDTAGS $OPTIONS --binary_output=- test1/pipe.sqlite test1/pipe.sqlite | cat > test1/pipe.ftr
+
+## decode the runs and hits from the columnar file into CSV files like
+## those from --csv_output
+python3 - test1/out.ftc test1/col <<EOF
+import struct, sys, zlib
+fmts = {0: 'iiddiiii', 1: 'iidfffffff'}
+names = {0: 'runs', 1: 'hits'}
+heads = {0: 'runID,batchIDbegin,tsBegin,tsEnd,done,motusTagID,ant,len',
+         1: 'batchID,runID,ts,sig,sigSD,noise,freq,freqSD,slop,burstSlop'}
+out = {t: open(sys.argv[2] + '_' + names[t] + '.csv', 'w') for t in names}
+for t in names:
+    out[t].write(heads[t] + '\n')
+d = open(sys.argv[1], 'rb').read()
+assert d[:8] == b'FTCOLUMN'
+i = 16
+while i < len(d):
+    table, rows, raw, zb = struct.unpack_from('=IIII', d, i)
+    i += 16
+    b = zlib.decompress(d[i:i + zb])
+    i += zb
+    if table not in fmts:
+        continue
+    cols, j = [], 0
+    for c in fmts[table]:
+        n, = struct.unpack_from('=I', b, j)
+        cols.append(struct.unpack_from('=%d%s' % (rows, c), b, j + 4))
+        j += 4 + n
+    for r in range(rows):
+        out[table].write(','.join(repr(col[r]) for col in cols) + '\n')
+EOF
+
+## decode the runs and hits from binary file $1 into CSV files with
+## prefix $2, the same way
+decode_binary() {
+    python3 - $1 $2 <<EOF
+import struct, sys
+fmts = {0: '=iiddiiii', 1: '=iidfffffff'}
+names = {0: 'runs', 1: 'hits'}
+heads = {0: 'runID,batchIDbegin,tsBegin,tsEnd,done,motusTagID,ant,len',
+         1: 'batchID,runID,ts,sig,sigSD,noise,freq,freqSD,slop,burstSlop'}
+out = {t: open(sys.argv[2] + '_' + names[t] + '.csv', 'w') for t in names}
+for t in names:
+    out[t].write(heads[t] + '\n')
+d = open(sys.argv[1], 'rb').read()
+assert d[:8] == b'FTRECORD'
+i = 16
+while i < len(d):
+    table, n = struct.unpack_from('=HH', d, i)
+    i += 4
+    if table in fmts:
+        assert n == struct.calcsize(fmts[table])
+        out[table].write(','.join(repr(x) for x in struct.unpack_from(fmts[table], d, i)) + '\n')
+    i += n
+assert i == len(d)
+EOF
+}
+
+decode_binary test1/out.ftr test1/bin
+decode_binary test1/pipe.ftr test1/pipe
+
+## compare runs and hits from files with prefix $2 to those in database $1
+compare() {
+    $SQL $1 <<EOF
+attach database 'test1/db.sqlite' as d;
+.mode csv
+.import $2_runs.csv r
+.import $2_hits.csv h
+.mode list
+
+select "$3 numHits, numRuns correct: " ||
+   case when
+       (select count(*) from h) = 127
+       and (select count(*) from r) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "$3/db hits equal: " ||
+   case when
+       (select count(*) from h where not exists
+          (select * from d.hits x where abs(x.ts - h.ts) < 1e-6 and abs(x.sig - h.sig) < 1e-3
+                                    and abs(x.burstSlop - h.burstSlop) < 1e-6)) = 0
+       and (select count(*) from h) = (select count(*) from d.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "$3/db runs equal: " ||
+   case when
+       (select count(*) from r where not exists
+          (select * from d.runs x where abs(x.tsBegin - r.tsBegin) < 1e-6 and x.len = r.len
+                                    and x.motusTagID = r.motusTagID and x.ant = r.ant)) = 0
+       and (select count(*) from r) = (select count(*) from d.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "$3 database has no runs or hits: " ||
+   case when
+       (select count(*) from main.runs) = 0
+       and (select count(*) from main.hits) = 0
+   then "PASS"
+   else "FAIL"
+   end;
+EOF
+}
+
+compare test1/csv.sqlite test1/out csv
+compare test1/col.sqlite test1/col columnar
+compare test1/bin.sqlite test1/bin binary
+compare test1/pipe.sqlite test1/pipe "binary stdout"
+
+## a batch written to a sink can't be resumed
+for DB in csv col bin; do
+    echo -n "$DB resume refused: "
+    if ! $FINDTAGS $OPTIONS --resume=1 test1/$DB.sqlite test1/$DB.sqlite > /dev/null 2> test1/resume.txt \
+            && grep -q "can't be resumed" test1/resume.txt; then
+        echo PASS
+    else
+        echo FAIL
+    fi
+done
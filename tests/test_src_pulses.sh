@@ -0,0 +1,55 @@
+#!/bin/bash
+
+## This tests whether finding tags with --src_pulses, in the pulses
+## recorded by an earlier run with --pulses_only, gives the same runs
+## and hits as finding them in the raw files.
+
+## Relative paths assume this script is run from its directory.
+
+SQL=sqlite3
+RCVDB=test1/test1.sqlite
+FINDTAGS="../src/find_tags_motus"
+OPTIONS="--pulses_to_confirm=8 --frequency_slop=0.5 --min_dfreq=0 --max_dfreq=12 --pulse_slop=1.5 --burst_slop=4 --burst_slop_expansion=1 --use_events --max_skipped_bursts=20 --default_freq=166.376 --bootnum=176"
+
+rm -rf test1
+tar -xjf test1.tar.bz2
+
+cp $RCVDB test1/raw.sqlite
+cp $RCVDB test1/pulses.sqlite
+
+## find tags in the raw files
+$FINDTAGS $OPTIONS --src_sqlite=1 test1/raw.sqlite test1/raw.sqlite
+
+## record the raw files' pulses, then find tags in those
+$FINDTAGS $OPTIONS --src_sqlite=1 --pulses_only=1 test1/pulses.sqlite test1/pulses.sqlite
+$FINDTAGS $OPTIONS --src_pulses=1 test1/pulses.sqlite test1/pulses.sqlite
+
+$SQL test1/pulses.sqlite <<EOF
+attach database 'test1/raw.sqlite' as r;
+
+select "numHits, numRuns correct: " ||
+   case when
+       (select count(*) from hits) = 127
+       and (select count(*) from runs) = 2
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "src_pulses/raw hits equal: " ||
+   case when
+       (select count(*) from (select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from hits
+                              except select ts, sig, sigSD, noise, freq, freqSD, slop, burstSlop from r.hits)) = 0
+       and (select count(*) from hits) = (select count(*) from r.hits)
+   then "PASS"
+   else "FAIL"
+   end;
+
+select "src_pulses/raw runs equal: " ||
+   case when
+       (select count(*) from (select tsBegin, tsEnd, len, motusTagID, ant from runs
+                              except select tsBegin, tsEnd, len, motusTagID, ant from r.runs)) = 0
+       and (select count(*) from runs) = (select count(*) from r.runs)
+   then "PASS"
+   else "FAIL"
+   end;
+EOF